@@ -9,7 +9,7 @@ use std::ops::Range;
 use std::path::{Path, PathBuf};
 use std::process::Command;
 use std::sync::Mutex;
-use std::time::SystemTime;
+use std::time::{SystemTime, UNIX_EPOCH};
 use std::{fs, mem};
 use tree_sitter::{Language, QueryError, QueryErrorKind};
 use tree_sitter_highlight::HighlightConfiguration;
@@ -101,6 +101,7 @@ pub struct Loader {
     highlight_names: Box<Mutex<Vec<String>>>,
     use_all_highlight_names: bool,
     debug_build: bool,
+    grammar_name_cache: Mutex<Option<HashMap<String, (u64, String)>>>,
 }
 
 unsafe impl Send for Loader {}
@@ -123,6 +124,7 @@ impl Loader {
             highlight_names: Box::new(Mutex::new(Vec::new())),
             use_all_highlight_names: true,
             debug_build: false,
+            grammar_name_cache: Mutex::new(None),
         }
     }
 
@@ -313,14 +315,7 @@ impl Loader {
         let parser_path = src_path.join("parser.c");
         let mut scanner_path = src_path.join("scanner.c");
 
-        #[derive(Deserialize)]
-        struct GrammarJSON {
-            name: String,
-        }
-        let mut grammar_file =
-            fs::File::open(grammar_path).with_context(|| "Failed to read grammar.json")?;
-        let grammar_json: GrammarJSON = serde_json::from_reader(BufReader::new(&mut grammar_file))
-            .with_context(|| "Failed to parse grammar.json")?;
+        let name = self.grammar_name(&grammar_path)?;
 
         let scanner_path = if scanner_path.exists() {
             Some(scanner_path)
@@ -333,12 +328,58 @@ impl Loader {
             }
         };
 
-        self.load_language_from_sources(
-            &grammar_json.name,
-            &header_path,
-            &parser_path,
-            &scanner_path,
-        )
+        self.load_language_from_sources(&name, &header_path, &parser_path, &scanner_path)
+    }
+
+    // Get the language name recorded in the given grammar.json file. Grammar
+    // files can be megabytes of JSON, so the names are cached on disk keyed by
+    // the file's modification time; repeat CLI invocations skip the parse.
+    fn grammar_name(&self, grammar_path: &Path) -> Result<String> {
+        #[derive(Deserialize)]
+        struct GrammarJSON {
+            name: String,
+        }
+
+        let mtime_secs = mtime(grammar_path)
+            .ok()
+            .and_then(|t| t.duration_since(UNIX_EPOCH).ok())
+            .map(|d| d.as_secs());
+        let cache_path = self
+            .parser_lib_path
+            .parent()
+            .map(|dir| dir.join("grammar-names.json"));
+        let key = grammar_path.to_string_lossy().into_owned();
+
+        let mut guard = self.grammar_name_cache.lock().unwrap();
+        if let (Some(mtime_secs), Some(cache_path)) = (mtime_secs, &cache_path) {
+            let cache = guard.get_or_insert_with(|| {
+                fs::read_to_string(cache_path)
+                    .ok()
+                    .and_then(|contents| serde_json::from_str(&contents).ok())
+                    .unwrap_or_default()
+            });
+            if let Some((cached_mtime, name)) = cache.get(&key) {
+                if *cached_mtime == mtime_secs {
+                    return Ok(name.clone());
+                }
+            }
+        }
+
+        let mut grammar_file =
+            fs::File::open(grammar_path).with_context(|| "Failed to read grammar.json")?;
+        let grammar_json: GrammarJSON = serde_json::from_reader(BufReader::new(&mut grammar_file))
+            .with_context(|| "Failed to parse grammar.json")?;
+
+        if let (Some(mtime_secs), Some(cache_path), Some(cache)) =
+            (mtime_secs, &cache_path, guard.as_mut())
+        {
+            cache.insert(key, (mtime_secs, grammar_json.name.clone()));
+            if let Ok(contents) = serde_json::to_string(cache) {
+                fs::create_dir_all(cache_path.parent().unwrap()).ok();
+                fs::write(cache_path, contents).ok();
+            }
+        }
+        Ok(grammar_json.name)
     }
 
     pub fn load_language_from_sources(
@@ -677,39 +718,67 @@ impl<'a> LanguageConfiguration<'a> {
                 if highlights_query.is_empty() {
                     Ok(None)
                 } else {
-                    let mut result = HighlightConfiguration::new(
+                    // Compiling the queries dominates startup for short CLI
+                    // invocations, so the compiled configuration is cached on
+                    // disk, keyed by the query text and the language version.
+                    let cache_path = highlight_query_cache_path(
                         language,
-                        &highlights_query,
-                        &injections_query,
-                        &locals_query,
-                    )
-                    .map_err(|error| match error.kind {
-                        QueryErrorKind::Language => Error::from(error),
-                        _ => {
-                            if error.offset < injections_query.len() {
-                                Self::include_path_in_query_error(
-                                    error,
-                                    &injection_ranges,
-                                    &injections_query,
-                                    0,
-                                )
-                            } else if error.offset < injections_query.len() + locals_query.len() {
-                                Self::include_path_in_query_error(
-                                    error,
-                                    &locals_ranges,
-                                    &locals_query,
-                                    injections_query.len(),
-                                )
-                            } else {
-                                Self::include_path_in_query_error(
-                                    error,
-                                    &highlight_ranges,
-                                    &highlights_query,
-                                    injections_query.len() + locals_query.len(),
-                                )
+                        &[
+                            &self.root_path.to_string_lossy(),
+                            &highlights_query,
+                            &injections_query,
+                            &locals_query,
+                        ],
+                    );
+                    let cached = cache_path
+                        .as_ref()
+                        .and_then(|path| fs::read(path).ok())
+                        .and_then(|blob| HighlightConfiguration::deserialize(language, &blob));
+
+                    let mut result = if let Some(config) = cached {
+                        config
+                    } else {
+                        let result = HighlightConfiguration::new(
+                            language,
+                            &highlights_query,
+                            &injections_query,
+                            &locals_query,
+                        )
+                        .map_err(|error| match error.kind {
+                            QueryErrorKind::Language => Error::from(error),
+                            _ => {
+                                if error.offset < injections_query.len() {
+                                    Self::include_path_in_query_error(
+                                        error,
+                                        &injection_ranges,
+                                        &injections_query,
+                                        0,
+                                    )
+                                } else if error.offset < injections_query.len() + locals_query.len() {
+                                    Self::include_path_in_query_error(
+                                        error,
+                                        &locals_ranges,
+                                        &locals_query,
+                                        injections_query.len(),
+                                    )
+                                } else {
+                                    Self::include_path_in_query_error(
+                                        error,
+                                        &highlight_ranges,
+                                        &highlights_query,
+                                        injections_query.len() + locals_query.len(),
+                                    )
+                                }
+                            }
+                        })?;
+                        if let Some(cache_path) = &cache_path {
+                            if let Some(dir) = cache_path.parent() {
+                                fs::create_dir_all(dir).ok();
                             }
+                            fs::write(cache_path, result.serialize()).ok();
                         }
-                    })?;
+                        result
+                    };
                     let mut all_highlight_names = self.highlight_names.lock().unwrap();
                     if self.use_all_highlight_names {
                         for capture_name in result.query.capture_names() {
@@ -836,6 +905,35 @@ fn mtime(path: &Path) -> Result<SystemTime> {
     Ok(fs::metadata(path)?.modified()?)
 }
 
+// Compute the cache file path for a compiled highlight configuration. The
+// key covers the library's ABI version, the language's version, and the text
+// of every query section, so editing a query file or upgrading the library
+// invalidates the entry. The serialized blob additionally embeds a
+// fingerprint of the language, so a colliding or stale entry is rejected at
+// load time and recompiled rather than misloaded.
+fn highlight_query_cache_path(language: Language, sections: &[&str]) -> Option<PathBuf> {
+    let mut hash = 0xcbf29ce484222325u64;
+    fnv1a(&mut hash, &(tree_sitter::LANGUAGE_VERSION as u64).to_le_bytes());
+    fnv1a(&mut hash, &(language.version() as u64).to_le_bytes());
+    for section in sections {
+        fnv1a(&mut hash, section.as_bytes());
+        fnv1a(&mut hash, &[0]);
+    }
+    Some(
+        dirs::cache_dir()?
+            .join("tree-sitter")
+            .join("queries")
+            .join(format!("highlights-{:016x}.bin", hash)),
+    )
+}
+
+fn fnv1a(hash: &mut u64, bytes: &[u8]) {
+    for byte in bytes {
+        *hash ^= *byte as u64;
+        *hash = hash.wrapping_mul(0x100000001b3);
+    }
+}
+
 fn replace_dashes_with_underscores(name: &str) -> String {
     let mut result = String::with_capacity(name.len());
     for c in name.chars() {
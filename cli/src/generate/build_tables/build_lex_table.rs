@@ -93,6 +93,7 @@ struct LexTableBuilder<'a> {
     table: LexTable,
     state_queue: VecDeque<QueueEntry>,
     state_ids_by_nfa_state_set: HashMap<(Vec<u32>, bool), usize>,
+    closures_by_nfa_state_set: HashMap<Vec<u32>, Vec<u32>>,
 }
 
 impl<'a> LexTableBuilder<'a> {
@@ -103,6 +104,7 @@ impl<'a> LexTableBuilder<'a> {
             table: LexTable::default(),
             state_queue: VecDeque::new(),
             state_ids_by_nfa_state_set: HashMap::new(),
+            closures_by_nfa_state_set: HashMap::new(),
         }
     }
 
@@ -144,7 +146,16 @@ impl<'a> LexTableBuilder<'a> {
     }
 
     fn add_state(&mut self, nfa_states: Vec<u32>, eof_valid: bool) -> (usize, bool) {
-        self.cursor.reset(nfa_states);
+        // The same sets of NFA states are reached over and over as different
+        // entry points' subset constructions explore overlapping parts of the
+        // NFA, so memoize each set's epsilon closure.
+        match self.closures_by_nfa_state_set.entry(nfa_states) {
+            Entry::Occupied(o) => self.cursor.force_reset(o.get().clone()),
+            Entry::Vacant(v) => {
+                self.cursor.reset(v.key().clone());
+                v.insert(self.cursor.state_ids.clone());
+            }
+        }
         match self
             .state_ids_by_nfa_state_set
             .entry((self.cursor.state_ids.clone(), eof_valid))
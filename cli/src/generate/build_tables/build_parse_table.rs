@@ -15,7 +15,13 @@ use std::cmp::Ordering;
 use std::collections::{BTreeMap, HashMap, HashSet, VecDeque};
 use std::fmt::Write;
 use std::hash::BuildHasherDefault;
-use std::u32;
+use std::sync::atomic::{self, AtomicUsize};
+use std::sync::Mutex;
+use std::{thread, u32};
+
+// Expanding a batch of item-set closures on multiple threads only pays off
+// once the batch is reasonably large; small batches are expanded inline.
+const MIN_BATCH_SIZE_FOR_PARALLEL_CLOSURES: usize = 16;
 
 use indexmap::{map::Entry, IndexMap};
 use rustc_hash::FxHasher;
@@ -119,17 +125,60 @@ impl<'a> ParseTableBuilder<'a> {
             self.add_parse_state(&Vec::new(), &Vec::new(), item_set);
         }
 
-        while let Some(entry) = self.parse_state_queue.pop_front() {
-            let item_set = self
-                .item_set_builder
-                .transitive_closure(&self.parse_state_info_by_id[entry.state_id].1);
+        // Process the queued states in batches. The closure of each kernel
+        // item set depends only on the precomputed expansion tables, so the
+        // closures within a batch can be computed on multiple threads. The
+        // actions are still added strictly in queue order, and new states are
+        // numbered as they are discovered during that sequential pass, so the
+        // resulting table is identical to a single-threaded build's.
+        let thread_count = thread::available_parallelism().map_or(1, |n| n.get());
+        while !self.parse_state_queue.is_empty() {
+            let entries = self.parse_state_queue.drain(..).collect::<Vec<_>>();
+            let item_sets = {
+                let item_set_builder = &self.item_set_builder;
+                let state_info = &self.parse_state_info_by_id;
+                if thread_count > 1 && entries.len() >= MIN_BATCH_SIZE_FOR_PARALLEL_CLOSURES {
+                    let next_index = AtomicUsize::new(0);
+                    let results = Mutex::new(Vec::with_capacity(entries.len()));
+                    thread::scope(|scope| {
+                        for _ in 0..thread_count.min(entries.len()) {
+                            scope.spawn(|| {
+                                let mut local_results = Vec::new();
+                                loop {
+                                    let index = next_index.fetch_add(1, atomic::Ordering::SeqCst);
+                                    if index >= entries.len() {
+                                        break;
+                                    }
+                                    let item_set = item_set_builder.transitive_closure(
+                                        &state_info[entries[index].state_id].1,
+                                    );
+                                    local_results.push((index, item_set));
+                                }
+                                results.lock().unwrap().append(&mut local_results);
+                            });
+                        }
+                    });
+                    let mut results = results.into_inner().unwrap();
+                    results.sort_unstable_by_key(|(index, _)| *index);
+                    results.into_iter().map(|(_, set)| set).collect()
+                } else {
+                    entries
+                        .iter()
+                        .map(|entry| {
+                            item_set_builder.transitive_closure(&state_info[entry.state_id].1)
+                        })
+                        .collect::<Vec<_>>()
+                }
+            };
 
-            self.add_actions(
-                self.parse_state_info_by_id[entry.state_id].0.clone(),
-                entry.preceding_auxiliary_symbols,
-                entry.state_id,
-                item_set,
-            )?;
+            for (entry, item_set) in entries.into_iter().zip(item_sets) {
+                self.add_actions(
+                    self.parse_state_info_by_id[entry.state_id].0.clone(),
+                    entry.preceding_auxiliary_symbols,
+                    entry.state_id,
+                    item_set,
+                )?;
+            }
         }
 
         Ok((self.parse_table, self.parse_state_info_by_id))
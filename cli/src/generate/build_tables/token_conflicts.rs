@@ -5,6 +5,13 @@ use crate::generate::rules::TokenSet;
 use std::cmp::Ordering;
 use std::collections::HashSet;
 use std::fmt;
+use std::sync::atomic::{self, AtomicUsize};
+use std::sync::Mutex;
+use std::thread;
+
+// Below this many tokens, the conflict matrix is cheap enough that spawning
+// threads costs more than it saves.
+const MIN_TOKENS_FOR_PARALLEL_CONFLICTS: usize = 64;
 
 #[derive(Clone, Debug, Default, PartialEq, Eq)]
 struct TokenConflictStatus {
@@ -37,14 +44,55 @@ impl<'a> TokenConflictMap<'a> {
         let starting_chars = get_starting_chars(&mut cursor, grammar);
         let following_chars = get_following_chars(&starting_chars, &following_tokens);
 
+        // Each pair's conflict status is computed independently; only the NFA
+        // cursor is mutable scratch state, so for large token sets the rows of
+        // the matrix can be distributed across threads, each with its own
+        // cursor. Every cell is written exactly once, so the result does not
+        // depend on the schedule.
         let n = grammar.variables.len();
         let mut status_matrix = vec![TokenConflictStatus::default(); n * n];
-        for i in 0..grammar.variables.len() {
-            for j in 0..i {
-                let status = compute_conflict_status(&mut cursor, grammar, &following_chars, i, j);
+        let thread_count = thread::available_parallelism().map_or(1, |t| t.get());
+        if thread_count > 1 && n >= MIN_TOKENS_FOR_PARALLEL_CONFLICTS {
+            let next_row = AtomicUsize::new(0);
+            let results = Mutex::new(Vec::new());
+            thread::scope(|scope| {
+                for _ in 0..thread_count.min(n) {
+                    scope.spawn(|| {
+                        let mut cursor = NfaCursor::new(&grammar.nfa, Vec::new());
+                        let mut local_results = Vec::new();
+                        loop {
+                            let i = next_row.fetch_add(1, atomic::Ordering::SeqCst);
+                            if i >= n {
+                                break;
+                            }
+                            for j in 0..i {
+                                let status = compute_conflict_status(
+                                    &mut cursor,
+                                    grammar,
+                                    &following_chars,
+                                    i,
+                                    j,
+                                );
+                                local_results.push((i, j, status));
+                            }
+                        }
+                        results.lock().unwrap().append(&mut local_results);
+                    });
+                }
+            });
+            for (i, j, status) in results.into_inner().unwrap() {
                 status_matrix[matrix_index(n, i, j)] = status.0;
                 status_matrix[matrix_index(n, j, i)] = status.1;
             }
+        } else {
+            for i in 0..n {
+                for j in 0..i {
+                    let status =
+                        compute_conflict_status(&mut cursor, grammar, &following_chars, i, j);
+                    status_matrix[matrix_index(n, i, j)] = status.0;
+                    status_matrix[matrix_index(n, j, i)] = status.1;
+                }
+            }
         }
 
         TokenConflictMap {
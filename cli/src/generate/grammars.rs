@@ -78,6 +78,12 @@ pub(crate) struct InlinedProductionMap {
     pub production_map: HashMap<(*const Production, u32), Vec<usize>>,
 }
 
+// The raw pointers in `production_map` are used only as identity keys for
+// productions owned by the grammar, which is immutable while this map is
+// alive, so the map can safely be shared between threads.
+unsafe impl Send for InlinedProductionMap {}
+unsafe impl Sync for InlinedProductionMap {}
+
 #[derive(Clone, Debug, PartialEq, Eq)]
 pub(crate) struct SyntaxVariable {
     pub name: String,
@@ -35,6 +35,7 @@ lazy_static! {
 
 struct GeneratedParser {
     c_code: String,
+    shared_ranges_code: Option<String>,
     node_types_json: String,
 }
 
@@ -44,6 +45,8 @@ pub fn generate_parser_in_directory(
     abi_version: usize,
     generate_bindings: bool,
     report_symbol_name: Option<&str>,
+    compact_lexer: bool,
+    shared_ranges: bool,
 ) -> Result<()> {
     let src_path = repo_path.join("src");
     let header_path = src_path.join("tree_sitter");
@@ -74,6 +77,7 @@ pub fn generate_parser_in_directory(
     // Generate the parser and related files.
     let GeneratedParser {
         c_code,
+        shared_ranges_code,
         node_types_json,
     } = generate_parser_for_grammar_with_opts(
         &language_name,
@@ -83,9 +87,14 @@ pub fn generate_parser_in_directory(
         simple_aliases,
         abi_version,
         report_symbol_name,
+        compact_lexer,
+        shared_ranges,
     )?;
 
     write_file(&src_path.join("parser.c"), c_code)?;
+    if let Some(shared_ranges_code) = shared_ranges_code {
+        write_file(&src_path.join("character-ranges.c"), shared_ranges_code)?;
+    }
     write_file(&src_path.join("node-types.json"), node_types_json)?;
     write_file(&header_path.join("parser.h"), tree_sitter::PARSER_HEADER)?;
 
@@ -97,6 +106,13 @@ pub fn generate_parser_in_directory(
 }
 
 pub fn generate_parser_for_grammar(grammar_json: &str) -> Result<(String, String)> {
+    generate_parser_for_grammar_with_abi(grammar_json, tree_sitter::LANGUAGE_VERSION)
+}
+
+pub fn generate_parser_for_grammar_with_abi(
+    grammar_json: &str,
+    abi_version: usize,
+) -> Result<(String, String)> {
     let grammar_json = JSON_COMMENT_REGEX.replace_all(grammar_json, "\n");
     let input_grammar = parse_grammar(&grammar_json)?;
     let (syntax_grammar, lexical_grammar, inlines, simple_aliases) =
@@ -107,8 +123,10 @@ pub fn generate_parser_for_grammar(grammar_json: &str) -> Result<(String, String
         lexical_grammar,
         inlines,
         simple_aliases,
-        tree_sitter::LANGUAGE_VERSION,
+        abi_version,
         None,
+        false,
+        false,
     )?;
     Ok((input_grammar.name, parser.c_code))
 }
@@ -121,6 +139,8 @@ fn generate_parser_for_grammar_with_opts(
     simple_aliases: AliasMap,
     abi_version: usize,
     report_symbol_name: Option<&str>,
+    compact_lexer: bool,
+    shared_ranges: bool,
 ) -> Result<GeneratedParser> {
     let variable_info =
         node_types::get_variable_info(&syntax_grammar, &lexical_grammar, &simple_aliases)?;
@@ -138,7 +158,7 @@ fn generate_parser_for_grammar_with_opts(
         &inlines,
         report_symbol_name,
     )?;
-    let c_code = render_c_code(
+    let (c_code, shared_ranges_code) = render_c_code(
         name,
         parse_table,
         main_lex_table,
@@ -148,9 +168,12 @@ fn generate_parser_for_grammar_with_opts(
         lexical_grammar,
         simple_aliases,
         abi_version,
+        compact_lexer,
+        shared_ranges,
     );
     Ok(GeneratedParser {
         c_code,
+        shared_ranges_code,
         node_types_json: serde_json::to_string_pretty(&node_types_json).unwrap(),
     })
 }
@@ -1,7 +1,6 @@
 use std::char;
 use std::cmp::max;
 use std::cmp::Ordering;
-use std::collections::HashSet;
 use std::fmt;
 use std::mem::swap;
 use std::ops::Range;
@@ -304,45 +303,59 @@ impl CharacterSet {
 
     /// Get a reduced list of character ranges, assuming that a given
     /// set of characters can be safely ignored.
-    pub fn simplify_ignoring<'a>(
-        &'a self,
-        ruled_out_characters: &'a HashSet<u32>,
-    ) -> Vec<Range<char>> {
-        let mut prev_range: Option<Range<char>> = None;
-        self.chars()
-            .map(|c| (c, false))
-            .chain(Some(('\0', true)))
-            .filter_map(move |(c, done)| {
-                if done {
-                    return prev_range.clone();
-                }
-                if ruled_out_characters.contains(&(c as u32)) {
-                    return None;
-                }
-                if let Some(range) = prev_range.clone() {
-                    let mut prev_range_successor = range.end as u32 + 1;
-                    while prev_range_successor < c as u32 {
-                        if !ruled_out_characters.contains(&prev_range_successor) {
-                            prev_range = Some(c..c);
-                            return Some(range);
-                        }
-                        prev_range_successor += 1;
-                    }
-                    prev_range = Some(range.start..c);
-                    None
-                } else {
-                    prev_range = Some(c..c);
-                    None
-                }
+    pub fn simplify_ignoring(&self, ruled_out_characters: &CharacterSet) -> Vec<Range<char>> {
+        // Discard the surrogate code points, which cannot occur in input text,
+        // along with the ruled-out characters.
+        let kept = self
+            .clone()
+            .difference(CharacterSet {
+                ranges: vec![0xD800..0xE000],
             })
-            .collect()
+            .difference(ruled_out_characters.clone());
+
+        // Merge adjacent ranges whose gaps consist entirely of ruled-out
+        // characters, and convert to inclusive `char` ranges.
+        let mut result: Vec<Range<char>> = Vec::new();
+        let mut prev_range: Option<Range<u32>> = None;
+        for range in kept.ranges {
+            if let Some(prev) = &mut prev_range {
+                if ruled_out_characters.contains_codepoint_range(prev.end..range.start) {
+                    prev.end = range.end;
+                    continue;
+                }
+                result.push(to_char_range(prev));
+            }
+            prev_range = Some(range);
+        }
+        if let Some(prev) = &prev_range {
+            result.push(to_char_range(prev));
+        }
+        result
+    }
+
+    /// Check whether this set contains every code point in the given
+    /// *exclusive* range.
+    fn contains_codepoint_range(&self, range: Range<u32>) -> bool {
+        // Because the ranges are sorted and non-adjacent, only the first range
+        // ending at or after the given endpoint can contain the entire range.
+        let i = self.ranges.partition_point(|r| r.end < range.end);
+        self.ranges
+            .get(i)
+            .map_or(false, |r| r.start <= range.start)
     }
 
     pub fn contains(&self, c: char) -> bool {
-        self.ranges.iter().any(|r| r.contains(&(c as u32)))
+        let i = self.ranges.partition_point(|r| r.end <= c as u32);
+        self.ranges.get(i).map_or(false, |r| r.start <= c as u32)
     }
 }
 
+fn to_char_range(range: &Range<u32>) -> Range<char> {
+    let start = char::from_u32(range.start).unwrap();
+    let end = char::from_u32(range.end - 1).unwrap();
+    start..end
+}
+
 impl Ord for CharacterSet {
     fn cmp(&self, other: &CharacterSet) -> Ordering {
         let count_cmp = self
@@ -355,17 +368,18 @@ impl Ord for CharacterSet {
             return count_cmp;
         }
 
+        // Two contiguous ranges of equal length are ordered by their starting
+        // characters, which matches a character-by-character comparison
+        // without needing to visit each character.
         for (left_range, right_range) in self.ranges.iter().zip(other.ranges.iter()) {
             let cmp = left_range.len().cmp(&right_range.len());
             if cmp != Ordering::Equal {
                 return cmp;
             }
 
-            for (left, right) in left_range.clone().zip(right_range.clone()) {
-                let cmp = left.cmp(&right);
-                if cmp != Ordering::Equal {
-                    return cmp;
-                }
+            let cmp = left_range.start.cmp(&right_range.start);
+            if cmp != Ordering::Equal {
+                return cmp;
             }
         }
         return Ordering::Equal;
@@ -1066,15 +1080,15 @@ mod tests {
             expected_ranges,
         } in table.iter()
         {
-            let ruled_out_chars = ruled_out_chars
-                .into_iter()
-                .map(|c: &char| *c as u32)
-                .collect();
+            let mut ruled_out_set = CharacterSet::empty();
+            for c in ruled_out_chars {
+                ruled_out_set = ruled_out_set.add_char(*c);
+            }
             let mut set = CharacterSet::empty();
             for c in chars {
                 set = set.add_char(*c);
             }
-            let ranges = set.simplify_ignoring(&ruled_out_chars);
+            let ranges = set.simplify_ignoring(&ruled_out_set);
             assert_eq!(ranges, *expected_ranges);
         }
     }
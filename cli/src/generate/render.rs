@@ -1,6 +1,7 @@
 use super::{
     char_tree::{CharacterTree, Comparator},
     grammars::{ExternalToken, LexicalGrammar, SyntaxGrammar, VariableType},
+    nfa::CharacterSet,
     rules::{Alias, AliasMap, Symbol, SymbolType},
     tables::{
         AdvanceAction, FieldLocation, GotoAction, LexState, LexTable, ParseAction, ParseTable,
@@ -20,6 +21,11 @@ const SMALL_STATE_THRESHOLD: usize = 64;
 const ABI_VERSION_MIN: usize = 13;
 const ABI_VERSION_MAX: usize = tree_sitter::LANGUAGE_VERSION;
 const ABI_VERSION_WITH_PRIMARY_STATES: usize = 14;
+const ABI_VERSION_WITH_SYMBOL_NAME_INDEX: usize = 15;
+const ABI_VERSION_WITH_SMALL_STATE_DENSE_TABLE: usize = 16;
+const ABI_VERSION_WITH_KEYWORD_HASH_TABLE: usize = 16;
+const KEYWORD_HASH_MAX_COUNT: usize = 512;
+const KEYWORD_HASH_MAX_LENGTH: usize = 64;
 
 macro_rules! add {
     ($this: tt, $($arg: tt)*) => {{
@@ -64,6 +70,8 @@ struct Generator {
     main_lex_table: LexTable,
     keyword_lex_table: LexTable,
     large_state_count: usize,
+    small_state_dense_row_count: usize,
+    keyword_hash_table_size: usize,
     keyword_capture_token: Option<Symbol>,
     syntax_grammar: SyntaxGrammar,
     lexical_grammar: LexicalGrammar,
@@ -74,6 +82,11 @@ struct Generator {
     unique_aliases: Vec<Alias>,
     symbol_map: HashMap<Symbol, Symbol>,
     field_names: Vec<String>,
+    compact_lexer: bool,
+    did_add_compact_lex_prelude: bool,
+    shared_ranges: bool,
+    did_add_shared_ranges_prelude: bool,
+    shared_range_tables: Vec<(String, Vec<Range<char>>)>,
 
     #[allow(unused)]
     abi_version: usize,
@@ -92,7 +105,7 @@ struct LargeCharacterSetInfo {
 }
 
 impl Generator {
-    fn generate(mut self) -> String {
+    fn generate(mut self) -> (String, Option<String>) {
         self.init();
         self.add_includes();
         self.add_pragmas();
@@ -100,6 +113,9 @@ impl Generator {
         self.add_symbol_enum();
         self.add_symbol_names_list();
         self.add_unique_symbol_map();
+        if self.abi_version >= ABI_VERSION_WITH_SYMBOL_NAME_INDEX {
+            self.add_symbol_name_index();
+        }
         self.add_symbol_metadata_list();
 
         if !self.field_names.is_empty() {
@@ -125,6 +141,9 @@ impl Generator {
         if self.keyword_capture_token.is_some() {
             let mut keyword_lex_table = LexTable::default();
             swap(&mut keyword_lex_table, &mut self.keyword_lex_table);
+            if self.abi_version >= ABI_VERSION_WITH_KEYWORD_HASH_TABLE {
+                self.add_keyword_hash_table(&keyword_lex_table);
+            }
             self.add_lex_function("ts_lex_keywords", keyword_lex_table, false);
         }
 
@@ -139,7 +158,17 @@ impl Generator {
         self.add_parse_table();
         self.add_parser_export();
 
-        self.buffer
+        let mut c_code = String::new();
+        swap(&mut c_code, &mut self.buffer);
+
+        let shared_ranges_code = if self.shared_range_tables.is_empty() {
+            None
+        } else {
+            self.add_shared_ranges_file();
+            Some(self.buffer)
+        };
+
+        (c_code, shared_ranges_code)
     }
 
     fn init(&mut self) {
@@ -407,6 +436,34 @@ impl Generator {
         add_line!(self, "");
     }
 
+    fn add_symbol_name_index(&mut self) {
+        // List every symbol id (including unique aliases) ordered by its
+        // name, so that the library can binary-search names at runtime.
+        let mut entries = Vec::new();
+        for symbol in self.parse_table.symbols.iter() {
+            let name = self
+                .default_aliases
+                .get(symbol)
+                .map(|alias| alias.value.as_str())
+                .unwrap_or(self.metadata_for_symbol(*symbol).0)
+                .to_string();
+            entries.push((name, self.symbol_ids[&symbol].clone()));
+        }
+        for alias in &self.unique_aliases {
+            entries.push((alias.value.clone(), self.alias_ids[&alias].clone()));
+        }
+        entries.sort_by(|a, b| a.0.cmp(&b.0));
+
+        add_line!(self, "static const TSSymbol ts_symbol_name_index[] = {{");
+        indent!(self);
+        for (_, id) in &entries {
+            add_line!(self, "{},", id);
+        }
+        dedent!(self);
+        add_line!(self, "}};");
+        add_line!(self, "");
+    }
+
     fn add_field_name_enum(&mut self) {
         add_line!(self, "enum {{");
         indent!(self);
@@ -665,13 +722,61 @@ impl Generator {
         add_line!(self, "");
     }
 
+    // Emit a perfect-hash table of the language's keyword strings, so that
+    // the library can recognize keywords by hashing the token's text instead
+    // of re-lexing it with the keyword lexer. The strings are enumerated from
+    // the keyword lex table; if the keywords are not a small finite set of
+    // plain ASCII strings (for example, when the grammar's keywords are
+    // case-insensitive patterns with many expansions), no table is emitted
+    // and the library falls back to the keyword lexer.
+    fn add_keyword_hash_table(&mut self, keyword_lex_table: &LexTable) {
+        let keywords = match enumerate_keyword_strings(keyword_lex_table) {
+            Some(keywords) => keywords,
+            None => return,
+        };
+        let table = match build_keyword_hash_table(&keywords) {
+            Some(table) => table,
+            None => return,
+        };
+
+        add_line!(
+            self,
+            "static const TSKeywordHashEntry ts_keyword_hash_table[{}] = {{",
+            table.len()
+        );
+        indent!(self);
+        for entry in &table {
+            match entry {
+                Some((text, symbol)) => {
+                    add_line!(
+                        self,
+                        "[{}] = {{\"{}\", {}, {}}},",
+                        keyword_hash(text) as usize % table.len(),
+                        text,
+                        text.len(),
+                        self.symbol_ids[symbol]
+                    );
+                }
+                None => {}
+            }
+        }
+        dedent!(self);
+        add_line!(self, "}};");
+        add_line!(self, "");
+        self.keyword_hash_table_size = table.len();
+    }
+
     fn add_lex_function(
         &mut self,
         name: &str,
         lex_table: LexTable,
         extract_helper_functions: bool,
     ) {
-        let mut ruled_out_chars = HashSet::new();
+        if self.compact_lexer {
+            return self.add_compact_lex_function(name, lex_table);
+        }
+
+        let mut ruled_out_chars = CharacterSet::empty();
         let mut large_character_sets = Vec::<LargeCharacterSetInfo>::new();
 
         // For each lex state, compute a summary of the code that needs to be
@@ -680,7 +785,7 @@ impl Generator {
             .states
             .iter()
             .map(|state| {
-                ruled_out_chars.clear();
+                ruled_out_chars = CharacterSet::empty();
 
                 // For each state transition, compute the set of character ranges
                 // that need to be checked.
@@ -692,7 +797,7 @@ impl Generator {
                         let mut ranges;
                         if is_included {
                             ranges = chars.simplify_ignoring(&ruled_out_chars);
-                            ruled_out_chars.extend(chars.iter());
+                            ruled_out_chars = ruled_out_chars.clone().add(chars);
                         } else {
                             ranges = chars.clone().negate().simplify_ignoring(&ruled_out_chars);
                             ranges.insert(0, '\0'..'\0')
@@ -735,10 +840,48 @@ impl Generator {
             })
             .collect();
 
-        // Generate a helper function for each large character set.
+        // Generate a helper function for each large character set. In the
+        // default mode, the set is compiled into a tree of comparisons; in
+        // shared-ranges mode, it becomes a reference to a range table that is
+        // defined in the companion file and named by its contents, so that
+        // identical sets in different grammars resolve to the same symbol.
+        if self.shared_ranges && !large_character_sets.is_empty() {
+            self.add_shared_ranges_prelude();
+        }
         let mut sorted_large_char_sets: Vec<_> = large_character_sets.iter().map(|e| e).collect();
         sorted_large_char_sets.sort_unstable_by_key(|info| (info.symbol, info.index));
         for info in sorted_large_char_sets {
+            if self.shared_ranges {
+                let table_name = shared_range_table_name(&info.ranges);
+                if !self.shared_range_tables.iter().any(|(name, _)| *name == table_name) {
+                    self.shared_range_tables
+                        .push((table_name.clone(), info.ranges.clone()));
+                }
+                add_line!(
+                    self,
+                    "extern const TSCharacterRange {}[{}];",
+                    table_name,
+                    info.ranges.len()
+                );
+                add_line!(self, "");
+                add_line!(
+                    self,
+                    "static inline bool {}_character_set_{}(int32_t c) {{",
+                    self.symbol_ids[&info.symbol],
+                    info.index
+                );
+                indent!(self);
+                add_line!(
+                    self,
+                    "return ts_character_range_contains({}, {}, c);",
+                    table_name,
+                    info.ranges.len()
+                );
+                dedent!(self);
+                add_line!(self, "}}");
+                add_line!(self, "");
+                continue;
+            }
             add_line!(
                 self,
                 "static inline bool {}_character_set_{}(int32_t c) {{",
@@ -788,6 +931,347 @@ impl Generator {
         add_line!(self, "");
     }
 
+    // Emit the shared typedefs and range-lookup helper used by the compact,
+    // table-driven lex functions.
+    fn add_compact_lex_prelude(&mut self) {
+        add_line!(self, "typedef struct {{");
+        indent!(self);
+        add_line!(self, "int32_t start;");
+        add_line!(self, "int32_t end;");
+        dedent!(self);
+        add_line!(self, "}} TSLexRange;");
+        add_line!(self, "");
+
+        add_line!(self, "typedef struct {{");
+        indent!(self);
+        add_line!(self, "uint32_t range_index;");
+        add_line!(self, "uint16_t range_count;");
+        add_line!(self, "uint16_t next_state;");
+        add_line!(self, "uint8_t is_included;");
+        add_line!(self, "uint8_t is_skipped;");
+        dedent!(self);
+        add_line!(self, "}} TSLexTransition;");
+        add_line!(self, "");
+
+        add_line!(self, "typedef struct {{");
+        indent!(self);
+        add_line!(self, "int32_t accept_token;");
+        add_line!(self, "int32_t eof_state;");
+        add_line!(self, "uint32_t transition_index;");
+        add_line!(self, "uint16_t transition_count;");
+        dedent!(self);
+        add_line!(self, "}} TSLexStateData;");
+        add_line!(self, "");
+
+        add_line!(
+            self,
+            "static bool ts_lex_range_contains(const TSLexRange *ranges, uint16_t count, int32_t lookahead) {{"
+        );
+        indent!(self);
+        add_line!(self, "uint32_t low = 0, high = count;");
+        add_line!(self, "while (low < high) {{");
+        indent!(self);
+        add_line!(self, "uint32_t mid = (low + high) / 2;");
+        add_line!(self, "if (lookahead < ranges[mid].start) {{");
+        indent!(self);
+        add_line!(self, "high = mid;");
+        dedent!(self);
+        add_line!(self, "}} else if (lookahead > ranges[mid].end) {{");
+        indent!(self);
+        add_line!(self, "low = mid + 1;");
+        dedent!(self);
+        add_line!(self, "}} else {{");
+        indent!(self);
+        add_line!(self, "return true;");
+        dedent!(self);
+        add_line!(self, "}}");
+        dedent!(self);
+        add_line!(self, "}}");
+        add_line!(self, "return false;");
+        dedent!(self);
+        add_line!(self, "}}");
+        add_line!(self, "");
+    }
+
+    // Emit the typedef and range-lookup helper used by the lex functions when
+    // large character sets are stored as shared range tables.
+    fn add_shared_ranges_prelude(&mut self) {
+        if self.did_add_shared_ranges_prelude {
+            return;
+        }
+        self.did_add_shared_ranges_prelude = true;
+
+        add_line!(self, "typedef struct {{");
+        indent!(self);
+        add_line!(self, "int32_t start;");
+        add_line!(self, "int32_t end;");
+        dedent!(self);
+        add_line!(self, "}} TSCharacterRange;");
+        add_line!(self, "");
+
+        add_line!(
+            self,
+            "static bool ts_character_range_contains(const TSCharacterRange *ranges, uint32_t count, int32_t lookahead) {{"
+        );
+        indent!(self);
+        add_line!(self, "uint32_t low = 0, high = count;");
+        add_line!(self, "while (low < high) {{");
+        indent!(self);
+        add_line!(self, "uint32_t mid = (low + high) / 2;");
+        add_line!(self, "if (lookahead < ranges[mid].start) {{");
+        indent!(self);
+        add_line!(self, "high = mid;");
+        dedent!(self);
+        add_line!(self, "}} else if (lookahead > ranges[mid].end) {{");
+        indent!(self);
+        add_line!(self, "low = mid + 1;");
+        dedent!(self);
+        add_line!(self, "}} else {{");
+        indent!(self);
+        add_line!(self, "return true;");
+        dedent!(self);
+        add_line!(self, "}}");
+        dedent!(self);
+        add_line!(self, "}}");
+        add_line!(self, "return false;");
+        dedent!(self);
+        add_line!(self, "}}");
+        add_line!(self, "");
+    }
+
+    // Emit the companion file that defines the range tables referenced by the
+    // lex functions. The tables are plain `const` arrays, so they stay in the
+    // read-only segment of whatever object they are compiled into, and their
+    // names depend only on their contents: grammars that use the same
+    // character set (such as the unicode identifier sets) declare the same
+    // symbol, and a build can compile a single copy of each distinct table
+    // into a common library instead of duplicating it in every grammar.
+    fn add_shared_ranges_file(&mut self) {
+        add_line!(
+            self,
+            "// Character-range tables for the {} grammar.",
+            self.language_name
+        );
+        add_line!(self, "");
+        add_line!(self, "#include <stdint.h>");
+        add_line!(self, "");
+
+        add_line!(self, "typedef struct {{");
+        indent!(self);
+        add_line!(self, "int32_t start;");
+        add_line!(self, "int32_t end;");
+        dedent!(self);
+        add_line!(self, "}} TSCharacterRange;");
+        add_line!(self, "");
+
+        let mut tables = Vec::new();
+        swap(&mut tables, &mut self.shared_range_tables);
+        for (name, ranges) in &tables {
+            add_line!(
+                self,
+                "const TSCharacterRange {}[{}] = {{",
+                name,
+                ranges.len()
+            );
+            indent!(self);
+            for chunk in ranges.chunks(6) {
+                add_whitespace!(self);
+                for range in chunk {
+                    add!(self, "{{{}, {}}}, ", range.start as u32, range.end as u32);
+                }
+                add!(self, "\n");
+            }
+            dedent!(self);
+            add_line!(self, "}};");
+            add_line!(self, "");
+        }
+    }
+
+    // Emit a lex function as compact transition tables interpreted by a small
+    // loop, instead of one switch case per state. The tables preserve the
+    // exact semantics of the switch-based output: transitions are tried in
+    // order, each one's character ranges are simplified while ignoring the
+    // characters already ruled out by earlier transitions, and negated sets
+    // never match the null character. Identical range lists (such as the big
+    // unicode identifier sets) are stored once and shared by index.
+    fn add_compact_lex_function(&mut self, name: &str, lex_table: LexTable) {
+        if !self.did_add_compact_lex_prelude {
+            self.did_add_compact_lex_prelude = true;
+            self.add_compact_lex_prelude();
+        }
+
+        let mut all_ranges = Vec::<Range<char>>::new();
+        let mut range_slice_indices = HashMap::<Vec<Range<char>>, usize>::new();
+        let mut transitions = Vec::<(usize, usize, usize, bool, bool)>::new();
+        let mut states = Vec::<(Option<Symbol>, Option<usize>, usize, usize)>::new();
+
+        for state in &lex_table.states {
+            let mut ruled_out_chars = CharacterSet::empty();
+            let transition_index = transitions.len();
+            for (chars, action) in &state.advance_actions {
+                let is_included = !chars.contains(std::char::MAX);
+                let ranges;
+                if is_included {
+                    ranges = chars.simplify_ignoring(&ruled_out_chars);
+                    ruled_out_chars = ruled_out_chars.add(chars);
+                } else {
+                    let mut negated = chars.clone().negate().simplify_ignoring(&ruled_out_chars);
+                    negated.insert(0, '\0'..'\0');
+                    ranges = negated;
+                }
+                let range_count = ranges.len();
+                let range_index = *range_slice_indices.entry(ranges).or_insert_with_key(|ranges| {
+                    let index = all_ranges.len();
+                    all_ranges.extend(ranges.iter().cloned());
+                    index
+                });
+                transitions.push((
+                    range_index,
+                    range_count,
+                    action.state,
+                    is_included,
+                    !action.in_main_token,
+                ));
+            }
+            states.push((
+                state.accept_action,
+                state.eof_action.as_ref().map(|action| action.state),
+                transition_index,
+                transitions.len() - transition_index,
+            ));
+        }
+
+        add_line!(
+            self,
+            "static const TSLexRange {}_ranges[] = {{",
+            name
+        );
+        indent!(self);
+        for chunk in all_ranges.chunks(6) {
+            add_whitespace!(self);
+            for range in chunk {
+                add!(self, "{{{}, {}}}, ", range.start as u32, range.end as u32);
+            }
+            add!(self, "\n");
+        }
+        if all_ranges.is_empty() {
+            add_line!(self, "{{0, 0}},");
+        }
+        dedent!(self);
+        add_line!(self, "}};");
+        add_line!(self, "");
+
+        add_line!(
+            self,
+            "static const TSLexTransition {}_transitions[] = {{",
+            name
+        );
+        indent!(self);
+        for (range_index, range_count, next_state, is_included, is_skipped) in &transitions {
+            add_line!(
+                self,
+                "{{{}, {}, {}, {}, {}}},",
+                range_index,
+                range_count,
+                next_state,
+                *is_included as u8,
+                *is_skipped as u8
+            );
+        }
+        if transitions.is_empty() {
+            add_line!(self, "{{0, 0, 0, 0, 0}},");
+        }
+        dedent!(self);
+        add_line!(self, "}};");
+        add_line!(self, "");
+
+        add_line!(
+            self,
+            "static const TSLexStateData {}_states[] = {{",
+            name
+        );
+        indent!(self);
+        for (accept_action, eof_state, transition_index, transition_count) in &states {
+            add_whitespace!(self);
+            add!(self, "{{");
+            if let Some(accept_action) = accept_action {
+                add!(self, "{}", self.symbol_ids[accept_action]);
+            } else {
+                add!(self, "-1");
+            }
+            if let Some(eof_state) = eof_state {
+                add!(self, ", {}", eof_state);
+            } else {
+                add!(self, ", -1");
+            }
+            add!(self, ", {}, {}}},\n", transition_index, transition_count);
+        }
+        dedent!(self);
+        add_line!(self, "}};");
+        add_line!(self, "");
+
+        add_line!(
+            self,
+            "static bool {}(TSLexer *lexer, TSStateId state) {{",
+            name
+        );
+        indent!(self);
+        add_line!(self, "START_LEXER();");
+        add_line!(self, "eof = lexer->eof(lexer);");
+        add_line!(self, "while (state < {}) {{", states.len());
+        indent!(self);
+        add_line!(
+            self,
+            "const TSLexStateData *lex_state = &{}_states[state];",
+            name
+        );
+        add_line!(self, "if (lex_state->accept_token >= 0) {{");
+        indent!(self);
+        add_line!(self, "ACCEPT_TOKEN(lex_state->accept_token);");
+        dedent!(self);
+        add_line!(self, "}}");
+        add_line!(
+            self,
+            "if (eof && lex_state->eof_state >= 0) ADVANCE(lex_state->eof_state);"
+        );
+        add_line!(
+            self,
+            "const TSLexTransition *transitions = &{}_transitions[lex_state->transition_index];",
+            name
+        );
+        add_line!(
+            self,
+            "for (uint16_t i = 0; i < lex_state->transition_count; i++) {{"
+        );
+        indent!(self);
+        add_line!(self, "const TSLexTransition *transition = &transitions[i];");
+        add_line!(self, "bool in_set = ts_lex_range_contains(");
+        indent!(self);
+        add_line!(self, "&{}_ranges[transition->range_index],", name);
+        add_line!(self, "transition->range_count,");
+        add_line!(self, "lookahead");
+        dedent!(self);
+        add_line!(self, ");");
+        add_line!(
+            self,
+            "if (transition->range_count == 0 || in_set == (bool)transition->is_included) {{"
+        );
+        indent!(self);
+        add_line!(self, "if (transition->is_skipped) SKIP(transition->next_state)");
+        add_line!(self, "ADVANCE(transition->next_state);");
+        dedent!(self);
+        add_line!(self, "}}");
+        dedent!(self);
+        add_line!(self, "}}");
+        add_line!(self, "END_STATE();");
+        dedent!(self);
+        add_line!(self, "}}");
+        add_line!(self, "return false;");
+        dedent!(self);
+        add_line!(self, "}}");
+        add_line!(self, "");
+    }
+
     fn symbol_for_advance_action(
         &self,
         action: &AdvanceAction,
@@ -1160,8 +1644,16 @@ impl Generator {
 
             let mut index = 0;
             let mut small_state_indices = Vec::new();
+            let mut dense_rows: Vec<(usize, Symbol, usize, Vec<(usize, usize, SymbolType)>)> =
+                Vec::new();
             let mut symbols_by_value: HashMap<(usize, SymbolType), Vec<Symbol>> = HashMap::new();
-            for state in self.parse_table.states.iter().skip(self.large_state_count) {
+            for (state_id, state) in self
+                .parse_table
+                .states
+                .iter()
+                .enumerate()
+                .skip(self.large_state_count)
+            {
                 small_state_indices.push(index);
                 symbols_by_value.clear();
 
@@ -1201,6 +1693,44 @@ impl Generator {
                     (symbols.len(), *kind, *value, symbols[0])
                 });
 
+                // From ABI version 16, a state whose dense row - table values
+                // indexed directly by symbol - would be no larger than its
+                // grouped sections is stored densely instead, making each of
+                // its lookups a bounds check and an index rather than a scan.
+                // A one-word stub keeps the grouped table and its map
+                // well-formed for these states.
+                if self.abi_version >= ABI_VERSION_WITH_SMALL_STATE_DENSE_TABLE {
+                    let mut entries = Vec::new();
+                    for ((value, kind), symbols) in &values_with_symbols {
+                        for symbol in symbols {
+                            entries.push((self.symbol_order[symbol], *symbol, *value, *kind));
+                        }
+                    }
+                    let grouped_size = 1
+                        + values_with_symbols
+                            .iter()
+                            .map(|(_, symbols)| 2 + symbols.len())
+                            .sum::<usize>();
+                    if let Some(&(min, min_symbol, ..)) = entries.iter().min_by_key(|e| e.0) {
+                        let max = entries.iter().map(|e| e.0).max().unwrap();
+                        let span = max - min + 1;
+                        if 2 + span + 1 <= grouped_size {
+                            dense_rows.push((
+                                state_id,
+                                min_symbol,
+                                span,
+                                entries
+                                    .into_iter()
+                                    .map(|(order, _, value, kind)| (order - min, value, kind))
+                                    .collect(),
+                            ));
+                            add_line!(self, "[{}] = 0,", index);
+                            index += 1;
+                            continue;
+                        }
+                    }
+                }
+
                 add_line!(self, "[{}] = {},", index, values_with_symbols.len());
                 indent!(self);
 
@@ -1247,6 +1777,56 @@ impl Generator {
             dedent!(self);
             add_line!(self, "}};");
             add_line!(self, "");
+
+            if !dense_rows.is_empty() {
+                self.small_state_dense_row_count = dense_rows.len();
+                add_line!(
+                    self,
+                    "static const uint16_t ts_small_parse_table_dense[] = {{"
+                );
+                indent!(self);
+
+                // Offset zero is reserved so that a zero entry in the dense
+                // map means "this state has only the grouped representation".
+                let mut dense_index = 1;
+                let mut dense_row_indices = Vec::new();
+                for (state_id, min_symbol, span, entries) in &dense_rows {
+                    dense_row_indices.push((*state_id, dense_index));
+                    add_line!(
+                        self,
+                        "[{}] = {}, {},",
+                        dense_index,
+                        self.symbol_ids[min_symbol],
+                        span
+                    );
+                    indent!(self);
+                    for (offset, value, kind) in entries {
+                        if *kind == SymbolType::NonTerminal {
+                            add_line!(self, "[{}] = STATE({}),", dense_index + 2 + offset, value);
+                        } else {
+                            add_line!(self, "[{}] = ACTIONS({}),", dense_index + 2 + offset, value);
+                        }
+                    }
+                    dedent!(self);
+                    dense_index += 2 + span;
+                }
+
+                dedent!(self);
+                add_line!(self, "}};");
+                add_line!(self, "");
+
+                add_line!(
+                    self,
+                    "static const uint32_t ts_small_parse_table_dense_map[STATE_COUNT - LARGE_STATE_COUNT] = {{"
+                );
+                indent!(self);
+                for (state_id, row_index) in dense_row_indices {
+                    add_line!(self, "[SMALL_STATE({})] = {},", state_id, row_index);
+                }
+                dedent!(self);
+                add_line!(self, "}};");
+                add_line!(self, "");
+            }
         }
 
         let mut parse_table_entries: Vec<_> = parse_table_entries
@@ -1423,6 +2003,30 @@ impl Generator {
             add_line!(self, ".primary_state_ids = ts_primary_state_ids,");
         }
 
+        if self.abi_version >= ABI_VERSION_WITH_SYMBOL_NAME_INDEX {
+            add_line!(self, ".symbol_name_index = ts_symbol_name_index,");
+        }
+
+        if self.small_state_dense_row_count > 0 {
+            add_line!(
+                self,
+                ".small_parse_table_dense_map = ts_small_parse_table_dense_map,"
+            );
+            add_line!(
+                self,
+                ".small_parse_table_dense = ts_small_parse_table_dense,"
+            );
+        }
+
+        if self.keyword_hash_table_size > 0 {
+            add_line!(self, ".keyword_hash_table = ts_keyword_hash_table,");
+            add_line!(
+                self,
+                ".keyword_hash_table_size = {},",
+                self.keyword_hash_table_size
+            );
+        }
+
         dedent!(self);
         add_line!(self, "}};");
         add_line!(self, "return &language;");
@@ -1614,6 +2218,102 @@ impl Generator {
     }
 }
 
+// Enumerate every string accepted by the keyword lex table, by walking its
+// states depth-first. Returns `None` if the accepted language is not a small
+// finite set of plain ASCII strings: a path longer than the length limit
+// indicates a cycle or pathological keyword, and in either case the table
+// would not faithfully represent the keyword lexer.
+fn enumerate_keyword_strings(keyword_lex_table: &LexTable) -> Option<Vec<(String, Symbol)>> {
+    let mut result = Vec::new();
+    let mut stack = vec![(0usize, String::new())];
+    while let Some((state_id, prefix)) = stack.pop() {
+        if prefix.len() > KEYWORD_HASH_MAX_LENGTH {
+            return None;
+        }
+        let state = &keyword_lex_table.states[state_id];
+        if let Some(symbol) = state.accept_action {
+            if !prefix.is_empty() {
+                result.push((prefix.clone(), symbol));
+                if result.len() > KEYWORD_HASH_MAX_COUNT {
+                    return None;
+                }
+            }
+        }
+        for (chars, action) in &state.advance_actions {
+            // Separator transitions never occur within a keyword's text.
+            if !action.in_main_token {
+                continue;
+            }
+            for c in chars.chars() {
+                if !c.is_ascii_graphic() || c == '"' || c == '\\' {
+                    return None;
+                }
+                let mut next = prefix.clone();
+                next.push(c);
+                stack.push((action.state, next));
+                if stack.len() > KEYWORD_HASH_MAX_COUNT * KEYWORD_HASH_MAX_LENGTH {
+                    return None;
+                }
+            }
+        }
+    }
+    if result.is_empty() {
+        None
+    } else {
+        Some(result)
+    }
+}
+
+// Name a shared range table after its contents, using the 64-bit FNV-1a hash
+// of the range endpoints. The name must depend on nothing but the ranges, so
+// that every grammar derives the same name for the same character set.
+fn shared_range_table_name(ranges: &[Range<char>]) -> String {
+    let mut hash: u64 = 0xcbf29ce484222325;
+    for range in ranges {
+        for value in [range.start as u32, range.end as u32] {
+            for byte in value.to_le_bytes() {
+                hash ^= byte as u64;
+                hash = hash.wrapping_mul(0x100000001b3);
+            }
+        }
+    }
+    format!("ts_character_ranges_{:016x}", hash)
+}
+
+// The same FNV-1a hash that `ts_language_keyword_lookup` computes at runtime.
+fn keyword_hash(text: &str) -> u32 {
+    let mut hash: u32 = 2166136261;
+    for byte in text.bytes() {
+        hash ^= byte as u32;
+        hash = hash.wrapping_mul(16777619);
+    }
+    hash
+}
+
+// Search for a table size that gives every keyword its own slot. Sizes up to
+// eight times the keyword count are tried; in practice a collision-free size
+// is found within the first few attempts.
+fn build_keyword_hash_table(
+    keywords: &Vec<(String, Symbol)>,
+) -> Option<Vec<Option<(String, Symbol)>>> {
+    for size in keywords.len()..=keywords.len() * 8 {
+        let mut table: Vec<Option<(String, Symbol)>> = vec![None; size];
+        let mut ok = true;
+        for (text, symbol) in keywords {
+            let slot = keyword_hash(text) as usize % size;
+            if table[slot].is_some() {
+                ok = false;
+                break;
+            }
+            table[slot] = Some((text.clone(), *symbol));
+        }
+        if ok {
+            return Some(table);
+        }
+    }
+    None
+}
+
 /// Returns a String of C code for the given components of a parser.
 ///
 /// # Arguments
@@ -1632,6 +2332,9 @@ impl Generator {
 /// * `abi_version` - The language ABI version that should be generated. Usually
 ///    you want Tree-sitter's current version, but right after making an ABI
 ///    change, it may be useful to generate code with the previous ABI.
+///
+/// Returns the C code for the parser, and, in shared-ranges mode, the C code
+/// for the companion file that defines the parser's character-range tables.
 pub(crate) fn render_c_code(
     name: &str,
     parse_table: ParseTable,
@@ -1642,7 +2345,9 @@ pub(crate) fn render_c_code(
     lexical_grammar: LexicalGrammar,
     default_aliases: AliasMap,
     abi_version: usize,
-) -> String {
+    compact_lexer: bool,
+    shared_ranges: bool,
+) -> (String, Option<String>) {
     if !(ABI_VERSION_MIN..=ABI_VERSION_MAX).contains(&abi_version) {
         panic!(
             "This version of Tree-sitter can only generate parsers with ABI version {} - {}, not {}",
@@ -1655,6 +2360,8 @@ pub(crate) fn render_c_code(
         indent_level: 0,
         language_name: name.to_string(),
         large_state_count: 0,
+        small_state_dense_row_count: 0,
+        keyword_hash_table_size: 0,
         parse_table,
         main_lex_table,
         keyword_lex_table,
@@ -1668,6 +2375,11 @@ pub(crate) fn render_c_code(
         symbol_map: HashMap::new(),
         unique_aliases: Vec::new(),
         field_names: Vec::new(),
+        compact_lexer,
+        did_add_compact_lex_prelude: false,
+        shared_ranges,
+        did_add_shared_ranges_prelude: false,
+        shared_range_tables: Vec::new(),
         abi_version,
     }
     .generate()
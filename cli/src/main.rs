@@ -3,6 +3,7 @@ use clap::{App, AppSettings, Arg, SubCommand};
 use glob::glob;
 use std::path::Path;
 use std::{env, fs, u64};
+use tree_sitter::Parser;
 use tree_sitter_cli::{
     generate, highlight, logger, parse, playground, query, tags, test, test_highlight, test_tags,
     util, wasm,
@@ -106,6 +107,21 @@ fn run() -> Result<()> {
                         )),
                 )
                 .arg(Arg::with_name("no-bindings").long("no-bindings"))
+                .arg(
+                    Arg::with_name("compact-lexer")
+                        .long("compact-lexer")
+                        .help("Emit table-driven lex functions instead of switch statements"),
+                )
+                .arg(
+                    Arg::with_name("shared-ranges")
+                        .long("shared-ranges")
+                        .conflicts_with("compact-lexer")
+                        .help(concat!(
+                            "Emit large character-set tables into a companion file\n",
+                            "(src/character-ranges.c) with content-derived names, so that\n",
+                            "tables can be shared between grammars",
+                        )),
+                )
                 .arg(
                     Arg::with_name("report-states-for-rule")
                         .long("report-states-for-rule")
@@ -137,6 +153,13 @@ fn run() -> Result<()> {
                         .long("timeout")
                         .takes_value(true),
                 )
+                .arg(
+                    Arg::with_name("jobs")
+                        .help("Parse the files using the given number of worker threads (0 = one per CPU)")
+                        .long("jobs")
+                        .short("j")
+                        .takes_value(true),
+                )
                 .arg(&time_arg)
                 .arg(&quiet_arg)
                 .arg(
@@ -197,6 +220,19 @@ fn run() -> Result<()> {
                         .short("u")
                         .help("Update all syntax trees in corpus files with current parser output"),
                 )
+                .arg(
+                    Arg::with_name("jobs")
+                        .long("jobs")
+                        .short("j")
+                        .takes_value(true)
+                        .help("Number of worker threads for running corpus tests (default: one per available core; forced to 1 by --update and --debug)"),
+                )
+                .arg(
+                    Arg::with_name("slowest")
+                        .long("slowest")
+                        .takes_value(true)
+                        .help("Report the N corpus tests that took the longest to parse"),
+                )
                 .arg(&debug_arg)
                 .arg(&debug_build_arg)
                 .arg(&debug_graph_arg),
@@ -297,6 +333,8 @@ fn run() -> Result<()> {
                 abi_version,
                 generate_bindings,
                 report_symbol_name,
+                matches.is_present("compact-lexer"),
+                matches.is_present("shared-ranges"),
             )?;
         }
 
@@ -306,6 +344,18 @@ fn run() -> Result<()> {
             let debug_build = matches.is_present("debug-build");
             let update = matches.is_present("update");
             let filter = matches.value_of("filter");
+            let jobs = match matches.value_of("jobs") {
+                Some(jobs) => jobs
+                    .parse::<usize>()
+                    .map_err(|_| anyhow!("Invalid number of jobs: {}", jobs))?,
+                None => std::thread::available_parallelism().map_or(1, |n| n.get()),
+            };
+            let slowest = match matches.value_of("slowest") {
+                Some(slowest) => slowest
+                    .parse::<usize>()
+                    .map_err(|_| anyhow!("Invalid number of tests to report: {}", slowest))?,
+                None => 0,
+            };
 
             loader.use_debug_build(debug_build);
 
@@ -328,6 +378,8 @@ fn run() -> Result<()> {
                     debug_graph,
                     filter,
                     update,
+                    jobs,
+                    slowest,
                 )?;
             }
 
@@ -379,14 +431,28 @@ fn run() -> Result<()> {
             let should_track_stats = matches.is_present("stat");
             let mut stats = parse::Stats::default();
 
-            for path in paths {
-                let path = Path::new(&path);
-                let language =
-                    loader.select_language(path, &current_dir, matches.value_of("scope"))?;
+            if let Some(jobs) = matches.value_of("jobs") {
+                let jobs = usize::from_str_radix(jobs, 10)
+                    .map_err(|_| anyhow!("Invalid jobs count {}", jobs))?;
+                let jobs = if jobs == 0 {
+                    std::thread::available_parallelism().map_or(1, |n| n.get())
+                } else {
+                    jobs
+                };
+
+                // Select all of the languages up front: the loader needs
+                // mutable access, so it can't be shared with the workers.
+                let mut work_items = Vec::with_capacity(paths.len());
+                for path in &paths {
+                    let path = Path::new(path);
+                    let language =
+                        loader.select_language(path, &current_dir, matches.value_of("scope"))?;
+                    work_items.push((path.to_owned(), language));
+                }
 
-                let this_file_errored = parse::parse_file_at_path(
-                    language,
-                    path,
+                let (parallel_stats, parallel_has_error) = parse::parse_files_at_paths(
+                    &work_items,
+                    jobs,
                     &edits,
                     max_path_length,
                     quiet,
@@ -397,15 +463,39 @@ fn run() -> Result<()> {
                     debug_xml,
                     Some(&cancellation_flag),
                 )?;
-
-                if should_track_stats {
-                    stats.total_parses += 1;
-                    if !this_file_errored {
-                        stats.successful_parses += 1;
+                stats = parallel_stats;
+                has_error = parallel_has_error;
+            } else {
+                let mut parser = Parser::new();
+                for path in paths {
+                    let path = Path::new(&path);
+                    let language =
+                        loader.select_language(path, &current_dir, matches.value_of("scope"))?;
+
+                    let this_file_errored = parse::parse_file_at_path(
+                        &mut parser,
+                        language,
+                        path,
+                        &edits,
+                        max_path_length,
+                        quiet,
+                        time,
+                        timeout,
+                        debug,
+                        debug_graph,
+                        debug_xml,
+                        Some(&cancellation_flag),
+                    )?;
+
+                    if should_track_stats {
+                        stats.total_parses += 1;
+                        if !this_file_errored {
+                            stats.successful_parses += 1;
+                        }
                     }
-                }
 
-                has_error |= this_file_errored;
+                    has_error |= this_file_errored;
+                }
             }
 
             if should_track_stats {
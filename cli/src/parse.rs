@@ -1,10 +1,11 @@
 use super::util;
 use anyhow::{anyhow, Context, Result};
 use std::io::{self, Write};
-use std::path::Path;
-use std::sync::atomic::AtomicUsize;
+use std::path::{Path, PathBuf};
+use std::sync::atomic::{AtomicBool, AtomicUsize, Ordering};
+use std::sync::Mutex;
 use std::time::Instant;
-use std::{fmt, fs, usize};
+use std::{fmt, fs, thread, usize};
 use tree_sitter::{InputEdit, Language, LogType, Parser, Point, Tree};
 
 #[derive(Debug)]
@@ -31,6 +32,7 @@ impl fmt::Display for Stats {
 }
 
 pub fn parse_file_at_path(
+    parser: &mut Parser,
     language: Language,
     path: &Path,
     edits: &Vec<&str>,
@@ -44,7 +46,6 @@ pub fn parse_file_at_path(
     cancellation_flag: Option<&AtomicUsize>,
 ) -> Result<bool> {
     let mut _log_session = None;
-    let mut parser = Parser::new();
     parser.set_language(language)?;
     let mut source_code =
         fs::read(path).with_context(|| format!("Error reading source file {:?}", path))?;
@@ -58,7 +59,7 @@ pub fn parse_file_at_path(
 
     // Render an HTML graph if `--debug-graph` was passed
     if debug_graph {
-        _log_session = Some(util::log_graphs(&mut parser, "log.html")?);
+        _log_session = Some(util::log_graphs(parser, "log.html")?);
     }
     // Log to stderr if `--debug` was passed
     else if debug {
@@ -273,6 +274,86 @@ pub fn parse_file_at_path(
     Ok(false)
 }
 
+pub fn parse_files_at_paths(
+    work_items: &[(PathBuf, Language)],
+    jobs: usize,
+    edits: &Vec<&str>,
+    max_path_length: usize,
+    quiet: bool,
+    print_time: bool,
+    timeout: u64,
+    debug: bool,
+    debug_graph: bool,
+    debug_xml: bool,
+    cancellation_flag: Option<&AtomicUsize>,
+) -> Result<(Stats, bool)> {
+    let next_item = AtomicUsize::new(0);
+    let successful_parses = AtomicUsize::new(0);
+    let total_parses = AtomicUsize::new(0);
+    let has_error = AtomicBool::new(false);
+    let failure: Mutex<Option<anyhow::Error>> = Mutex::new(None);
+
+    // Each worker owns one `Parser` for its whole lifetime and repeatedly
+    // claims the next unparsed file from a shared atomic counter, so the
+    // files are distributed dynamically: a worker that draws several small
+    // files simply claims more of them while another chews on a large one.
+    thread::scope(|scope| {
+        for _ in 0..jobs {
+            scope.spawn(|| {
+                let mut parser = Parser::new();
+                loop {
+                    if failure.lock().unwrap().is_some() {
+                        break;
+                    }
+                    let index = next_item.fetch_add(1, Ordering::SeqCst);
+                    if index >= work_items.len() {
+                        break;
+                    }
+                    let (path, language) = &work_items[index];
+                    match parse_file_at_path(
+                        &mut parser,
+                        *language,
+                        path,
+                        edits,
+                        max_path_length,
+                        quiet,
+                        print_time,
+                        timeout,
+                        debug,
+                        debug_graph,
+                        debug_xml,
+                        cancellation_flag,
+                    ) {
+                        Ok(this_file_errored) => {
+                            total_parses.fetch_add(1, Ordering::Relaxed);
+                            if this_file_errored {
+                                has_error.store(true, Ordering::Relaxed);
+                            } else {
+                                successful_parses.fetch_add(1, Ordering::Relaxed);
+                            }
+                        }
+                        Err(error) => {
+                            *failure.lock().unwrap() = Some(error);
+                            break;
+                        }
+                    }
+                }
+            });
+        }
+    });
+
+    if let Some(error) = failure.into_inner().unwrap() {
+        return Err(error);
+    }
+    Ok((
+        Stats {
+            successful_parses: successful_parses.into_inner(),
+            total_parses: total_parses.into_inner(),
+        },
+        has_error.into_inner(),
+    ))
+}
+
 pub fn perform_edit(tree: &mut Tree, input: &mut Vec<u8>, edit: &Edit) -> InputEdit {
     let start_byte = edit.position;
     let old_end_byte = edit.position + edit.deleted_length;
@@ -11,6 +11,10 @@ use std::fs;
 use std::io::{self, Write};
 use std::path::{Path, PathBuf};
 use std::str;
+use std::sync::atomic::{AtomicUsize, Ordering};
+use std::sync::Mutex;
+use std::thread;
+use std::time::{Duration, Instant};
 use tree_sitter::{Language, LogType, Parser, Query};
 use walkdir::WalkDir;
 
@@ -61,6 +65,8 @@ pub fn run_tests_at_path(
     debug_graph: bool,
     filter: Option<&str>,
     update: bool,
+    jobs: usize,
+    slowest: usize,
 ) -> Result<()> {
     let test_entry = parse_tests(path)?;
     let mut _log_session = None;
@@ -78,17 +84,35 @@ pub fn run_tests_at_path(
         })));
     }
 
+    // Updating corpus files and debug logging both depend on examples
+    // running one at a time, in order, on the one configured parser.
+    let jobs = if update || debug || debug_graph { 1 } else { jobs.max(1) };
+
     let mut failures = Vec::new();
-    let mut corrected_entries = Vec::new();
-    run_tests(
-        &mut parser,
-        test_entry,
-        filter,
-        0,
-        &mut failures,
-        update,
-        &mut corrected_entries,
-    )?;
+    let mut timings = Vec::new();
+    if jobs > 1 {
+        run_tests_parallel(language, test_entry, filter, jobs, &mut failures, &mut timings);
+    } else {
+        let mut corrected_entries = Vec::new();
+        run_tests(
+            &mut parser,
+            test_entry,
+            filter,
+            0,
+            &mut failures,
+            update,
+            &mut corrected_entries,
+            &mut timings,
+        )?;
+    }
+
+    if slowest > 0 && !timings.is_empty() {
+        timings.sort_by(|a, b| b.1.cmp(&a.1));
+        println!("\nslowest {} tests:", slowest.min(timings.len()));
+        for (name, duration) in timings.iter().take(slowest) {
+            println!("  {:>9.3} ms  {}", duration.as_secs_f64() * 1000.0, name);
+        }
+    }
 
     if failures.len() > 0 {
         println!("");
@@ -172,6 +196,145 @@ pub fn print_diff(actual: &String, expected: &String) {
     println!("");
 }
 
+// A corpus test tree flattened into display order, so that examples can be
+// parsed out of order on multiple threads while the report is still printed
+// exactly as the sequential runner would.
+enum FlatTestEntry {
+    Group {
+        name: String,
+        indent_level: i32,
+    },
+    Example {
+        name: String,
+        input: Vec<u8>,
+        output: String,
+        has_fields: bool,
+        indent_level: i32,
+    },
+}
+
+fn flatten_tests(
+    test_entry: TestEntry,
+    filter: Option<&str>,
+    indent_level: i32,
+    result: &mut Vec<FlatTestEntry>,
+) {
+    match test_entry {
+        TestEntry::Example {
+            name,
+            input,
+            output,
+            has_fields,
+        } => {
+            if let Some(filter) = filter {
+                if !name.contains(filter) {
+                    return;
+                }
+            }
+            result.push(FlatTestEntry::Example {
+                name,
+                input,
+                output,
+                has_fields,
+                indent_level,
+            });
+        }
+        TestEntry::Group { name, children, .. } => {
+            if indent_level > 0 {
+                result.push(FlatTestEntry::Group { name, indent_level });
+            }
+            for child in children {
+                flatten_tests(child, filter, indent_level + 1, result);
+            }
+        }
+    }
+}
+
+fn run_tests_parallel(
+    language: Language,
+    test_entry: TestEntry,
+    filter: Option<&str>,
+    jobs: usize,
+    failures: &mut Vec<(String, String, String)>,
+    timings: &mut Vec<(String, Duration)>,
+) {
+    let mut entries = Vec::new();
+    flatten_tests(test_entry, filter, 0, &mut entries);
+    let example_indices = entries
+        .iter()
+        .enumerate()
+        .filter(|(_, entry)| matches!(entry, FlatTestEntry::Example { .. }))
+        .map(|(i, _)| i)
+        .collect::<Vec<_>>();
+
+    // Farm the parsing out to a pool of workers, each with its own parser.
+    // The examples are read-only, so the only coordination needed is the
+    // index of the next example to claim.
+    let next_index = AtomicUsize::new(0);
+    let results = Mutex::new(Vec::with_capacity(example_indices.len()));
+    thread::scope(|scope| {
+        for _ in 0..jobs.min(example_indices.len()) {
+            scope.spawn(|| {
+                let mut parser = Parser::new();
+                parser.set_language(language).unwrap();
+                let mut local_results = Vec::new();
+                loop {
+                    let index = next_index.fetch_add(1, Ordering::SeqCst);
+                    if index >= example_indices.len() {
+                        break;
+                    }
+                    if let FlatTestEntry::Example {
+                        input, has_fields, ..
+                    } = &entries[example_indices[index]]
+                    {
+                        let start_time = Instant::now();
+                        let tree = parser.parse(input, None).unwrap();
+                        let mut actual = tree.root_node().to_sexp();
+                        if !*has_fields {
+                            actual = strip_sexp_fields(actual);
+                        }
+                        local_results.push((index, actual, start_time.elapsed()));
+                    }
+                }
+                results.lock().unwrap().append(&mut local_results);
+            });
+        }
+    });
+    let mut results = results.into_inner().unwrap();
+    results.sort_unstable_by_key(|(index, ..)| *index);
+
+    // Print the report in corpus order, as the sequential runner does.
+    let mut results = results.into_iter();
+    for entry in &entries {
+        match entry {
+            FlatTestEntry::Group { name, indent_level } => {
+                for _ in 0..*indent_level {
+                    print!("  ");
+                }
+                println!("{}:", name);
+            }
+            FlatTestEntry::Example {
+                name,
+                output,
+                indent_level,
+                ..
+            } => {
+                let (_, actual, duration) = results.next().unwrap();
+                timings.push((name.clone(), duration));
+                for _ in 0..*indent_level {
+                    print!("  ");
+                }
+                if actual == *output {
+                    println!("✓ {}", Colour::Green.paint(name));
+                } else {
+                    println!("✗ {}", Colour::Red.paint(name));
+                    failures.push((name.clone(), actual, output.clone()));
+                }
+            }
+        }
+    }
+}
+
 fn run_tests(
     parser: &mut Parser,
     test_entry: TestEntry,
@@ -180,6 +343,7 @@ fn run_tests(
     failures: &mut Vec<(String, String, String)>,
     update: bool,
     corrected_entries: &mut Vec<(String, String, String)>,
+    timings: &mut Vec<(String, Duration)>,
 ) -> Result<()> {
     match test_entry {
         TestEntry::Example {
@@ -198,7 +362,9 @@ fn run_tests(
                     return Ok(());
                 }
             }
+            let start_time = Instant::now();
             let tree = parser.parse(&input, None).unwrap();
+            timings.push((name.clone(), start_time.elapsed()));
             let mut actual = tree.root_node().to_sexp();
             if !has_fields {
                 actual = strip_sexp_fields(actual);
@@ -249,6 +415,7 @@ fn run_tests(
                     failures,
                     update,
                     corrected_entries,
+                    timings,
                 )?;
             }
 
@@ -5,7 +5,7 @@ use super::helpers::{
     fixtures::{get_language, get_test_grammar, get_test_language},
 };
 use crate::{
-    generate::generate_parser_for_grammar,
+    generate::{generate_parser_for_grammar, generate_parser_for_grammar_with_abi},
     parse::{perform_edit, Edit},
 };
 use std::{
@@ -1280,6 +1280,100 @@ fn test_parsing_with_included_ranges_and_missing_tokens() {
     assert_eq!(root.child(3).unwrap().start_byte(), 4);
 }
 
+#[test]
+fn test_parsing_with_an_upgraded_language() {
+    let grammar = r#"
+        {
+            "name": "test_grammar_for_language_upgrade",
+            "extras": [
+                {"type": "PATTERN", "value": "\\s"}
+            ],
+            "rules": {
+                "program": {
+                    "type": "REPEAT1",
+                    "content": {"type": "SYMBOL", "name": "assignment"}
+                },
+                "assignment": {
+                    "type": "SEQ",
+                    "members": [
+                        {
+                            "type": "FIELD",
+                            "name": "left",
+                            "content": {"type": "SYMBOL", "name": "identifier"}
+                        },
+                        {"type": "STRING", "value": "="},
+                        {
+                            "type": "FIELD",
+                            "name": "right",
+                            "content": {"type": "SYMBOL", "name": "_expression"}
+                        },
+                        {"type": "STRING", "value": ";"}
+                    ]
+                },
+                "_expression": {
+                    "type": "CHOICE",
+                    "members": [
+                        {"type": "SYMBOL", "name": "identifier"},
+                        {"type": "SYMBOL", "name": "number"}
+                    ]
+                },
+                "identifier": {"type": "PATTERN", "value": "[a-z]+"},
+                "number": {"type": "PATTERN", "value": "\\d+"}
+            }
+        }
+    "#;
+
+    // Generate the parser with the oldest supported ABI version, so that the
+    // upgrade has to synthesize everything the current version added: the
+    // primary-state ids, the sorted symbol-name index, and the dense rows
+    // for the small parse table.
+    let (parser_name, parser_code) = generate_parser_for_grammar_with_abi(grammar, 13).unwrap();
+    let language = get_test_language(&parser_name, &parser_code, None);
+    assert_eq!(language.version(), 13);
+
+    allocations::record(|| {
+        let upgraded = language.upgrade().unwrap();
+        assert_eq!(
+            upgraded.language().version(),
+            tree_sitter::LANGUAGE_VERSION
+        );
+
+        // The upgraded table parses identically to the original.
+        let source_code = "first = second; third = 1234; fourth = fifth;";
+        let mut parser = Parser::new();
+        parser.set_language(language).unwrap();
+        let tree = parser.parse(source_code, None).unwrap();
+        parser.set_language(upgraded.language()).unwrap();
+        let upgraded_tree = parser.parse(source_code, None).unwrap();
+        assert_eq!(
+            upgraded_tree.root_node().to_sexp(),
+            tree.root_node().to_sexp()
+        );
+
+        // Symbol and field lookups also behave identically, in both
+        // directions.
+        assert_eq!(
+            upgraded.language().node_kind_count(),
+            language.node_kind_count()
+        );
+        for id in 0..language.node_kind_count() as u16 {
+            let kind = language.node_kind_for_id(id).unwrap();
+            assert_eq!(upgraded.language().node_kind_for_id(id), Some(kind));
+            let named = language.node_kind_is_named(id);
+            assert_eq!(
+                upgraded.language().id_for_node_kind(kind, named),
+                language.id_for_node_kind(kind, named)
+            );
+        }
+        assert_eq!(upgraded.language().field_count(), language.field_count());
+        for id in 1..=language.field_count() as u16 {
+            let name = language.field_name_for_id(id).unwrap();
+            assert_eq!(upgraded.language().field_name_for_id(id), Some(name));
+            assert_eq!(upgraded.language().field_id_for_name(name), Some(id));
+        }
+    });
+}
+
 fn simple_range(start: usize, end: usize) -> Range {
     Range {
         start_byte: start,
@@ -1,8 +1,9 @@
 use super::helpers::{
     allocations,
-    fixtures::get_language,
+    fixtures::{get_language, get_test_language},
     query_helpers::{Match, Pattern},
 };
+use crate::generate::generate_parser_for_grammar;
 use lazy_static::lazy_static;
 use rand::{prelude::StdRng, SeedableRng};
 use std::{env, fmt::Write};
@@ -1786,6 +1787,295 @@ fn test_query_matches_with_alternatives_and_too_many_permutations_to_track() {
     });
 }
 
+#[test]
+fn test_query_matches_with_limited_capture_memory() {
+    let (parser_name, parser_code) = generate_parser_for_grammar(
+        r#"
+        {
+            "name": "test_grammar_for_capture_memory",
+            "extras": [
+                {"type": "PATTERN", "value": "\\s"}
+            ],
+            "rules": {
+                "program": {
+                    "type": "REPEAT1",
+                    "content": {"type": "SYMBOL", "name": "identifier"}
+                },
+                "identifier": {"type": "PATTERN", "value": "[a-z]"}
+            }
+        }
+        "#,
+    )
+    .unwrap();
+    let language = get_test_language(&parser_name, &parser_code, None);
+
+    allocations::record(|| {
+        // Three sibling captures, so that every in-progress match outgrows the
+        // states' inline capture storage and holds a list from the pool.
+        let query = Query::new(
+            language,
+            "((identifier) @x (identifier) @y (identifier) @z)",
+        )
+        .unwrap();
+
+        let source = "a b c d e";
+        let mut parser = Parser::new();
+        parser.set_language(language).unwrap();
+        let tree = parser.parse(source, None).unwrap();
+
+        // With an unlimited budget, every combination of three identifiers
+        // is found.
+        let mut cursor = QueryCursor::new();
+        assert_eq!(cursor.max_memory(), u32::MAX);
+        let matches = cursor.matches(&query, tree.root_node(), source.as_bytes());
+        assert_eq!(
+            collect_matches(matches, &query, source),
+            &[
+                (0, vec![("x", "a"), ("y", "b"), ("z", "c")]),
+                (0, vec![("x", "a"), ("y", "b"), ("z", "d")]),
+                (0, vec![("x", "a"), ("y", "c"), ("z", "d")]),
+                (0, vec![("x", "b"), ("y", "c"), ("z", "d")]),
+                (0, vec![("x", "a"), ("y", "b"), ("z", "e")]),
+                (0, vec![("x", "a"), ("y", "c"), ("z", "e")]),
+                (0, vec![("x", "a"), ("y", "d"), ("z", "e")]),
+                (0, vec![("x", "b"), ("y", "c"), ("z", "e")]),
+                (0, vec![("x", "b"), ("y", "d"), ("z", "e")]),
+                (0, vec![("x", "c"), ("y", "d"), ("z", "e")]),
+            ],
+        );
+        assert_eq!(cursor.did_exceed_match_limit(), false);
+
+        // With a budget that only has room for a single capture list, the
+        // pool is exhausted as soon as the matching forks: the permutations
+        // that can't retain a capture list are dropped, and only the family
+        // of matches whose state acquired the one list is returned.
+        let mut cursor = QueryCursor::new();
+        cursor.set_max_memory(256);
+        assert_eq!(cursor.max_memory(), 256);
+        let matches = cursor.matches(&query, tree.root_node(), source.as_bytes());
+        assert_eq!(
+            collect_matches(matches, &query, source),
+            &[
+                (0, vec![("x", "a"), ("y", "b"), ("z", "c")]),
+                (0, vec![("x", "a"), ("y", "b"), ("z", "d")]),
+                (0, vec![("x", "a"), ("y", "b"), ("z", "e")]),
+            ],
+        );
+        assert_eq!(cursor.did_exceed_match_limit(), true);
+    });
+}
+
+const IDENTIFIER_LIST_GRAMMAR: &'static str = r#"
+    {
+        "name": "test_grammar_identifier_list",
+        "extras": [
+            {"type": "PATTERN", "value": "\\s"}
+        ],
+        "rules": {
+            "program": {
+                "type": "REPEAT1",
+                "content": {"type": "SYMBOL", "name": "identifier"}
+            },
+            "identifier": {"type": "PATTERN", "value": "[a-z]+"}
+        }
+    }
+"#;
+
+#[test]
+fn test_query_matches_returned_inline_capture_invalidation() {
+    let (parser_name, parser_code) =
+        generate_parser_for_grammar(IDENTIFIER_LIST_GRAMMAR).unwrap();
+    let language = get_test_language(&parser_name, &parser_code, None);
+
+    allocations::record(|| {
+        let query = Query::new(language, "(identifier) @id").unwrap();
+        let source = "alpha beta gamma";
+        let mut parser = Parser::new();
+        parser.set_language(language).unwrap();
+        let tree = parser.parse(source, None).unwrap();
+
+        let mut cursor = QueryCursor::new();
+        let mut matches = cursor.matches(&query, tree.root_node(), source.as_bytes());
+
+        // Matches with at most two captures are returned through scratch
+        // space owned by the cursor, so a match's captures are only valid
+        // until the cursor advances. Data copied out of a capture, like the
+        // node itself, stays valid.
+        let first = matches.next().unwrap();
+        let first_node = first.captures[0].node;
+        assert_eq!(&source[first.captures[0].node.byte_range()], "alpha");
+
+        let second = matches.next().unwrap();
+        assert_eq!(&source[second.captures[0].node.byte_range()], "beta");
+
+        // Advancing overwrote the scratch space: the captures still held by
+        // the first match now show the second match's capture.
+        assert_eq!(&source[first.captures[0].node.byte_range()], "beta");
+        assert_eq!(&source[first_node.byte_range()], "alpha");
+    });
+}
+
+#[test]
+fn test_query_matches_crossing_the_inline_capture_spill_boundary() {
+    let (parser_name, parser_code) =
+        generate_parser_for_grammar(IDENTIFIER_LIST_GRAMMAR).unwrap();
+    let language = get_test_language(&parser_name, &parser_code, None);
+
+    allocations::record(|| {
+        let source = "a b c d";
+        let mut parser = Parser::new();
+        parser.set_language(language).unwrap();
+        let tree = parser.parse(source, None).unwrap();
+
+        // Two captures fit in a state's inline storage; a third forces the
+        // captures out into a list from the pool partway through each match.
+        // Both sides of the boundary must produce complete capture lists.
+        let query = Query::new(language, "((identifier) @a (identifier) @b)").unwrap();
+        let mut cursor = QueryCursor::new();
+        let matches = cursor.matches(&query, tree.root_node(), source.as_bytes());
+        assert_eq!(
+            collect_matches(matches, &query, source),
+            &[
+                (0, vec![("a", "a"), ("b", "b")]),
+                (0, vec![("a", "a"), ("b", "c")]),
+                (0, vec![("a", "b"), ("b", "c")]),
+                (0, vec![("a", "a"), ("b", "d")]),
+                (0, vec![("a", "b"), ("b", "d")]),
+                (0, vec![("a", "c"), ("b", "d")]),
+            ],
+        );
+
+        let query = Query::new(
+            language,
+            "((identifier) @a (identifier) @b (identifier) @c)",
+        )
+        .unwrap();
+        let mut cursor = QueryCursor::new();
+        let matches = cursor.matches(&query, tree.root_node(), source.as_bytes());
+        assert_eq!(
+            collect_matches(matches, &query, source),
+            &[
+                (0, vec![("a", "a"), ("b", "b"), ("c", "c")]),
+                (0, vec![("a", "a"), ("b", "b"), ("c", "d")]),
+                (0, vec![("a", "a"), ("b", "c"), ("c", "d")]),
+                (0, vec![("a", "b"), ("b", "c"), ("c", "d")]),
+            ],
+        );
+    });
+}
+
+#[test]
+fn test_query_serialization_round_trip() {
+    let (parser_name, parser_code) =
+        generate_parser_for_grammar(IDENTIFIER_LIST_GRAMMAR).unwrap();
+    let language = get_test_language(&parser_name, &parser_code, None);
+
+    allocations::record(|| {
+        let query = Query::new(
+            language,
+            "((identifier) @first (identifier) @second (#eq? @first @second))",
+        )
+        .unwrap();
+
+        let buffer = query.serialize();
+        let copy = Query::deserialize(language, &buffer).unwrap();
+        assert_eq!(copy.pattern_count(), query.pattern_count());
+        assert_eq!(copy.capture_names(), query.capture_names());
+
+        // The deserialized query behaves like the original, including its
+        // text predicates, which are re-derived from the serialized steps.
+        let source = "one two one three two";
+        let mut parser = Parser::new();
+        parser.set_language(language).unwrap();
+        let tree = parser.parse(source, None).unwrap();
+        let mut cursor = QueryCursor::new();
+        let matches = cursor.matches(&query, tree.root_node(), source.as_bytes());
+        let expected = collect_matches(matches, &query, source);
+        assert_eq!(
+            expected,
+            &[
+                (0, vec![("first", "one"), ("second", "one")]),
+                (0, vec![("first", "two"), ("second", "two")]),
+            ],
+        );
+        let mut cursor = QueryCursor::new();
+        let matches = cursor.matches(&copy, tree.root_node(), source.as_bytes());
+        assert_eq!(collect_matches(matches, &copy, source), expected);
+    });
+}
+
+#[test]
+fn test_query_serialization_rejects_malformed_buffers() {
+    let (parser_name, parser_code) =
+        generate_parser_for_grammar(IDENTIFIER_LIST_GRAMMAR).unwrap();
+    let language = get_test_language(&parser_name, &parser_code, None);
+    let (other_parser_name, other_parser_code) = generate_parser_for_grammar(
+        r#"
+        {
+            "name": "test_grammar_identifier_list_other",
+            "rules": {
+                "word": {"type": "PATTERN", "value": "\\w+"}
+            }
+        }
+        "#,
+    )
+    .unwrap();
+    let other_language = get_test_language(&other_parser_name, &other_parser_code, None);
+
+    allocations::record(|| {
+        let query = Query::new(
+            language,
+            "((identifier) @first (identifier) @second (#eq? @first @second))",
+        )
+        .unwrap();
+        let buffer = query.serialize();
+
+        // Every proper prefix of the buffer must be rejected.
+        for length in 0..buffer.len() {
+            assert!(
+                Query::deserialize(language, &buffer[..length]).is_none(),
+                "expected deserialization to fail for a buffer truncated to {} bytes",
+                length
+            );
+        }
+
+        // Corrupting any byte of the header — the magic, the format and
+        // struct-layout versions, the language fingerprint, and the
+        // wildcard root pattern count, which indexes into the pattern map
+        // — must be rejected.
+        for i in 0..36 {
+            let mut corrupted = buffer.clone();
+            corrupted[i] ^= 0xFF;
+            assert!(
+                Query::deserialize(language, &corrupted).is_none(),
+                "expected deserialization to fail with header byte {} corrupted",
+                i
+            );
+        }
+
+        // An element count that exceeds the remaining buffer must be
+        // rejected. The first array's count is stored right after the
+        // 36-byte header.
+        let mut corrupted = buffer.clone();
+        corrupted[36..40].copy_from_slice(&u32::MAX.to_le_bytes());
+        assert!(Query::deserialize(language, &corrupted).is_none());
+
+        // So must a count whose product with the element size wraps around
+        // in 32 bits: give the 8-byte `Slice` array a count of 2^30, whose
+        // byte size truncates to zero.
+        let character_count =
+            u32::from_le_bytes([buffer[36], buffer[37], buffer[38], buffer[39]]) as usize;
+        let slice_count_offset = 40 + character_count;
+        let mut corrupted = buffer.clone();
+        corrupted[slice_count_offset..slice_count_offset + 4]
+            .copy_from_slice(&0x4000_0000u32.to_le_bytes());
+        assert!(Query::deserialize(language, &corrupted).is_none());
+
+        // A buffer produced for a different language must be rejected.
+        assert!(Query::deserialize(other_language, &buffer).is_none());
+    });
+}
+
 #[test]
 fn test_query_matches_with_anonymous_tokens() {
     allocations::record(|| {
@@ -1,8 +1,10 @@
+use super::helpers::allocations;
 use super::helpers::edits::invert_edit;
-use super::helpers::fixtures::get_language;
+use super::helpers::fixtures::{get_language, get_test_grammar, get_test_language};
+use crate::generate::generate_parser_for_grammar;
 use crate::parse::{perform_edit, Edit};
 use std::str;
-use tree_sitter::{InputEdit, Parser, Point, Range, Tree};
+use tree_sitter::{InputEdit, Node, Parser, Point, Range, Tree, TreeDiffEdit, TreeDiffEditType};
 
 #[test]
 fn test_tree_edit() {
@@ -531,6 +533,445 @@ fn test_get_changed_ranges() {
     }
 }
 
+const EXPRESSION_GRAMMAR: &'static str = r#"
+    {
+        "name": "serialization_test",
+        "extras": [
+            {"type": "PATTERN", "value": "\\s"}
+        ],
+        "rules": {
+            "program": {
+                "type": "REPEAT1",
+                "content": {"type": "SYMBOL", "name": "_expression"}
+            },
+            "_expression": {
+                "type": "CHOICE",
+                "members": [
+                    {"type": "SYMBOL", "name": "sum"},
+                    {"type": "SYMBOL", "name": "identifier"},
+                    {"type": "SYMBOL", "name": "number"}
+                ]
+            },
+            "sum": {
+                "type": "PREC_LEFT",
+                "value": 1,
+                "content": {
+                    "type": "SEQ",
+                    "members": [
+                        {"type": "SYMBOL", "name": "_expression"},
+                        {"type": "STRING", "value": "+"},
+                        {"type": "SYMBOL", "name": "_expression"}
+                    ]
+                }
+            },
+            "identifier": {"type": "PATTERN", "value": "[a-z]+"},
+            "number": {"type": "PATTERN", "value": "\\d+"}
+        }
+    }
+"#;
+
+#[test]
+fn test_tree_serialization_round_trip() {
+    let (parser_name, parser_code) = generate_parser_for_grammar(EXPRESSION_GRAMMAR).unwrap();
+    let language = get_test_language(&parser_name, &parser_code, None);
+
+    allocations::record(|| {
+        let mut parser = Parser::new();
+        parser.set_language(language).unwrap();
+        let mut source_code = b"abc + defg + 12345 hij 678".to_vec();
+        let mut tree = parser.parse(&source_code, None).unwrap();
+
+        let buffer = tree.serialize();
+        let mut copy = Tree::deserialize(language, &buffer).unwrap();
+        assert_eq!(copy.root_node().to_sexp(), tree.root_node().to_sexp());
+        assert_nodes_equal(tree.root_node(), copy.root_node());
+
+        // The deserialized tree supports the same operations as the
+        // original: edit both trees identically and use each one as the
+        // basis for an incremental reparse.
+        let mut copy_source_code = source_code.clone();
+        for (tree, source_code) in [
+            (&mut tree, &mut source_code),
+            (&mut copy, &mut copy_source_code),
+        ] {
+            let edit = Edit {
+                position: index_of(source_code, "defg"),
+                deleted_length: 4,
+                inserted_text: b"de + 100".to_vec(),
+            };
+            perform_edit(tree, source_code, &edit);
+        }
+        let new_tree = parser.parse(&source_code, Some(&tree)).unwrap();
+        let new_copy = parser.parse(&copy_source_code, Some(&copy)).unwrap();
+        assert_eq!(
+            new_copy.root_node().to_sexp(),
+            new_tree.root_node().to_sexp()
+        );
+        assert_nodes_equal(new_tree.root_node(), new_copy.root_node());
+    });
+}
+
+#[test]
+fn test_tree_serialization_round_trip_with_external_scanner_states() {
+    let (grammar, path) = get_test_grammar("uses_current_column");
+    let (parser_name, parser_code) = generate_parser_for_grammar(&grammar).unwrap();
+    let language = get_test_language(&parser_name, &parser_code, path.as_deref());
+
+    allocations::record(|| {
+        let mut parser = Parser::new();
+        parser.set_language(language).unwrap();
+
+        // Deeply nested `do` expressions, so that the scanner's serialized
+        // indent stack outgrows `ExternalScannerState`'s inline storage and
+        // the external tokens' states take the heap-allocated path. The
+        // scanner stores one `int8_t` column per level, so keep the columns
+        // small by nesting with bare `do` tokens.
+        let mut source_code = String::new();
+        for _ in 0..28 {
+            source_code.push_str("do ");
+        }
+        source_code.push_str("b\n");
+        let tree = parser.parse(&source_code, None).unwrap();
+        assert!(!tree.root_node().has_error());
+
+        let buffer = tree.serialize();
+        let copy = Tree::deserialize(language, &buffer).unwrap();
+        assert_eq!(copy.root_node().to_sexp(), tree.root_node().to_sexp());
+        assert_nodes_equal(tree.root_node(), copy.root_node());
+
+        // Truncating the buffer anywhere — including in the middle of an
+        // external token's state — must fail cleanly, without leaks.
+        for length in 0..buffer.len() {
+            assert!(
+                Tree::deserialize(language, &buffer[..length]).is_none(),
+                "expected deserialization to fail for a buffer truncated to {} bytes",
+                length
+            );
+        }
+    });
+}
+
+#[test]
+fn test_tree_serialization_rejects_malformed_buffers() {
+    let (parser_name, parser_code) = generate_parser_for_grammar(EXPRESSION_GRAMMAR).unwrap();
+    let language = get_test_language(&parser_name, &parser_code, None);
+    let (other_parser_name, other_parser_code) = generate_parser_for_grammar(
+        r#"
+        {
+            "name": "serialization_test_other",
+            "rules": {
+                "word": {"type": "PATTERN", "value": "\\w+"}
+            }
+        }
+        "#,
+    )
+    .unwrap();
+    let other_language = get_test_language(&other_parser_name, &other_parser_code, None);
+
+    allocations::record(|| {
+        let mut parser = Parser::new();
+        parser.set_language(language).unwrap();
+        let tree = parser.parse("abc + defg + 12345", None).unwrap();
+        let buffer = tree.serialize();
+
+        // Every proper prefix of the buffer must be rejected.
+        for length in 0..buffer.len() {
+            assert!(
+                Tree::deserialize(language, &buffer[..length]).is_none(),
+                "expected deserialization to fail for a buffer truncated to {} bytes",
+                length
+            );
+        }
+
+        // Every field of the header is validated, so corrupting any single
+        // byte of it must be rejected.
+        let header_size = 44;
+        for i in 0..header_size {
+            let mut corrupted = buffer.clone();
+            corrupted[i] ^= 0xFF;
+            assert!(
+                Tree::deserialize(language, &corrupted).is_none(),
+                "expected deserialization to fail with header byte {} corrupted",
+                i
+            );
+        }
+
+        // A node record with an unknown tag must be rejected.
+        let included_range_count =
+            u32::from_le_bytes([buffer[36], buffer[37], buffer[38], buffer[39]]) as usize;
+        let first_node_offset = header_size + included_range_count * 24;
+        let mut corrupted = buffer.clone();
+        corrupted[first_node_offset] = 0xFF;
+        assert!(Tree::deserialize(language, &corrupted).is_none());
+
+        // A node whose child count exceeds the number of records remaining
+        // in the buffer must be rejected: claim the tree consists of just
+        // the root node, whose children then can't be accounted for.
+        let mut corrupted = buffer.clone();
+        corrupted[40..44].copy_from_slice(&1u32.to_le_bytes());
+        assert!(Tree::deserialize(language, &corrupted).is_none());
+
+        // A buffer produced with a different language must be rejected.
+        assert!(Tree::deserialize(other_language, &buffer).is_none());
+    });
+}
+
+#[test]
+fn test_tree_edit_batch() {
+    let (parser_name, parser_code) = generate_parser_for_grammar(EXPRESSION_GRAMMAR).unwrap();
+    let language = get_test_language(&parser_name, &parser_code, None);
+    let mut parser = Parser::new();
+    parser.set_language(language).unwrap();
+
+    let source_code = b"aa + bb\ncc + dd\nee + ff".to_vec();
+    let tree = parser.parse(&source_code, None).unwrap();
+
+    // Several edits within the same child.
+    check_edit_batch(
+        &mut parser,
+        &tree,
+        &source_code,
+        &[
+            (index_of(&source_code, "cc"), 2, b"c".to_vec()),
+            (index_of(&source_code, "dd"), 2, b"dddd".to_vec()),
+        ],
+    );
+
+    // An edit that spans the boundary between two children, alongside an
+    // edit within another child.
+    check_edit_batch(
+        &mut parser,
+        &tree,
+        &source_code,
+        &[
+            (index_of(&source_code, "bb"), 5, b"gg".to_vec()),
+            (index_of(&source_code, "ff"), 2, b"hh".to_vec()),
+        ],
+    );
+
+    // Pure insertions at the boundaries between padding and content.
+    check_edit_batch(
+        &mut parser,
+        &tree,
+        &source_code,
+        &[
+            (0, 0, b"  ".to_vec()),
+            (index_of(&source_code, "cc"), 0, b"x".to_vec()),
+            (index_of(&source_code, " + dd"), 0, b"yy".to_vec()),
+        ],
+    );
+}
+
+#[test]
+fn test_tree_diff() {
+    let (parser_name, parser_code) = generate_parser_for_grammar(EXPRESSION_GRAMMAR).unwrap();
+    let language = get_test_language(&parser_name, &parser_code, None);
+
+    allocations::record(|| {
+        let mut parser = Parser::new();
+        parser.set_language(language).unwrap();
+        let identifier = language.id_for_node_kind("identifier", true);
+        let number = language.id_for_node_kind("number", true);
+        let zero_range = Range {
+            start_byte: 0,
+            end_byte: 0,
+            start_point: Point::new(0, 0),
+            end_point: Point::new(0, 0),
+        };
+
+        // Renaming a single token pairs the old and new identifiers in one
+        // update; the enclosing `program`, whose only change is inside that
+        // child, is not itself reported.
+        let mut source_code = b"abc + def ghi 12345".to_vec();
+        let mut tree = parser.parse(&source_code, None).unwrap();
+        let position = index_of(&source_code, "ghi");
+        let edits = get_tree_diff(
+            &mut parser,
+            &mut tree,
+            &mut source_code,
+            Edit {
+                position,
+                deleted_length: 3,
+                inserted_text: b"xyz".to_vec(),
+            },
+        );
+        assert_eq!(
+            edits,
+            vec![TreeDiffEdit {
+                kind: TreeDiffEditType::Update,
+                old_symbol: identifier,
+                new_symbol: identifier,
+                old_range: range_of(&source_code, "xyz"),
+                new_range: range_of(&source_code, "xyz"),
+            }]
+        );
+
+        // Inserting a new expression yields one insert with the old side
+        // zeroed, and no spurious updates on the surrounding siblings.
+        let position = index_of(&source_code, "12345");
+        let edits = get_tree_diff(
+            &mut parser,
+            &mut tree,
+            &mut source_code,
+            Edit {
+                position,
+                deleted_length: 0,
+                inserted_text: b"jkl ".to_vec(),
+            },
+        );
+        assert_eq!(
+            edits,
+            vec![TreeDiffEdit {
+                kind: TreeDiffEditType::Insert,
+                old_symbol: 0,
+                new_symbol: identifier,
+                old_range: zero_range,
+                new_range: range_of(&source_code, "jkl"),
+            }]
+        );
+
+        // Deleting a whole child of `program` yields one delete with the new
+        // side zeroed. The old range reflects the edited old tree, where the
+        // deleted node has collapsed onto the edit position.
+        let position = index_of(&source_code, " 12345");
+        let edits = get_tree_diff(
+            &mut parser,
+            &mut tree,
+            &mut source_code,
+            Edit {
+                position,
+                deleted_length: 6,
+                inserted_text: Vec::new(),
+            },
+        );
+        assert_eq!(
+            edits,
+            vec![TreeDiffEdit {
+                kind: TreeDiffEditType::Delete,
+                old_symbol: number,
+                new_symbol: 0,
+                old_range: Range {
+                    start_byte: position,
+                    end_byte: position,
+                    start_point: Point::new(0, position),
+                    end_point: Point::new(0, position),
+                },
+                new_range: zero_range,
+            }]
+        );
+    });
+}
+
+// Check that applying a batch of edits with `Tree::edit_batch` leaves the
+// tree in exactly the same state as applying them one at a time, from last
+// to first, and that both trees then drive an incremental reparse to the
+// same result. Both trees are copy-on-write snapshots of the given tree,
+// so this also covers editing trees whose nodes are shared; the shared
+// original must come through unscathed.
+fn check_edit_batch(
+    parser: &mut Parser,
+    tree: &Tree,
+    source_code: &Vec<u8>,
+    edits: &[(usize, usize, Vec<u8>)],
+) {
+    let input_edits = edits
+        .iter()
+        .map(|(position, deleted_length, inserted_text)| {
+            input_edit(source_code, *position, *deleted_length, inserted_text)
+        })
+        .collect::<Vec<_>>();
+
+    let mut batch_tree = tree.clone();
+    batch_tree.edit_batch(&input_edits);
+
+    let mut sequential_tree = tree.clone();
+    let mut sorted_edits = input_edits.clone();
+    sorted_edits.sort_by_key(|edit| edit.start_byte);
+    for edit in sorted_edits.iter().rev() {
+        sequential_tree.edit(edit);
+    }
+
+    assert_nodes_equal(batch_tree.root_node(), sequential_tree.root_node());
+
+    let pristine_tree = parser.parse(source_code, None).unwrap();
+    assert_nodes_equal(tree.root_node(), pristine_tree.root_node());
+
+    let mut new_source_code = source_code.clone();
+    let mut sorted_edits = edits.to_vec();
+    sorted_edits.sort_by_key(|edit| edit.0);
+    for (position, deleted_length, inserted_text) in sorted_edits.iter().rev() {
+        new_source_code.splice(
+            *position..*position + *deleted_length,
+            inserted_text.iter().cloned(),
+        );
+    }
+    let batch_result = parser.parse(&new_source_code, Some(&batch_tree)).unwrap();
+    let sequential_result = parser
+        .parse(&new_source_code, Some(&sequential_tree))
+        .unwrap();
+    assert_nodes_equal(batch_result.root_node(), sequential_result.root_node());
+    let fresh_result = parser.parse(&new_source_code, None).unwrap();
+    assert_eq!(
+        batch_result.root_node().to_sexp(),
+        fresh_result.root_node().to_sexp()
+    );
+}
+
+// Build an `InputEdit` for replacing `deleted_length` bytes with
+// `inserted_text` at `position`, with all coordinates expressed in terms of
+// the unedited source.
+fn input_edit(
+    source_code: &[u8],
+    position: usize,
+    deleted_length: usize,
+    inserted_text: &[u8],
+) -> InputEdit {
+    let start_byte = position;
+    let old_end_byte = position + deleted_length;
+    let new_end_byte = position + inserted_text.len();
+    let mut edited_prefix = source_code[..position].to_vec();
+    edited_prefix.extend_from_slice(inserted_text);
+    InputEdit {
+        start_byte,
+        old_end_byte,
+        new_end_byte,
+        start_position: position_for_offset(source_code, start_byte),
+        old_end_position: position_for_offset(source_code, old_end_byte),
+        new_end_position: position_for_offset(&edited_prefix, new_end_byte),
+    }
+}
+
+fn position_for_offset(text: &[u8], offset: usize) -> Point {
+    let mut row = 0;
+    let mut column = 0;
+    for &byte in &text[..offset] {
+        if byte == b'\n' {
+            row += 1;
+            column = 0;
+        } else {
+            column += 1;
+        }
+    }
+    Point::new(row, column)
+}
+
+fn assert_nodes_equal(left: Node, right: Node) {
+    assert_eq!(left.kind_id(), right.kind_id());
+    assert_eq!(left.start_byte(), right.start_byte());
+    assert_eq!(left.end_byte(), right.end_byte());
+    assert_eq!(left.start_position(), right.start_position());
+    assert_eq!(left.end_position(), right.end_position());
+    assert_eq!(left.is_named(), right.is_named());
+    assert_eq!(left.is_extra(), right.is_extra());
+    assert_eq!(left.is_missing(), right.is_missing());
+    assert_eq!(left.has_changes(), right.has_changes());
+    assert_eq!(left.has_error(), right.has_error());
+    assert_eq!(left.child_count(), right.child_count());
+    for i in 0..left.child_count() {
+        assert_nodes_equal(left.child(i).unwrap(), right.child(i).unwrap());
+    }
+}
+
 fn index_of(text: &Vec<u8>, substring: &str) -> usize {
     str::from_utf8(text.as_slice())
         .unwrap()
@@ -561,3 +1002,16 @@ fn get_changed_ranges(
     *tree = new_tree;
     result
 }
+
+fn get_tree_diff(
+    parser: &mut Parser,
+    tree: &mut Tree,
+    source_code: &mut Vec<u8>,
+    edit: Edit,
+) -> Vec<TreeDiffEdit> {
+    perform_edit(tree, source_code, &edit);
+    let new_tree = parser.parse(&source_code, Some(tree)).unwrap();
+    let result = tree.diff(&new_tree).collect();
+    *tree = new_tree;
+    result
+}
@@ -3,11 +3,13 @@ pub mod util;
 pub use c_lib as c;
 
 use std::sync::atomic::{AtomicUsize, Ordering};
-use std::{iter, mem, ops, str, usize};
+use std::sync::Mutex;
+use std::{iter, mem, ops, str, thread, usize};
 use thiserror::Error;
+use std::collections::VecDeque;
 use tree_sitter::{
-    Language, LossyUtf8, Node, Parser, Point, Query, QueryCaptures, QueryCursor, QueryError,
-    QueryMatch, Range, Tree,
+    InputEdit, Language, LossyUtf8, Node, Parser, Point, Query, QueryCaptures, QueryCursor,
+    QueryError, QueryMatch, Range, Tree,
 };
 
 const CANCELLATION_CHECK_INTERVAL: usize = 100;
@@ -64,6 +66,7 @@ pub struct HighlightConfiguration {
 pub struct Highlighter {
     parser: Parser,
     cursors: Vec<QueryCursor>,
+    prefetched_trees: Vec<(Language, Vec<Range>, Tree)>,
 }
 
 /// Converts a general-purpose syntax highlighting iterator into a sequence of lines of HTML.
@@ -100,6 +103,20 @@ where
     iter_count: usize,
     next_event: Option<HighlightEvent>,
     last_highlight_range: Option<(usize, usize, usize)>,
+    restriction: Option<Vec<Range>>,
+}
+
+/// Clips a highlight event stream down to a set of changed byte ranges.
+///
+/// Source events are trimmed to the parts that fall inside the ranges, and
+/// highlight starts are held back until some retained source needs them, so
+/// the stream contains exactly the events required to re-render the changed
+/// regions and nothing for the untouched rest of the document.
+struct ClippedHighlightEvents<I> {
+    inner: I,
+    spans: Vec<(usize, usize)>,
+    stack: Vec<(Highlight, bool)>,
+    queue: VecDeque<HighlightEvent>,
 }
 
 struct HighlightIterLayer<'a> {
@@ -118,6 +135,7 @@ impl Highlighter {
         Highlighter {
             parser: Parser::new(),
             cursors: Vec::new(),
+            prefetched_trees: Vec::new(),
         }
     }
 
@@ -133,6 +151,7 @@ impl Highlighter {
         cancellation_flag: Option<&'a AtomicUsize>,
         mut injection_callback: impl FnMut(&str) -> Option<&'a HighlightConfiguration> + 'a,
     ) -> Result<impl Iterator<Item = Result<HighlightEvent, Error>> + 'a, Error> {
+        self.prefetched_trees.clear();
         let layers = HighlightIterLayer::new(
             source,
             self,
@@ -146,6 +165,7 @@ impl Highlighter {
                 start_point: Point::new(0, 0),
                 end_point: Point::new(usize::MAX, usize::MAX),
             }],
+            None,
         )?;
         assert_ne!(layers.len(), 0);
         let mut result = HighlightIter {
@@ -158,10 +178,284 @@ impl Highlighter {
             layers: layers,
             next_event: None,
             last_highlight_range: None,
+            restriction: None,
         };
         result.sort_layers();
         Ok(result)
     }
+
+    /// Like [`Highlighter::highlight`], but parses injected-language regions on a pool
+    /// of background threads before the event stream starts.
+    ///
+    /// The host document's injection sites are discovered up front, and each injected
+    /// region is parsed with its own parser on one of `thread_count` threads (pass zero
+    /// to use one thread per available CPU). The pre-parsed trees are then picked up
+    /// lazily as the event stream reaches each injection, so documents with many
+    /// independent injections - for example, fenced code blocks - don't stall the
+    /// stream on inline re-parses. The resulting events are identical to those
+    /// produced by [`Highlighter::highlight`]. Injections nested more than one level
+    /// deep are still parsed inline as they are encountered.
+    pub fn highlight_parallel<'a>(
+        &'a mut self,
+        config: &'a HighlightConfiguration,
+        source: &'a [u8],
+        cancellation_flag: Option<&'a AtomicUsize>,
+        mut injection_callback: impl FnMut(&str) -> Option<&'a HighlightConfiguration> + 'a,
+        thread_count: usize,
+    ) -> Result<impl Iterator<Item = Result<HighlightEvent, Error>> + 'a, Error> {
+        self.prefetched_trees.clear();
+        let whole_document = vec![Range {
+            start_byte: 0,
+            end_byte: usize::MAX,
+            start_point: Point::new(0, 0),
+            end_point: Point::new(usize::MAX, usize::MAX),
+        }];
+
+        // Parse the host document, just as `HighlightIterLayer::new` would.
+        if self.parser.set_included_ranges(&whole_document).is_err() {
+            return Err(Error::Unknown);
+        }
+        self.parser
+            .set_language(config.language)
+            .map_err(|_| Error::InvalidLanguage)?;
+        unsafe { self.parser.set_cancellation_flag(cancellation_flag) };
+        let tree = self.parser.parse(source, None).ok_or(Error::Cancelled)?;
+        unsafe { self.parser.set_cancellation_flag(None) };
+
+        // Discover the host document's injection sites: the injection patterns
+        // in the main query, plus any combined injections.
+        let mut work_items = Vec::new();
+        let mut cursor = self.cursors.pop().unwrap_or(QueryCursor::new());
+        for mat in cursor.matches(&config.query, tree.root_node(), source) {
+            if mat.pattern_index >= config.locals_pattern_index {
+                continue;
+            }
+            let (language_name, content_node, include_children) =
+                injection_for_match(config, &config.query, &mat, source);
+            if let (Some(language_name), Some(content_node)) = (language_name, content_node) {
+                if let Some(next_config) = (injection_callback)(language_name) {
+                    let ranges = HighlightIterLayer::intersect_ranges(
+                        &whole_document,
+                        &[content_node],
+                        include_children,
+                    );
+                    if !ranges.is_empty() {
+                        work_items.push((next_config.language, ranges));
+                    }
+                }
+            }
+        }
+        if let Some(combined_injections_query) = &config.combined_injections_query {
+            let mut injections_by_pattern_index =
+                vec![(None, Vec::new(), false); combined_injections_query.pattern_count()];
+            for mat in cursor.matches(combined_injections_query, tree.root_node(), source) {
+                let entry = &mut injections_by_pattern_index[mat.pattern_index];
+                let (language_name, content_node, include_children) =
+                    injection_for_match(config, combined_injections_query, &mat, source);
+                if language_name.is_some() {
+                    entry.0 = language_name;
+                }
+                if let Some(content_node) = content_node {
+                    entry.1.push(content_node);
+                }
+                entry.2 = include_children;
+            }
+            for (lang_name, content_nodes, includes_children) in injections_by_pattern_index {
+                if let (Some(lang_name), false) = (lang_name, content_nodes.is_empty()) {
+                    if let Some(next_config) = (injection_callback)(lang_name) {
+                        let ranges = HighlightIterLayer::intersect_ranges(
+                            &whole_document,
+                            &content_nodes,
+                            includes_children,
+                        );
+                        if !ranges.is_empty() {
+                            work_items.push((next_config.language, ranges));
+                        }
+                    }
+                }
+            }
+        }
+        self.cursors.push(cursor);
+
+        // Parse every injected region on the thread pool. A region whose parse
+        // fails or is cancelled simply isn't prefetched; the iterator parses it
+        // inline and reports the error there.
+        if !work_items.is_empty() {
+            let thread_count = if thread_count == 0 {
+                thread::available_parallelism().map_or(1, |n| n.get())
+            } else {
+                thread_count
+            };
+            let thread_count = thread_count.min(work_items.len());
+            let next_item = AtomicUsize::new(0);
+            let parsed = Mutex::new(Vec::with_capacity(work_items.len()));
+            thread::scope(|scope| {
+                for _ in 0..thread_count {
+                    scope.spawn(|| {
+                        let mut parser = Parser::new();
+                        unsafe { parser.set_cancellation_flag(cancellation_flag) };
+                        loop {
+                            let i = next_item.fetch_add(1, Ordering::SeqCst);
+                            if i >= work_items.len() {
+                                break;
+                            }
+                            let (language, ranges) = &work_items[i];
+                            if parser.set_included_ranges(ranges).is_err() {
+                                continue;
+                            }
+                            if parser.set_language(*language).is_err() {
+                                continue;
+                            }
+                            if let Some(tree) = parser.parse(source, None) {
+                                parsed.lock().unwrap().push((*language, ranges.clone(), tree));
+                            }
+                        }
+                    });
+                }
+            });
+            self.prefetched_trees = parsed.into_inner().unwrap();
+        }
+        self.prefetched_trees
+            .push((config.language, whole_document.clone(), tree));
+
+        let layers = HighlightIterLayer::new(
+            source,
+            self,
+            cancellation_flag,
+            &mut injection_callback,
+            config,
+            0,
+            whole_document,
+            None,
+        )?;
+        assert_ne!(layers.len(), 0);
+        let mut result = HighlightIter {
+            source,
+            byte_offset: 0,
+            injection_callback,
+            cancellation_flag,
+            highlighter: self,
+            iter_count: 0,
+            layers: layers,
+            next_event: None,
+            last_highlight_range: None,
+            restriction: None,
+        };
+        result.sort_layers();
+        Ok(result)
+    }
+
+    /// Like [`Highlighter::highlight`], but incremental: re-highlights only
+    /// the parts of the document affected by a set of edits.
+    ///
+    /// `old_tree` is the tree produced by highlighting the previous version
+    /// of the document, and `edits` describes how the document changed since
+    /// then. The document is re-parsed incrementally, and the returned event
+    /// stream covers only the regions the edits occupy in the new document
+    /// plus the regions where the re-parse changed the syntax, as reported
+    /// by changed-range diffing. Every event carries byte offsets into
+    /// `source`, so the caller can splice the new highlights over the old
+    /// ones; highlights outside the stream's regions are unchanged. The new
+    /// tree is returned alongside the events for use in the next increment.
+    ///
+    /// Injected-language regions that don't intersect any changed region are
+    /// skipped entirely, so the cost of a call is proportional to the size
+    /// of the edits rather than the size of the document. One caveat follows
+    /// from that: a local-variable definition outside the changed regions
+    /// won't be seen again, so references whose definition highlight depends
+    /// on distant context may be highlighted as plain variables until the
+    /// next full [`Highlighter::highlight`].
+    pub fn highlight_incremental<'a>(
+        &'a mut self,
+        config: &'a HighlightConfiguration,
+        source: &'a [u8],
+        old_tree: &Tree,
+        edits: &[InputEdit],
+        cancellation_flag: Option<&'a AtomicUsize>,
+        mut injection_callback: impl FnMut(&str) -> Option<&'a HighlightConfiguration> + 'a,
+    ) -> Result<(Tree, impl Iterator<Item = Result<HighlightEvent, Error>> + 'a), Error> {
+        self.prefetched_trees.clear();
+        let whole_document = vec![Range {
+            start_byte: 0,
+            end_byte: usize::MAX,
+            start_point: Point::new(0, 0),
+            end_point: Point::new(usize::MAX, usize::MAX),
+        }];
+
+        // Re-parse incrementally, starting from the old tree with the edits
+        // applied.
+        let mut edited_tree = old_tree.clone();
+        for edit in edits {
+            edited_tree.edit(edit);
+        }
+        if self.parser.set_included_ranges(&whole_document).is_err() {
+            return Err(Error::Unknown);
+        }
+        self.parser
+            .set_language(config.language)
+            .map_err(|_| Error::InvalidLanguage)?;
+        unsafe { self.parser.set_cancellation_flag(cancellation_flag) };
+        let tree = self
+            .parser
+            .parse(source, Some(&edited_tree))
+            .ok_or(Error::Cancelled)?;
+        unsafe { self.parser.set_cancellation_flag(None) };
+
+        // The regions whose highlights can differ: the spans the edits
+        // occupy in the new document, plus the ranges where the re-parse
+        // produced different syntax.
+        let mut changed: Vec<Range> = edited_tree.changed_ranges(&tree).collect();
+        for edit in edits {
+            changed.push(Range {
+                start_byte: edit.start_byte,
+                end_byte: edit.new_end_byte,
+                start_point: edit.start_position,
+                end_point: edit.new_end_position,
+            });
+        }
+        let changed = merge_ranges(changed);
+        let spans = changed
+            .iter()
+            .map(|range| (range.start_byte, range.end_byte))
+            .collect();
+
+        let new_tree = tree.clone();
+        self.prefetched_trees
+            .push((config.language, whole_document.clone(), tree));
+        let layers = HighlightIterLayer::new(
+            source,
+            self,
+            cancellation_flag,
+            &mut injection_callback,
+            config,
+            0,
+            whole_document,
+            Some(&changed),
+        )?;
+        assert_ne!(layers.len(), 0);
+        let mut result = HighlightIter {
+            source,
+            byte_offset: 0,
+            injection_callback,
+            cancellation_flag,
+            highlighter: self,
+            iter_count: 0,
+            layers: layers,
+            next_event: None,
+            last_highlight_range: None,
+            restriction: Some(changed),
+        };
+        result.sort_layers();
+        Ok((
+            new_tree,
+            ClippedHighlightEvents {
+                inner: result,
+                spans,
+                stack: Vec::new(),
+                queue: VecDeque::new(),
+            },
+        ))
+    }
 }
 
 impl HighlightConfiguration {
@@ -229,6 +523,25 @@ impl HighlightConfiguration {
             None
         };
 
+        Ok(Self::from_parts(
+            language,
+            query,
+            combined_injections_query,
+            locals_pattern_index,
+            highlights_pattern_index,
+        ))
+    }
+
+    // Assemble a configuration from compiled queries and the pattern indices
+    // that delimit the query sections. Everything else - capture indices,
+    // non-local patterns - is derived from the queries themselves.
+    fn from_parts(
+        language: Language,
+        query: Query,
+        combined_injections_query: Option<Query>,
+        locals_pattern_index: usize,
+        highlights_pattern_index: usize,
+    ) -> Self {
         // Find all of the highlighting patterns that are disabled for nodes that
         // have been identified as local variables.
         let non_local_variable_patterns = (0..query.pattern_count())
@@ -261,7 +574,7 @@ impl HighlightConfiguration {
         }
 
         let highlight_indices = vec![None; query.capture_names().len()];
-        Ok(HighlightConfiguration {
+        HighlightConfiguration {
             language,
             query,
             combined_injections_query,
@@ -275,7 +588,74 @@ impl HighlightConfiguration {
             local_def_value_capture_index,
             local_ref_capture_index,
             local_scope_capture_index,
-        })
+        }
+    }
+
+    /// Serialize this configuration into a binary blob that can be cached on
+    /// disk and later loaded with [`HighlightConfiguration::deserialize`].
+    /// The blob embeds the compiled queries via [`Query::serialize`], so it is
+    /// specific to the host machine and library version, and is rejected at
+    /// load time if either has changed. Highlight names set with `configure`
+    /// are not serialized; call `configure` again after deserializing.
+    pub fn serialize(&self) -> Vec<u8> {
+        fn push_blob(out: &mut Vec<u8>, blob: &[u8]) {
+            out.extend_from_slice(&(blob.len() as u32).to_le_bytes());
+            out.extend_from_slice(blob);
+        }
+        let mut result = Vec::new();
+        push_blob(&mut result, &self.query.serialize());
+        match &self.combined_injections_query {
+            Some(query) => push_blob(&mut result, &query.serialize()),
+            None => result.extend_from_slice(&u32::MAX.to_le_bytes()),
+        }
+        result.extend_from_slice(&(self.locals_pattern_index as u32).to_le_bytes());
+        result.extend_from_slice(&(self.highlights_pattern_index as u32).to_le_bytes());
+        result
+    }
+
+    /// Load a configuration previously serialized with
+    /// [`HighlightConfiguration::serialize`]. Returns `None` if the blob is
+    /// malformed or does not match this host, library version, or language.
+    pub fn deserialize(language: Language, data: &[u8]) -> Option<Self> {
+        fn read_u32(data: &[u8], position: &mut usize) -> Option<u32> {
+            let bytes = data.get(*position..*position + 4)?;
+            *position += 4;
+            let mut buffer = [0u8; 4];
+            buffer.copy_from_slice(bytes);
+            Some(u32::from_le_bytes(buffer))
+        }
+        fn read_blob<'a>(data: &'a [u8], position: &mut usize) -> Option<&'a [u8]> {
+            let length = read_u32(data, position)? as usize;
+            let blob = data.get(*position..*position + length)?;
+            *position += length;
+            Some(blob)
+        }
+
+        let mut position = 0;
+        let query = Query::deserialize(language, read_blob(data, &mut position)?)?;
+        let combined_length = read_u32(data, &mut position)?;
+        let combined_injections_query = if combined_length == u32::MAX {
+            None
+        } else {
+            let blob = data.get(position..position + combined_length as usize)?;
+            position += combined_length as usize;
+            Some(Query::deserialize(language, blob)?)
+        };
+        let locals_pattern_index = read_u32(data, &mut position)? as usize;
+        let highlights_pattern_index = read_u32(data, &mut position)? as usize;
+        if position != data.len() || highlights_pattern_index < locals_pattern_index {
+            return None;
+        }
+        if highlights_pattern_index > query.pattern_count() {
+            return None;
+        }
+        Some(Self::from_parts(
+            language,
+            query,
+            combined_injections_query,
+            locals_pattern_index,
+            highlights_pattern_index,
+        ))
     }
 
     /// Get a slice containing all of the highlight names used in the configuration.
@@ -337,11 +717,36 @@ impl<'a> HighlightIterLayer<'a> {
         mut config: &'a HighlightConfiguration,
         mut depth: usize,
         mut ranges: Vec<Range>,
+        restriction: Option<&[Range]>,
     ) -> Result<Vec<Self>, Error> {
         let mut result = Vec::with_capacity(1);
         let mut queue = Vec::new();
         loop {
-            if highlighter.parser.set_included_ranges(&ranges).is_ok() {
+            // When highlighting incrementally, skip injection layers that lie
+            // entirely outside of the changed regions: their previous
+            // highlights are still valid, and parsing them would make the
+            // cost proportional to the document instead of the edit.
+            let excluded = depth > 0
+                && restriction.map_or(false, |spans| {
+                    !ranges.iter().any(|range| {
+                        spans.iter().any(|span| {
+                            range.start_byte < span.end_byte && span.start_byte < range.end_byte
+                        })
+                    })
+                });
+
+            // If this layer's tree was parsed ahead of time by
+            // `highlight_parallel`, use it instead of parsing inline.
+            let tree = if excluded {
+                None
+            } else if let Some(i) = highlighter
+                .prefetched_trees
+                .iter()
+                .position(|(language, tree_ranges, _)| {
+                    *language == config.language && *tree_ranges == ranges
+                }) {
+                Some(highlighter.prefetched_trees.swap_remove(i).2)
+            } else if highlighter.parser.set_included_ranges(&ranges).is_ok() {
                 highlighter
                     .parser
                     .set_language(config.language)
@@ -353,8 +758,18 @@ impl<'a> HighlightIterLayer<'a> {
                     .parse(source, None)
                     .ok_or(Error::Cancelled)?;
                 unsafe { highlighter.parser.set_cancellation_flag(None) };
+                Some(tree)
+            } else {
+                None
+            };
+
+            if let Some(tree) = tree {
                 let mut cursor = highlighter.cursors.pop().unwrap_or(QueryCursor::new());
 
+                // The multi-range restriction persists on a cursor, and the
+                // cursors are recycled, so it must be cleared as well as set.
+                cursor.set_included_ranges(restriction.unwrap_or(&[]));
+
                 // Process combined injections.
                 if let Some(combined_injections_query) = &config.combined_injections_query {
                     let mut injections_by_pattern_index =
@@ -710,6 +1125,7 @@ where
                                 config,
                                 self.layers[0].depth + 1,
                                 ranges,
+                                self.restriction.as_deref(),
                             ) {
                                 Ok(layers) => {
                                     for layer in layers {
@@ -1023,6 +1439,79 @@ impl HtmlRenderer {
     }
 }
 
+impl<I> Iterator for ClippedHighlightEvents<I>
+where
+    I: Iterator<Item = Result<HighlightEvent, Error>>,
+{
+    type Item = Result<HighlightEvent, Error>;
+
+    fn next(&mut self) -> Option<Self::Item> {
+        loop {
+            if let Some(event) = self.queue.pop_front() {
+                return Some(Ok(event));
+            }
+            match self.inner.next()? {
+                Err(e) => return Some(Err(e)),
+                Ok(HighlightEvent::HighlightStart(highlight)) => {
+                    self.stack.push((highlight, false));
+                }
+                Ok(HighlightEvent::HighlightEnd) => {
+                    if let Some((_, emitted)) = self.stack.pop() {
+                        if emitted {
+                            return Some(Ok(HighlightEvent::HighlightEnd));
+                        }
+                    }
+                }
+                Ok(HighlightEvent::Source { start, end }) => {
+                    let mut any_retained = false;
+                    for (span_start, span_end) in self.spans.iter().copied() {
+                        let clipped_start = start.max(span_start);
+                        let clipped_end = end.min(span_end);
+                        if clipped_start < clipped_end {
+                            if !any_retained {
+                                any_retained = true;
+                                // Some source inside the enclosing highlights
+                                // is retained, so the highlights themselves
+                                // are needed after all.
+                                for (highlight, emitted) in self.stack.iter_mut() {
+                                    if !*emitted {
+                                        *emitted = true;
+                                        self.queue
+                                            .push_back(HighlightEvent::HighlightStart(*highlight));
+                                    }
+                                }
+                            }
+                            self.queue.push_back(HighlightEvent::Source {
+                                start: clipped_start,
+                                end: clipped_end,
+                            });
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Sort a set of ranges and merge the ones that touch or overlap.
+fn merge_ranges(mut ranges: Vec<Range>) -> Vec<Range> {
+    ranges.sort_unstable_by_key(|range| (range.start_byte, range.end_byte));
+    let mut result: Vec<Range> = Vec::with_capacity(ranges.len());
+    for range in ranges {
+        if let Some(last) = result.last_mut() {
+            if range.start_byte <= last.end_byte {
+                if range.end_byte > last.end_byte {
+                    last.end_byte = range.end_byte;
+                    last.end_point = range.end_point;
+                }
+                continue;
+            }
+        }
+        result.push(range);
+    }
+    result
+}
+
 fn injection_for_match<'a>(
     config: &HighlightConfiguration,
     query: &'a Query,
@@ -87,6 +87,19 @@ pub struct TSInputEdit {
     pub old_end_point: TSPoint,
     pub new_end_point: TSPoint,
 }
+pub const TSTreeDiffEditType_TSTreeDiffEditInsert: TSTreeDiffEditType = 0;
+pub const TSTreeDiffEditType_TSTreeDiffEditDelete: TSTreeDiffEditType = 1;
+pub const TSTreeDiffEditType_TSTreeDiffEditUpdate: TSTreeDiffEditType = 2;
+pub type TSTreeDiffEditType = ::std::os::raw::c_uint;
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct TSTreeDiffEdit {
+    pub type_: TSTreeDiffEditType,
+    pub old_symbol: TSSymbol,
+    pub new_symbol: TSSymbol,
+    pub old_range: TSRange,
+    pub new_range: TSRange,
+}
 #[repr(C)]
 #[derive(Debug, Copy, Clone)]
 pub struct TSNode {
@@ -353,6 +366,14 @@ extern "C" {
     #[doc = " (row, column) coordinates."]
     pub fn ts_tree_edit(self_: *mut TSTree, edit: *const TSInputEdit);
 }
+extern "C" {
+    #[doc = " Edit the syntax tree to keep it in sync with source code that has had a"]
+    #[doc = " batch of non-overlapping edits applied, all expressed in the coordinates"]
+    #[doc = " of the document before any of them were applied. The result is the same"]
+    #[doc = " as sorting the edits by position and calling `ts_tree_edit` once for"]
+    #[doc = " each, from the last edit to the first."]
+    pub fn ts_tree_edit_batch(self_: *mut TSTree, edits: *const TSInputEdit, edit_count: u32);
+}
 extern "C" {
     #[doc = " Compare an old edited syntax tree to a new syntax tree representing the same"]
     #[doc = " document, returning an array of ranges whose syntactic structure has changed."]
@@ -372,6 +393,33 @@ extern "C" {
         length: *mut u32,
     ) -> *mut TSRange;
 }
+extern "C" {
+    #[doc = " Compare an old edited syntax tree to the new tree produced by reparsing"]
+    #[doc = " it, returning a structural edit script: the node-level insertions,"]
+    #[doc = " deletions, and updates that turn the old tree into the new one, in"]
+    #[doc = " document order. The returned array is allocated using `malloc` and the"]
+    #[doc = " caller is responsible for freeing it using `free`."]
+    pub fn ts_tree_diff(
+        old_tree: *const TSTree,
+        new_tree: *const TSTree,
+        length: *mut u32,
+    ) -> *mut TSTreeDiffEdit;
+}
+extern "C" {
+    #[doc = " Serialize the syntax tree into a compact binary buffer."]
+    pub fn ts_tree_serialize(
+        self_: *const TSTree,
+        length: *mut u32,
+    ) -> *mut ::std::os::raw::c_void;
+}
+extern "C" {
+    #[doc = " Reconstruct a syntax tree from a buffer produced by `ts_tree_serialize`."]
+    pub fn ts_tree_deserialize(
+        buffer: *const ::std::os::raw::c_void,
+        length: u32,
+        language: *const TSLanguage,
+    ) -> *mut TSTree;
+}
 extern "C" {
     #[doc = " Get the node's type as a null-terminated string."]
     pub fn ts_node_type(arg1: TSNode) -> *const ::std::os::raw::c_char;
@@ -629,6 +677,21 @@ extern "C" {
     #[doc = " Delete a query, freeing all of the memory that it used."]
     pub fn ts_query_delete(arg1: *mut TSQuery);
 }
+extern "C" {
+    #[doc = " Serialize a compiled query into a contiguous binary blob."]
+    pub fn ts_query_serialize(
+        self_: *const TSQuery,
+        length: *mut u32,
+    ) -> *mut ::std::os::raw::c_void;
+}
+extern "C" {
+    #[doc = " Load a query previously serialized with `ts_query_serialize`."]
+    pub fn ts_query_deserialize(
+        data: *const ::std::os::raw::c_void,
+        length: u32,
+        language: *const TSLanguage,
+    ) -> *mut TSQuery;
+}
 extern "C" {
     #[doc = " Get the number of patterns, captures, or string literals in the query."]
     pub fn ts_query_pattern_count(arg1: *const TSQuery) -> u32;
@@ -767,6 +830,17 @@ extern "C" {
 extern "C" {
     pub fn ts_query_cursor_set_match_limit(arg1: *mut TSQueryCursor, arg2: u32);
 }
+extern "C" {
+    #[doc = " Manage the maximum number of bytes of capture-list memory the cursor may"]
+    #[doc = " retain, analogous to the match limit above. When a new in-progress match"]
+    #[doc = " would push the cursor past the budget, the earliest pending match is"]
+    #[doc = " dropped instead, and `ts_query_cursor_did_exceed_match_limit` reports it."]
+    #[doc = " By default the budget is unlimited (`UINT32_MAX`)."]
+    pub fn ts_query_cursor_max_memory(arg1: *const TSQueryCursor) -> u32;
+}
+extern "C" {
+    pub fn ts_query_cursor_set_max_memory(arg1: *mut TSQueryCursor, arg2: u32);
+}
 extern "C" {
     #[doc = " Set the range of bytes or (row, column) positions in which the query"]
     #[doc = " will be executed."]
@@ -775,6 +849,17 @@ extern "C" {
 extern "C" {
     pub fn ts_query_cursor_set_point_range(arg1: *mut TSQueryCursor, arg2: TSPoint, arg3: TSPoint);
 }
+extern "C" {
+    #[doc = " Restrict the query to a set of disjoint ranges of the document, in"]
+    #[doc = " addition to the single range configured by"]
+    #[doc = " `ts_query_cursor_set_byte_range` or `ts_query_cursor_set_point_range`."]
+    #[doc = " A pattern only matches if its root node intersects one of the ranges."]
+    pub fn ts_query_cursor_set_included_ranges(
+        arg1: *mut TSQueryCursor,
+        ranges: *const TSRange,
+        count: u32,
+    ) -> bool;
+}
 extern "C" {
     #[doc = " Advance to the next match of the currently running query."]
     #[doc = ""]
@@ -850,6 +935,18 @@ extern "C" {
     #[doc = " See also `ts_parser_set_language`."]
     pub fn ts_language_version(arg1: *const TSLanguage) -> u32;
 }
+extern "C" {
+    #[doc = " Translate a language built for an older ABI version into an equivalent"]
+    #[doc = " table for the current version. Returns NULL if the language's version is"]
+    #[doc = " outside the compatible range. The translation shares most of its data"]
+    #[doc = " with the original language, which must therefore outlive it; free it"]
+    #[doc = " with `ts_language_upgrade_delete`."]
+    pub fn ts_language_upgrade(arg1: *const TSLanguage) -> *const TSLanguage;
+}
+extern "C" {
+    #[doc = " Free a language translation created by `ts_language_upgrade`."]
+    pub fn ts_language_upgrade_delete(arg1: *const TSLanguage);
+}
 extern "C" {
     #[doc = " Set the allocation functions used by the library."]
     #[doc = ""]
@@ -882,5 +979,5 @@ extern "C" {
     );
 }
 
-pub const TREE_SITTER_LANGUAGE_VERSION: usize = 14;
+pub const TREE_SITTER_LANGUAGE_VERSION: usize = 16;
 pub const TREE_SITTER_MIN_COMPATIBLE_LANGUAGE_VERSION: usize = 13;
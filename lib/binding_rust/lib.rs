@@ -42,6 +42,12 @@ pub const PARSER_HEADER: &'static str = include_str!("../include/tree_sitter/par
 #[repr(transparent)]
 pub struct Language(*const ffi::TSLanguage);
 
+/// A language that was translated from an older ABI version by
+/// [Language::upgrade]. The translated table is freed when this value is
+/// dropped, and shares most of its data with the original language, which
+/// must therefore outlive it.
+pub struct UpgradedLanguage(Language);
+
 /// A tree that represents the syntactic structure of a source code file.
 #[doc(alias = "TSTree")]
 pub struct Tree(NonNull<ffi::TSTree>);
@@ -76,6 +82,25 @@ pub struct InputEdit {
     pub new_end_position: Point,
 }
 
+/// The kind of change described by a [TreeDiffEdit].
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub enum TreeDiffEditType {
+    Insert,
+    Delete,
+    Update,
+}
+
+/// One entry in the structural edit script produced by [Tree::diff]. The
+/// symbol and range on the side that an edit does not involve are zeroed.
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub struct TreeDiffEdit {
+    pub kind: TreeDiffEditType,
+    pub old_symbol: u16,
+    pub new_symbol: u16,
+    pub old_range: Range,
+    pub new_range: Range,
+}
+
 /// A single node within a syntax `Tree`.
 #[doc(alias = "TSNode")]
 #[derive(Clone, Copy)]
@@ -334,6 +359,33 @@ impl Language {
             Some(id)
         }
     }
+
+    /// Translate a language built for an older ABI version into an
+    /// equivalent table for the current version, so that every parse and
+    /// lookup takes the current version's fast paths. Returns `None` if the
+    /// language's version is outside the compatible range.
+    #[doc(alias = "ts_language_upgrade")]
+    pub fn upgrade(&self) -> Option<UpgradedLanguage> {
+        let ptr = unsafe { ffi::ts_language_upgrade(self.0) };
+        if ptr.is_null() {
+            None
+        } else {
+            Some(UpgradedLanguage(Language(ptr)))
+        }
+    }
+}
+
+impl UpgradedLanguage {
+    /// Get the translated language.
+    pub fn language(&self) -> Language {
+        self.0
+    }
+}
+
+impl Drop for UpgradedLanguage {
+    fn drop(&mut self) {
+        unsafe { ffi::ts_language_upgrade_delete((self.0).0) }
+    }
 }
 
 impl Parser {
@@ -739,6 +791,22 @@ impl Tree {
         unsafe { ffi::ts_tree_edit(self.0.as_ptr(), &edit) };
     }
 
+    /// Edit the syntax tree to keep it in sync with source code that has had
+    /// a batch of non-overlapping edits applied, all expressed in the
+    /// coordinates of the document before any of them were applied. The
+    /// result is the same as sorting the edits by position and calling
+    /// [Tree::edit] once for each, from the last edit to the first.
+    #[doc(alias = "ts_tree_edit_batch")]
+    pub fn edit_batch(&mut self, edits: &[InputEdit]) {
+        let edits = edits
+            .iter()
+            .map(|edit| edit.into())
+            .collect::<Vec<ffi::TSInputEdit>>();
+        unsafe {
+            ffi::ts_tree_edit_batch(self.0.as_ptr(), edits.as_ptr(), edits.len() as u32);
+        }
+    }
+
     /// Create a new [TreeCursor] starting from the root of the tree.
     pub fn walk(&self) -> TreeCursor {
         self.root_node().walk()
@@ -763,6 +831,53 @@ impl Tree {
             util::CBufferIter::new(ptr, count as usize).map(|r| r.into())
         }
     }
+
+    /// Compare this old edited syntax tree to a new syntax tree representing the same
+    /// document, returning a structural edit script: the sequence of node insertions,
+    /// deletions, and in-place updates that transforms the old tree into the new one.
+    ///
+    /// The same preconditions apply as for [Tree::changed_ranges]: this tree must have
+    /// been edited such that its ranges match up to the new tree.
+    #[doc(alias = "ts_tree_diff")]
+    pub fn diff(&self, other: &Tree) -> impl ExactSizeIterator<Item = TreeDiffEdit> {
+        let mut count = 0u32;
+        unsafe {
+            let ptr = ffi::ts_tree_diff(self.0.as_ptr(), other.0.as_ptr(), &mut count as *mut u32);
+            util::CBufferIter::new(ptr, count as usize).map(|e| e.into())
+        }
+    }
+
+    /// Serialize the syntax tree into a binary blob that can be cached and
+    /// later loaded with [`Tree::deserialize`]. The format is specific to the
+    /// host machine and library version, and embeds a fingerprint of the
+    /// tree's language; mismatched blobs are rejected at load time.
+    #[doc(alias = "ts_tree_serialize")]
+    pub fn serialize(&self) -> Vec<u8> {
+        let mut length = 0u32;
+        let ptr = unsafe { ffi::ts_tree_serialize(self.0.as_ptr(), &mut length as *mut u32) };
+        if ptr.is_null() {
+            return Vec::new();
+        }
+        let result = unsafe { slice::from_raw_parts(ptr as *const u8, length as usize) }.to_vec();
+        unsafe { (FREE_FN)(ptr) };
+        result
+    }
+
+    /// Load a tree previously serialized with [`Tree::serialize`]. Returns
+    /// `None` if the blob was produced on a different host or by a different
+    /// library version, does not match the given language, or is truncated
+    /// or otherwise malformed.
+    #[doc(alias = "ts_tree_deserialize")]
+    pub fn deserialize(language: Language, data: &[u8]) -> Option<Self> {
+        let ptr = unsafe {
+            ffi::ts_tree_deserialize(
+                data.as_ptr() as *const c_void,
+                data.len() as u32,
+                language.0,
+            )
+        };
+        NonNull::new(ptr).map(Tree)
+    }
 }
 
 impl fmt::Debug for Tree {
@@ -1412,6 +1527,14 @@ impl Query {
             });
         }
 
+        Self::from_raw_parts(ptr, source)
+    }
+
+    // Build a `Query` around an already-compiled `TSQuery`, extracting the
+    // capture names, quantifiers, and predicates. The source is used only to
+    // compute row numbers for predicate error messages; deserialized queries
+    // pass an empty string.
+    fn from_raw_parts(ptr: *mut ffi::TSQuery, source: &str) -> Result<Self, QueryError> {
         let string_count = unsafe { ffi::ts_query_string_count(ptr) };
         let capture_count = unsafe { ffi::ts_query_capture_count(ptr) };
         let pattern_count = unsafe { ffi::ts_query_pattern_count(ptr) as usize };
@@ -1625,6 +1748,41 @@ impl Query {
         Ok(result)
     }
 
+    /// Serialize the compiled query into a binary blob that can be cached and
+    /// later loaded with [`Query::deserialize`]. The format is specific to the
+    /// host machine and library version, and embeds a fingerprint of the
+    /// query's language; mismatched blobs are rejected at load time.
+    #[doc(alias = "ts_query_serialize")]
+    pub fn serialize(&self) -> Vec<u8> {
+        let mut length = 0u32;
+        let ptr = unsafe { ffi::ts_query_serialize(self.ptr.as_ptr(), &mut length as *mut u32) };
+        if ptr.is_null() {
+            return Vec::new();
+        }
+        let result = unsafe { slice::from_raw_parts(ptr as *const u8, length as usize) }.to_vec();
+        unsafe { (FREE_FN)(ptr) };
+        result
+    }
+
+    /// Load a query previously serialized with [`Query::serialize`]. Returns
+    /// `None` if the blob was produced on a different host or by a different
+    /// library version, or does not match the given language.
+    #[doc(alias = "ts_query_deserialize")]
+    pub fn deserialize(language: Language, data: &[u8]) -> Option<Self> {
+        let ptr = unsafe {
+            ffi::ts_query_deserialize(
+                data.as_ptr() as *const c_void,
+                data.len() as u32,
+                language.0,
+            )
+        };
+        if ptr.is_null() {
+            None
+        } else {
+            Self::from_raw_parts(ptr, "").ok()
+        }
+    }
+
     /// Get the byte offset where the given pattern starts in the query's source.
     #[doc(alias = "ts_query_start_byte_for_pattern")]
     pub fn start_byte_for_pattern(&self, pattern_index: usize) -> usize {
@@ -1819,6 +1977,24 @@ impl QueryCursor {
         }
     }
 
+    /// Return the maximum number of bytes of capture-list memory this cursor
+    /// may retain. `u32::MAX` (the default) means the budget is unlimited.
+    #[doc(alias = "ts_query_cursor_max_memory")]
+    pub fn max_memory(&self) -> u32 {
+        unsafe { ffi::ts_query_cursor_max_memory(self.ptr.as_ptr()) }
+    }
+
+    /// Set the maximum number of bytes of capture-list memory this cursor may
+    /// retain. When a new in-progress match would push the cursor past the
+    /// budget, the earliest pending match is dropped instead, and
+    /// [QueryCursor::did_exceed_match_limit] reports it.
+    #[doc(alias = "ts_query_cursor_set_max_memory")]
+    pub fn set_max_memory(&mut self, max_bytes: u32) {
+        unsafe {
+            ffi::ts_query_cursor_set_max_memory(self.ptr.as_ptr(), max_bytes);
+        }
+    }
+
     /// Check if, on its last execution, this cursor exceeded its maximum number of
     /// in-progress matches.
     #[doc(alias = "ts_query_cursor_did_exceed_match_limit")]
@@ -1898,6 +2074,29 @@ impl QueryCursor {
         }
         self
     }
+
+    /// Restrict the query to a set of disjoint ranges of the document, in
+    /// addition to the single range configured by
+    /// [set_byte_range](QueryCursor::set_byte_range) or
+    /// [set_point_range](QueryCursor::set_point_range). A pattern only
+    /// matches if its root node intersects one of the given ranges.
+    ///
+    /// The ranges must be ordered from earliest to latest in the document and
+    /// must not overlap; otherwise this returns `false` and the cursor's
+    /// ranges are left unchanged. The restriction persists across executions;
+    /// pass an empty slice to remove it.
+    #[doc(alias = "ts_query_cursor_set_included_ranges")]
+    pub fn set_included_ranges(&mut self, ranges: &[Range]) -> bool {
+        let ts_ranges: Vec<ffi::TSRange> =
+            ranges.iter().cloned().map(|range| range.into()).collect();
+        unsafe {
+            ffi::ts_query_cursor_set_included_ranges(
+                self.ptr.as_ptr(),
+                ts_ranges.as_ptr(),
+                ts_ranges.len() as u32,
+            )
+        }
+    }
 }
 
 impl<'a, 'tree> QueryMatch<'a, 'tree> {
@@ -2204,6 +2403,22 @@ impl From<ffi::TSRange> for Range {
     }
 }
 
+impl From<ffi::TSTreeDiffEdit> for TreeDiffEdit {
+    fn from(edit: ffi::TSTreeDiffEdit) -> Self {
+        Self {
+            kind: match edit.type_ {
+                ffi::TSTreeDiffEditType_TSTreeDiffEditDelete => TreeDiffEditType::Delete,
+                ffi::TSTreeDiffEditType_TSTreeDiffEditUpdate => TreeDiffEditType::Update,
+                _ => TreeDiffEditType::Insert,
+            },
+            old_symbol: edit.old_symbol,
+            new_symbol: edit.new_symbol,
+            old_range: edit.old_range.into(),
+            new_range: edit.new_range.into(),
+        }
+    }
+}
+
 impl<'a> Into<ffi::TSInputEdit> for &'a InputEdit {
     fn into(self) -> ffi::TSInputEdit {
         ffi::TSInputEdit {
@@ -38,6 +38,18 @@ static inline void marshal_node(const void **buffer, TSNode node) {
   buffer[4] = (const void *)node.context[3];
 }
 
+// Like `marshal_node`, but also writing the node's end index and end
+// position, so that the receiving side never needs to call back across
+// the wasm boundary to retrieve them. Used when bulk-marshaling query
+// results, where the per-node calls would otherwise dominate.
+static inline void marshal_node_with_range(const void **buffer, TSNode node) {
+  marshal_node(buffer, node);
+  TSPoint end_point = ts_node_end_point(node);
+  buffer[5] = (const void *)byte_to_code_unit(ts_node_end_byte(node));
+  buffer[6] = (const void *)end_point.row;
+  buffer[7] = (const void *)byte_to_code_unit(end_point.column);
+}
+
 static inline TSNode unmarshal_node(const TSTree *tree) {
   TSNode node;
   node.id = TRANSFER_BUFFER[0];
@@ -617,14 +629,14 @@ void ts_query_matches_wasm(
   TSQueryMatch match;
   while (ts_query_cursor_next_match(scratch_query_cursor, &match)) {
     match_count++;
-    array_grow_by(&result, 2 + 6 * match.capture_count);
+    array_grow_by(&result, 2 + 9 * match.capture_count);
     result.contents[index++] = (const void *)(uint32_t)match.pattern_index;
     result.contents[index++] = (const void *)(uint32_t)match.capture_count;
     for (unsigned i = 0; i < match.capture_count; i++) {
       const TSQueryCapture *capture = &match.captures[i];
       result.contents[index++] = (const void *)capture->index;
-      marshal_node(result.contents + index, capture->node);
-      index += 5;
+      marshal_node_with_range(result.contents + index, capture->node);
+      index += 8;
     }
   }
 
@@ -670,15 +682,15 @@ void ts_query_captures_wasm(
   )) {
     capture_count++;
 
-    array_grow_by(&result, 3 + 6 * match.capture_count);
+    array_grow_by(&result, 3 + 9 * match.capture_count);
     result.contents[index++] = (const void *)(uint32_t)match.pattern_index;
     result.contents[index++] = (const void *)(uint32_t)match.capture_count;
     result.contents[index++] = (const void *)(uint32_t)capture_index;
     for (unsigned i = 0; i < match.capture_count; i++) {
       const TSQueryCapture *capture = &match.captures[i];
       result.contents[index++] = (const void *)capture->index;
-      marshal_node(result.contents + index, capture->node);
-      index += 5;
+      marshal_node_with_range(result.contents + index, capture->node);
+      index += 8;
     }
   }
 
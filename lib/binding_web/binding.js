@@ -213,14 +213,20 @@ class Node {
   }
 
   get endPosition() {
-    marshalNode(this);
-    C._ts_node_end_point_wasm(this.tree[0]);
-    return unmarshalPoint(TRANSFER_BUFFER);
+    if (!this._endPosition) {
+      marshalNode(this);
+      C._ts_node_end_point_wasm(this.tree[0]);
+      this._endPosition = unmarshalPoint(TRANSFER_BUFFER);
+    }
+    return this._endPosition;
   }
 
   get endIndex() {
-    marshalNode(this);
-    return C._ts_node_end_index_wasm(this.tree[0]);
+    if (this._endIndex === undefined) {
+      marshalNode(this);
+      this._endIndex = C._ts_node_end_index_wasm(this.tree[0]);
+    }
+    return this._endIndex;
   }
 
   get text() {
@@ -1094,6 +1100,18 @@ function unmarshalCaptures(query, tree, address, result) {
     address += SIZE_OF_INT;
     const node = unmarshalNode(tree, address);
     address += SIZE_OF_NODE;
+
+    // The capture records written by `ts_query_matches_wasm` and
+    // `ts_query_captures_wasm` also carry each node's end index and end
+    // position, so that reading them never requires another call into wasm.
+    node._endIndex = getValue(address, 'i32');
+    address += SIZE_OF_INT;
+    const endRow = getValue(address, 'i32');
+    address += SIZE_OF_INT;
+    const endColumn = getValue(address, 'i32');
+    address += SIZE_OF_INT;
+    node._endPosition = {row: endRow, column: endColumn};
+
     result[i] = {name: query.captureNames[captureIndex], node};
   }
   return address;
@@ -21,7 +21,7 @@ extern "C" {
  * The Tree-sitter library is generally backwards-compatible with languages
  * generated using older CLI versions, but is not forwards-compatible.
  */
-#define TREE_SITTER_LANGUAGE_VERSION 14
+#define TREE_SITTER_LANGUAGE_VERSION 16
 
 /**
  * The earliest ABI version that is supported by the current version of the
@@ -40,6 +40,9 @@ typedef struct TSParser TSParser;
 typedef struct TSTree TSTree;
 typedef struct TSQuery TSQuery;
 typedef struct TSQueryCursor TSQueryCursor;
+typedef struct TSTreeCache TSTreeCache;
+typedef struct TSChangedRangeIterator TSChangedRangeIterator;
+typedef struct TSPipeline TSPipeline;
 
 typedef enum {
   TSInputEncodingUTF8,
@@ -89,6 +92,39 @@ typedef struct {
   TSPoint new_end_point;
 } TSInputEdit;
 
+typedef struct {
+  uint64_t parse_micros;
+  uint64_t lex_micros;
+  uint64_t tokens_lexed;
+  uint64_t nodes_reused;
+  uint64_t bytes_reused;
+  uint64_t stack_versions_condensed;
+  uint64_t error_recoveries;
+} TSParserStats;
+
+typedef struct {
+  uint32_t states_created;
+  uint32_t steps_evaluated;
+  uint32_t nodes_visited;
+  uint64_t elapsed_nanos;
+  bool exceeded_step_limit;
+} TSQueryPatternStats;
+
+typedef struct {
+  uint32_t max_stack_versions;
+  uint32_t max_error_cost;
+  uint32_t max_recovery_count;
+} TSRecoveryBudget;
+
+typedef struct {
+  uint32_t node_count;
+  uint32_t inline_node_count;
+  uint32_t heap_node_count;
+  uint32_t shared_node_count;
+  uint64_t heap_bytes;
+  uint64_t shared_bytes;
+} TSTreeStats;
+
 typedef struct {
   uint32_t context[4];
   const void *id;
@@ -212,6 +248,60 @@ const TSRange *ts_parser_included_ranges(
   uint32_t *length
 );
 
+/**
+ * Limit the depth of the trees that the parser returns, for previews such
+ * as file outlines that only render the top levels of the syntax tree.
+ * Nodes more than `max_depth` visible levels below the root are collapsed
+ * into opaque leaves, as by `ts_tree_with_depth_limit`, and the full-depth
+ * structure is released before the parse returns, so a preview of a large
+ * file never holds the whole tree in memory.
+ *
+ * By default the depth is unlimited (`UINT32_MAX`); setting it again
+ * restores normal parsing. The limit persists across parses, like the
+ * parser's included ranges.
+ */
+uint32_t ts_parser_max_tree_depth(const TSParser *self);
+void ts_parser_set_max_tree_depth(TSParser *self, uint32_t max_depth);
+
+/**
+ * Bound the work that the parser may spend on error recovery, for inputs
+ * like truncated or binary files where exhaustive recovery explores many
+ * stack versions without producing a better tree. Each field of the budget
+ * that is set to zero leaves that dimension unlimited, which is the default:
+ * 1. `max_stack_versions`: a cap on the number of concurrent stack versions,
+ *    below the parser's built-in limit.
+ * 2. `max_error_cost`: once a parse state's accumulated error cost exceeds
+ *    this value, no new recovery strategies are tried for it.
+ * 3. `max_recovery_count`: a cap on the number of error recoveries begun
+ *    within a single parse.
+ *
+ * Exhausting the budget does not abort the parse the way a timeout does:
+ * the parser just stops searching for recoveries, skips the remaining
+ * invalid input into a single `ERROR` node, and still returns a usable
+ * tree. The budget persists across parses.
+ */
+TSRecoveryBudget ts_parser_recovery_budget(const TSParser *self);
+void ts_parser_set_recovery_budget(TSParser *self, TSRecoveryBudget budget);
+
+/**
+ * Cap the amount of memory that a single parse may allocate, for hosts
+ * that run many parsers concurrently and cannot afford one adversarial
+ * input exhausting the process's memory. The accounting is approximate:
+ * it covers the parser's subtree storage, its stack, and the lexer's
+ * bookkeeping, which dominate the memory used on pathological inputs.
+ *
+ * Exceeding the budget does not abort the parse the way a timeout does.
+ * The parser stops consuming input at its current position and finishes
+ * through the same recovery path as a truncated file, returning a valid
+ * tree for the prefix it has parsed. Combine with
+ * `ts_parser_set_max_tree_depth` to also flatten the salvaged tree.
+ *
+ * A budget of zero, the default, leaves memory unlimited. The budget
+ * persists across parses.
+ */
+size_t ts_parser_max_memory(const TSParser *self);
+void ts_parser_set_max_memory(TSParser *self, size_t max_memory);
+
 /**
  * Use the parser to parse some source code and create a syntax tree.
  *
@@ -283,6 +373,53 @@ TSTree *ts_parser_parse_string_encoding(
   TSInputEncoding encoding
 );
 
+/**
+ * Use the parser to parse source code read from the given file descriptor.
+ * The whole file is parsed, regardless of the descriptor's current offset.
+ *
+ * Where possible, the file is memory-mapped and the lexer reads chunks
+ * directly out of the mapping, so the source text is never copied into a
+ * separate buffer; otherwise - for pipes, or on platforms without mmap -
+ * the file is read into a temporary buffer instead. The caller retains
+ * ownership of the file descriptor and can close it as soon as this
+ * function returns.
+ *
+ * Returns NULL if the file's metadata cannot be read, if it is larger than
+ * 4 GiB, or in any of the situations where `ts_parser_parse` would return
+ * NULL.
+ */
+TSTree *ts_parser_parse_fd(
+  TSParser *self,
+  const TSTree *old_tree,
+  int fd,
+  TSInputEncoding encoding
+);
+
+/**
+ * Use the parser to parse some source code, delivering each top-level node
+ * of the resulting tree to the given callback instead of returning a tree.
+ *
+ * The callback is invoked once per child of the root node, in document
+ * order, and may return `false` to stop the iteration early. The nodes
+ * passed to the callback are only valid for the duration of that call: the
+ * tree is released before this function returns, so callers that process
+ * files one construct at a time never need to hold a `TSTree` themselves.
+ *
+ * Because the parser supports generalized LR parsing and error recovery,
+ * a subtree cannot be considered final until the entire parse has been
+ * accepted - a later conflict or error repair may replace it - so the
+ * callbacks begin only once parsing is complete.
+ *
+ * Returns `false` if parsing failed in any of the situations where
+ * `ts_parser_parse` would return NULL, and `true` otherwise.
+ */
+bool ts_parser_parse_streaming(
+  TSParser *self,
+  TSInput input,
+  bool (*callback)(void *payload, TSNode node),
+  void *payload
+);
+
 /**
  * Instruct the parser to start the next parse from the beginning.
  *
@@ -314,6 +451,12 @@ uint64_t ts_parser_timeout_micros(const TSParser *self);
  * If a non-null pointer is assigned, then the parser will periodically read
  * from this pointer during parsing. If it reads a non-zero value, it will
  * halt early, returning NULL. See `ts_parser_parse` for more information.
+ *
+ * The flag is checked between parse actions, whenever the lexer needs a new
+ * chunk of input - so that even a single long token cannot delay the
+ * response - and on every action during error recovery. The halted parse
+ * retains its stack state and can be resumed by calling `ts_parser_parse`
+ * again, rather than restarting from scratch.
  */
 void ts_parser_set_cancellation_flag(TSParser *self, const size_t *flag);
 
@@ -344,6 +487,18 @@ TSLogger ts_parser_logger(const TSParser *self);
  */
 void ts_parser_print_dot_graphs(TSParser *self, int file);
 
+/**
+ * Get statistics about the most recent call to `ts_parser_parse`.
+ *
+ * The counters are reset at the start of each parse, so the returned struct
+ * always describes a single parse: how long it took overall, how much of
+ * that time was spent in the lexer, how many tokens were lexed, how many
+ * nodes (and source bytes) were reused from the old tree during an
+ * incremental parse, how many stack versions were pruned away, and how many
+ * times the parser entered error recovery.
+ */
+TSParserStats ts_parser_stats(const TSParser *self);
+
 /******************/
 /* Section - Tree */
 /******************/
@@ -353,9 +508,33 @@ void ts_parser_print_dot_graphs(TSParser *self, int file);
  *
  * You need to copy a syntax tree in order to use it on more than one thread at
  * a time, as syntax trees are not thread safe.
+ *
+ * Copies share their nodes with the original tree, and editing is
+ * copy-on-write: `ts_tree_edit` clones only the nodes along the path that
+ * the edit touches, leaving everything reachable from other copies intact.
+ * One thread can therefore keep editing and reparsing its tree while other
+ * threads read a stable snapshot taken with this function, without any
+ * deep copying. Each thread must still use its own `TSTree`; only the
+ * underlying nodes are shared.
  */
 TSTree *ts_tree_copy(const TSTree *self);
 
+/**
+ * Create a copy of the syntax tree in which every node more than
+ * `max_depth` visible levels below the root is collapsed into an opaque
+ * leaf. Collapsed nodes keep their symbol and extent but report no
+ * children, fields, or internal errors, which makes the copy cheap to
+ * store and traverse for outline-style displays. Invisible levels of the
+ * tree do not count toward the depth. A `max_depth` of zero collapses the
+ * tree to its root node alone.
+ *
+ * The copy shares its uncollapsed leaves with the original tree, but is
+ * otherwise independent, and must be deleted separately. Note that editing
+ * and re-parsing a depth-limited copy re-parses the collapsed regions from
+ * scratch; keep the full tree around for incremental updates.
+ */
+TSTree *ts_tree_with_depth_limit(const TSTree *self, uint32_t max_depth);
+
 /**
  * Delete the syntax tree, freeing all of the memory that it used.
  */
@@ -381,6 +560,20 @@ TSNode ts_tree_root_node_with_offset(
  */
 const TSLanguage *ts_tree_language(const TSTree *);
 
+/**
+ * Build an index over the tree's named nodes that accelerates the
+ * `ts_node_descendant_for_byte_range` family of functions when they are
+ * called on the tree's root node.
+ *
+ * Building the index costs one traversal of the upper levels of the tree;
+ * it pays off when many descendant lookups are performed against the same
+ * tree, as in an editor or language server. The index is freed together
+ * with the tree, and is discarded automatically when the tree is edited
+ * with `ts_tree_edit`; call this function again after an edit to rebuild
+ * it. Calling it when the tree is already indexed has no effect.
+ */
+void ts_tree_build_descendant_index(TSTree *self);
+
 /**
  * Edit the syntax tree to keep it in sync with source code that has been
  * edited.
@@ -390,6 +583,37 @@ const TSLanguage *ts_tree_language(const TSTree *);
  */
 void ts_tree_edit(TSTree *self, const TSInputEdit *edit);
 
+/**
+ * Convert between byte offsets and (row, column) positions using the line
+ * index that the parser builds into each tree it produces, so that clients
+ * do not need to maintain their own line table. Columns are measured in
+ * bytes. The index stays in sync across `ts_tree_edit`: rows outside the
+ * edited region keep exact offsets, while rows inside it are re-learned
+ * when the tree is next reparsed. Both functions return `false` if the
+ * tree has no line index (for example, a deserialized tree), and
+ * `ts_tree_byte_for_point` also returns `false` for a row whose offset is
+ * not currently known - a row inside an edited-but-not-yet-reparsed
+ * region, or one that lay outside the parser's included ranges.
+ * `ts_tree_point_for_byte` answers with the nearest known preceding line
+ * start in that case. Neither function validates the position against the
+ * document's actual line lengths, since the tree does not retain the text.
+ */
+bool ts_tree_point_for_byte(const TSTree *self, uint32_t byte, TSPoint *point);
+bool ts_tree_byte_for_point(const TSTree *self, TSPoint point, uint32_t *byte);
+
+/**
+ * Apply a batch of edits to the syntax tree in a single pass.
+ *
+ * The edits must not overlap, and must all be expressed in the coordinates
+ * of the document as it was *before* any of them were applied - as is
+ * natural for a paste or format operation computed against one snapshot of
+ * the text. The result is the same as sorting the edits by position and
+ * calling `ts_tree_edit` once for each, from the last edit to the first,
+ * but each affected node is adjusted only once, so large batches avoid
+ * re-walking the shared upper portions of the tree.
+ */
+void ts_tree_edit_batch(TSTree *self, const TSInputEdit *edits, uint32_t edit_count);
+
 /**
  * Compare an old edited syntax tree to a new syntax tree representing the same
  * document, returning an array of ranges whose syntactic structure has changed.
@@ -410,11 +634,209 @@ TSRange *ts_tree_get_changed_ranges(
   uint32_t *length
 );
 
+/**
+ * Create an iterator over the ranges whose syntactic structure differs
+ * between an old edited syntax tree and the new tree produced by reparsing
+ * it. The iterator yields exactly the ranges that
+ * `ts_tree_get_changed_ranges` would return, but computes them on demand,
+ * so consumers that stop early - for example, a viewport-sized redraw -
+ * never pay for walking the rest of the trees.
+ *
+ * Both trees must remain alive for as long as the iterator is in use.
+ */
+TSChangedRangeIterator *ts_tree_changed_ranges_iter_new(
+  const TSTree *old_tree,
+  const TSTree *new_tree
+);
+
+/**
+ * Restrict the iterator to ranges that intersect the given byte range.
+ * Ranges that end before `start_byte` are skipped, and the underlying tree
+ * walk stops as soon as it has passed `end_byte`.
+ */
+void ts_changed_ranges_iter_set_byte_range(
+  TSChangedRangeIterator *self,
+  uint32_t start_byte,
+  uint32_t end_byte
+);
+
+/**
+ * Advance the iterator, writing the next changed range to the given
+ * `TSRange` pointer. Returns `false` when there are no more ranges.
+ */
+bool ts_changed_ranges_iter_next(TSChangedRangeIterator *self, TSRange *range);
+
+/**
+ * Delete a changed-range iterator, freeing its walk state. The trees it
+ * was created from are not affected.
+ */
+void ts_changed_ranges_iter_delete(TSChangedRangeIterator *self);
+
+typedef enum {
+  TSTreeDiffEditInsert,
+  TSTreeDiffEditDelete,
+  TSTreeDiffEditUpdate,
+} TSTreeDiffEditType;
+
+/**
+ * One step of a structural edit script. An insert describes a node that
+ * exists only in the new tree, a delete describes a node that exists only in
+ * the old tree, and an update pairs an old node with a new node of the same
+ * symbol at the same position whose contents changed. The symbol and range
+ * on the side an edit does not involve are zeroed.
+ */
+typedef struct {
+  TSTreeDiffEditType type;
+  TSSymbol old_symbol;
+  TSSymbol new_symbol;
+  TSRange old_range;
+  TSRange new_range;
+} TSTreeDiffEdit;
+
+/**
+ * Compare an old edited syntax tree to the new tree produced by reparsing
+ * it, returning a structural edit script: the node-level insertions,
+ * deletions, and updates that turn the old tree into the new one, in
+ * document order. This reports *what* changed, where
+ * `ts_tree_get_changed_ranges` reports only the bytes spanned by the
+ * changes, and it reuses the same aligned walk, so unchanged subtrees are
+ * stepped over without being visited.
+ *
+ * The script aligns the two trees by position. A node replaced by one of a
+ * different symbol appears as a delete plus an insert; moves are not
+ * detected, so a subtree that changed position is reported the same way.
+ * Updates bottom out at the shallowest node pair whose children could not
+ * be aligned further; enclosing nodes whose only change is within a
+ * reported child are not themselves reported.
+ *
+ * The same requirements apply as for `ts_tree_get_changed_ranges`: the old
+ * tree must have been edited so that its ranges match up to the new tree.
+ * The returned array is allocated using `malloc` and the caller is
+ * responsible for freeing it using `free`. The length of the array will be
+ * written to the given `length` pointer.
+ */
+TSTreeDiffEdit *ts_tree_diff(
+  const TSTree *old_tree,
+  const TSTree *new_tree,
+  uint32_t *length
+);
+
+/**
+ * Walk the tree and report memory statistics: the total number of nodes,
+ * how many use the inline versus the heap representation, how many heap
+ * nodes are shared with other trees via their reference counts, and the
+ * heap bytes attributable to each group. Shared bytes are counted once
+ * per tree that can reach them, so summing the statistics of two trees
+ * that share structure double-counts the shared portion.
+ *
+ * Reuse achieved during a particular parse is reported separately by
+ * `ts_parser_stats`.
+ */
+TSTreeStats ts_tree_stats(const TSTree *self);
+
+/**
+ * Walk the tree and count the nodes for each symbol, writing the counts
+ * into the given array, which must have room for one count per symbol in
+ * the tree's language - see `ts_language_symbol_count`. Nodes whose
+ * symbol exceeds the array's length are ignored.
+ */
+void ts_tree_symbol_node_counts(
+  const TSTree *self,
+  uint32_t *counts,
+  uint32_t symbol_count
+);
+
 /**
  * Write a DOT graph describing the syntax tree to the given file.
  */
 void ts_tree_print_dot_graph(const TSTree *, FILE *);
 
+/**
+ * Create a shared, content-addressed cache of syntax trees with space for
+ * approximately the given number of entries. The cache is safe to use from
+ * multiple threads at once: cached trees are handed out as cheap copies
+ * whose underlying nodes are shared via atomic reference counts, so
+ * parsing the same content repeatedly - for example, duplicated vendored
+ * files across a large repository - costs one tree's worth of memory.
+ */
+TSTreeCache *ts_tree_cache_new(uint32_t capacity);
+
+/**
+ * Delete a tree cache, releasing every cached tree. Trees previously
+ * returned from the cache remain valid; they share nodes with the cached
+ * copies but have independent lifetimes.
+ */
+void ts_tree_cache_delete(TSTreeCache *self);
+
+/**
+ * Look up a tree for the given source text as parsed with the given
+ * language. If the cache holds a tree for content with the same
+ * fingerprint and the same language, a copy is returned and the caller
+ * owns it; otherwise this returns NULL.
+ */
+TSTree *ts_tree_cache_get(
+  TSTreeCache *self,
+  const TSLanguage *language,
+  const char *content,
+  uint32_t length
+);
+
+/**
+ * Store a tree for the given source text, which must be the text the tree
+ * was parsed from. Entries are keyed by the tree's language as well as the
+ * content, so one cache can safely be shared by parsers of different
+ * languages. The cache retains its own copy; the caller keeps ownership
+ * of `tree`. An existing entry with a colliding table slot may be
+ * evicted.
+ */
+void ts_tree_cache_put(
+  TSTreeCache *self,
+  const char *content,
+  uint32_t length,
+  const TSTree *tree
+);
+
+/**
+ * Parse the given source text, consulting the cache first. On a cache hit
+ * the parser is not used at all and the cached tree is returned in O(1);
+ * on a miss the text is parsed and the resulting tree is added to the
+ * cache. The caller owns the returned tree.
+ */
+TSTree *ts_tree_cache_parse(
+  TSTreeCache *self,
+  TSParser *parser,
+  const char *content,
+  uint32_t length
+);
+
+/**
+ * Serialize the syntax tree into a compact binary buffer that can be
+ * persisted and later turned back into a tree with `ts_tree_deserialize`,
+ * skipping a re-parse of unchanged files. The buffer's length in bytes is
+ * written to `length`. The caller owns the returned buffer and must free
+ * it using `free`.
+ *
+ * The format is host-specific: it records raw node images along with the
+ * host's node layout and a fingerprint of the language build, and
+ * deserialization refuses buffers whose header does not match. Treat the
+ * serialized form as a cache entry, not an interchange format.
+ */
+void *ts_tree_serialize(const TSTree *self, uint32_t *length);
+
+/**
+ * Reconstruct a syntax tree from a buffer produced by `ts_tree_serialize`.
+ * The given language must be the same version of the same grammar that
+ * produced the original tree.
+ *
+ * Returns NULL if the buffer was serialized on an incompatible host or
+ * language build, or if it is truncated or malformed.
+ */
+TSTree *ts_tree_deserialize(
+  const void *buffer,
+  uint32_t length,
+  const TSLanguage *language
+);
+
 /******************/
 /* Section - Node */
 /******************/
@@ -598,6 +1020,25 @@ void ts_node_edit(TSNode *, const TSInputEdit *);
  */
 bool ts_node_eq(TSNode, TSNode);
 
+/**
+ * Get a compact 32-bit id for the given node: its index in a pre-order
+ * traversal of the tree, where the root node has id zero. Unlike a `TSNode`,
+ * which occupies 32 bytes, these ids can be stored in large side tables and
+ * later resolved back into nodes with `ts_tree_node_for_id`.
+ *
+ * Ids are stable for the lifetime of the tree and for any copies of it, but
+ * are invalidated by editing and reparsing. Returns `UINT32_MAX` if the node
+ * is null.
+ */
+uint32_t ts_node_compact_id(TSNode self);
+
+/**
+ * Get the node with the given compact id, as returned by
+ * `ts_node_compact_id`. Returns a null node if the id is out of range
+ * for this tree.
+ */
+TSNode ts_tree_node_for_id(const TSTree *self, uint32_t id);
+
 /************************/
 /* Section - TreeCursor */
 /************************/
@@ -676,8 +1117,46 @@ bool ts_tree_cursor_goto_first_child(TSTreeCursor *);
 int64_t ts_tree_cursor_goto_first_child_for_byte(TSTreeCursor *, uint32_t);
 int64_t ts_tree_cursor_goto_first_child_for_point(TSTreeCursor *, TSPoint);
 
+/**
+ * Move the cursor to the smallest node within its current subtree that
+ * spans the given range of bytes or (row, column) positions, and return
+ * that node. The `named` variants return the smallest *named* node that
+ * spans the range, while still leaving the cursor on the smallest node.
+ *
+ * These behave like the `ts_node_descendant_for_byte_range` family of
+ * functions, but start searching from the cursor's current position
+ * instead of descending from the root, walking upward first if the
+ * current node does not contain the range. When consecutive lookups
+ * target nearby positions - as when resolving editor positions during
+ * scrolling or hovering - reusing one cursor this way touches only the
+ * few tree levels near the previous result.
+ */
+TSNode ts_tree_cursor_descendant_for_byte_range(TSTreeCursor *, uint32_t, uint32_t);
+TSNode ts_tree_cursor_named_descendant_for_byte_range(TSTreeCursor *, uint32_t, uint32_t);
+TSNode ts_tree_cursor_descendant_for_point_range(TSTreeCursor *, TSPoint, TSPoint);
+TSNode ts_tree_cursor_named_descendant_for_point_range(TSTreeCursor *, TSPoint, TSPoint);
+
 TSTreeCursor ts_tree_cursor_copy(const TSTreeCursor *);
 
+/**
+ * Collect all of the visible children of the cursor's current node in one
+ * call, writing up to `capacity` of them into the caller-provided `nodes`
+ * array and their field ids into `field_ids`. Either output array may be
+ * NULL to skip it. The total number of children is returned, so a call
+ * with insufficient capacity can be retried with larger buffers; the
+ * cursor itself ends up back on the parent node either way.
+ *
+ * This visits the underlying child array in a single pass, so consumers
+ * that export whole trees avoid paying the per-call position and alias
+ * bookkeeping of `ts_node_child` for every child.
+ */
+uint32_t ts_tree_cursor_children_into(
+  TSTreeCursor *self,
+  TSNode *nodes,
+  TSFieldId *field_ids,
+  uint32_t capacity
+);
+
 /*******************/
 /* Section - Query */
 /*******************/
@@ -706,6 +1185,34 @@ TSQuery *ts_query_new(
  */
 void ts_query_delete(TSQuery *);
 
+/**
+ * Serialize a compiled query into a contiguous buffer. The buffer can be
+ * persisted and later turned back into a query with `ts_query_deserialize`,
+ * skipping the S-expression parsing and pattern analysis that `ts_query_new`
+ * performs. The buffer's length in bytes is written to `length`. The caller
+ * owns the returned buffer and must free it using `free`.
+ *
+ * The format is host-specific: it records the compiled pattern arrays as raw
+ * struct images along with a fingerprint of the language build, and
+ * deserialization refuses buffers whose header does not match. Treat the
+ * serialized form as a cache entry, not an interchange format.
+ */
+void *ts_query_serialize(const TSQuery *self, uint32_t *length);
+
+/**
+ * Reconstruct a query from a buffer produced by `ts_query_serialize`. The
+ * given language must be the same version of the same grammar that the
+ * original query was compiled against.
+ *
+ * Returns NULL if the buffer was serialized on an incompatible host or
+ * language build, or if it is truncated or malformed.
+ */
+TSQuery *ts_query_deserialize(
+  const void *buffer,
+  uint32_t length,
+  const TSLanguage *language
+);
+
 /**
  * Get the number of patterns, captures, or string literals in the query.
  */
@@ -846,13 +1353,162 @@ bool ts_query_cursor_did_exceed_match_limit(const TSQueryCursor *);
 uint32_t ts_query_cursor_match_limit(const TSQueryCursor *);
 void ts_query_cursor_set_match_limit(TSQueryCursor *, uint32_t);
 
+/**
+ * Manage the maximum number of bytes of capture-list memory the cursor may
+ * retain, analogous to the match limit above. When a new in-progress match
+ * would push the cursor past the budget, the earliest pending match is
+ * dropped instead, and `ts_query_cursor_did_exceed_match_limit` reports it.
+ * By default the budget is unlimited (`UINT32_MAX`).
+ */
+uint32_t ts_query_cursor_max_memory(const TSQueryCursor *);
+void ts_query_cursor_set_max_memory(TSQueryCursor *, uint32_t);
+
+/**
+ * Get the execution statistics that this cursor has accumulated for one of
+ * its query's patterns since `ts_query_cursor_exec` was last called: how
+ * many in-progress states were created for the pattern, how many of the
+ * pattern's steps were evaluated against a node, and how many distinct
+ * nodes the pattern was evaluated at. This makes it possible to tell which
+ * of a large query's patterns the cursor is spending its time on. The
+ * counters are always collected; `elapsed_nanos` is only collected while
+ * timing is enabled with `ts_query_cursor_set_pattern_timing_enabled`,
+ * because measuring it costs one clock read per state evaluation. Returns
+ * zeroed statistics if `pattern_index` is out of range.
+ */
+TSQueryPatternStats ts_query_cursor_pattern_stats(const TSQueryCursor *, uint32_t pattern_index);
+void ts_query_cursor_set_pattern_timing_enabled(TSQueryCursor *, bool);
+
+/**
+ * Manage the maximum number of steps that the cursor may evaluate on behalf
+ * of any single pattern during one execution, analogous to the match limit
+ * above but scoped to one pattern. When a pattern exhausts the limit, that
+ * pattern alone stops making progress - its in-progress states are dropped
+ * and no new ones are created - while the query's other patterns continue
+ * unaffected, and `exceeded_step_limit` is set in the pattern's statistics.
+ * This bounds the damage that one pathological pattern can do to overall
+ * query latency. By default the limit is zero, meaning unlimited.
+ */
+uint32_t ts_query_cursor_pattern_step_limit(const TSQueryCursor *);
+void ts_query_cursor_set_pattern_step_limit(TSQueryCursor *, uint32_t);
+
+/**
+ * Manage whether `ts_query_cursor_next_capture` filters out duplicate
+ * captures. When a query's patterns overlap, the same node can be captured
+ * with the same capture id by several patterns, and by default each of those
+ * captures is returned separately. With deduplication enabled, each distinct
+ * (node, capture id) pair is returned at most once: because captures are
+ * returned in order of their nodes' start bytes, the cursor only needs to
+ * remember the captures returned at the current start byte, so no extra pass
+ * over the captures is required. Duplicates still count toward their own
+ * match's consumed captures, and `ts_query_cursor_next_match` is unaffected.
+ * Deduplication is off by default and persists across executions.
+ */
+bool ts_query_cursor_deduplicate_captures(const TSQueryCursor *);
+void ts_query_cursor_set_deduplicate_captures(TSQueryCursor *, bool);
+
+/**
+ * Give the cursor access to the text of the document being queried, so that
+ * it can evaluate `#eq?` and `#not-eq?` predicates natively and filter out
+ * failing matches before they are returned. These predicates are resolved
+ * once, when the query is constructed; without this call (or after passing
+ * `NULL`), all predicates are left for the caller to interpret via
+ * `ts_query_predicates_for_pattern`, as before. Other predicates - including
+ * `#match?`, since this library contains no regex engine - are never
+ * evaluated natively and remain the caller's responsibility.
+ *
+ * The text must be the document that the queried tree was parsed from, and
+ * must remain valid until the cursor is reset, deleted, or given different
+ * text. The setting persists across executions.
+ */
+void ts_query_cursor_set_text(TSQueryCursor *, const char *, uint32_t);
+
+/**
+ * Return the cursor to its freshly-created state, ready to be stored in a
+ * pool and used for a later query. This clears the cursor's in-progress
+ * matches, range restrictions, and its reference to the query and tree,
+ * but keeps its internal allocations, so a pooled cursor reaches a steady
+ * state where executing a query allocates nothing at all.
+ */
+void ts_query_cursor_reset(TSQueryCursor *);
+
 /**
  * Set the range of bytes or (row, column) positions in which the query
  * will be executed.
  */
 void ts_query_cursor_set_byte_range(TSQueryCursor *, uint32_t, uint32_t);
+
+/**
+ * Get the number of syntax nodes (counting invisible ones) contained in
+ * subtrees that the cursor stepped over without visiting because they lay
+ * entirely outside of its range restriction. The count is reset each time
+ * the cursor starts executing a query, and is useful for verifying that a
+ * range-restricted query really avoided walking the rest of the tree.
+ */
+uint32_t ts_query_cursor_skipped_node_count(const TSQueryCursor *);
 void ts_query_cursor_set_point_range(TSQueryCursor *, TSPoint, TSPoint);
 
+/**
+ * Restrict the query to a set of disjoint ranges of the document, in
+ * addition to the single range configured by `ts_query_cursor_set_byte_range`
+ * or `ts_query_cursor_set_point_range`. A pattern only matches if its root
+ * node intersects one of the given ranges.
+ *
+ * The ranges must be ordered from earliest to latest in the document, and
+ * they must not overlap; otherwise this returns `false` and the cursor's
+ * ranges are left unchanged. The restriction persists across executions;
+ * pass a count of zero to remove it.
+ */
+bool ts_query_cursor_set_included_ranges(
+  TSQueryCursor *self,
+  const TSRange *ranges,
+  uint32_t count
+);
+
+/**
+ * Start running a given query on a given node, restricted to the parts of
+ * the document that changed between `old_tree` and the node's tree, as
+ * reported by `ts_tree_get_changed_ranges`.
+ *
+ * This is the re-query half of an incremental pipeline: after an edit and
+ * re-parse, run each query with this function and only the matches in the
+ * changed regions are produced, while results previously computed for the
+ * untouched regions remain valid and can be kept. The changed-range
+ * restriction is installed with `ts_query_cursor_set_included_ranges` and
+ * therefore persists on the cursor until it is cleared.
+ */
+void ts_query_cursor_exec_changed(
+  TSQueryCursor *self,
+  const TSQuery *query,
+  TSNode node,
+  const TSTree *old_tree
+);
+
+/**
+ * Start running a given query on a given node, sharded across multiple
+ * cursors so that the matches can be consumed from multiple threads.
+ *
+ * The node's byte range is partitioned into up to `cursor_count` disjoint
+ * spans, split at top-level child boundaries and balanced by size, and each
+ * cursor in `cursors` is restricted to one span and started on the node.
+ * The number of cursors actually started is returned; it can be less than
+ * `cursor_count` if the node does not have enough children. The caller can
+ * then iterate each started cursor from a separate thread: trees and queries
+ * are immutable during query execution and subtree reference counts are
+ * updated atomically, so sharing them between cursors is safe as long as
+ * each individual cursor is only used by one thread at a time.
+ *
+ * Every match rooted below one of the node's children is reported by exactly
+ * one cursor. Matches whose pattern starts at `node` itself intersect every
+ * shard and may be reported by more than one cursor; callers that use such
+ * patterns should deduplicate them by pattern index and root node.
+ */
+uint32_t ts_query_cursor_exec_sharded(
+  const TSQuery *query,
+  TSNode node,
+  TSQueryCursor **cursors,
+  uint32_t cursor_count
+);
+
 /**
  * Advance to the next match of the currently running query.
  *
@@ -874,6 +1530,92 @@ bool ts_query_cursor_next_capture(
   uint32_t *capture_index
 );
 
+/**********************/
+/* Section - Pipeline */
+/**********************/
+
+/**
+ * Create a new pipeline.
+ *
+ * A pipeline bundles a parser, a query cursor, and scratch memory for the
+ * common incremental-update sequence: apply edits to the old tree, reparse,
+ * compute the changed ranges, and re-run a query over the changed part of
+ * the new tree. Performing the sequence through one long-lived pipeline
+ * reuses the buffers that the individual calls would each allocate and
+ * free, and clips the query to the changed ranges so that unchanged
+ * subtrees are not walked again.
+ */
+TSPipeline *ts_pipeline_new(void);
+
+/**
+ * Delete the pipeline, freeing the objects and memory that it owns.
+ */
+void ts_pipeline_delete(TSPipeline *self);
+
+/**
+ * Get the pipeline's parser. Use this to assign the language and to apply
+ * any other parser configuration. The parser is owned by the pipeline and
+ * must not be deleted.
+ */
+TSParser *ts_pipeline_parser(TSPipeline *self);
+
+/**
+ * Get the pipeline's query cursor. Use this to apply cursor configuration
+ * such as the match limit. The cursor is owned by the pipeline, which sets
+ * its byte range on every update; it must not be deleted.
+ */
+TSQueryCursor *ts_pipeline_query_cursor(TSPipeline *self);
+
+/**
+ * Set the query that the pipeline should run after each update, or `NULL`
+ * to stop running a query. The query is not copied, so it must not be
+ * deleted while the pipeline still refers to it.
+ */
+void ts_pipeline_set_query(TSPipeline *self, const TSQuery *query);
+
+/**
+ * Perform one update of the edit -> reparse -> changed-ranges -> query
+ * sequence.
+ *
+ * The `edits` are first applied to `old_tree` in place, as by
+ * `ts_tree_edit_batch`, and the document is reparsed from `input`. The
+ * ranges whose syntactic structure changed are retrievable afterwards via
+ * `ts_pipeline_changed_ranges`, and if a query has been assigned, it is
+ * started over the span of the new tree that covers the edits and those
+ * ranges; retrieve its matches with `ts_pipeline_next_match`. Pass `NULL`
+ * as `old_tree` to
+ * parse the document from scratch, in which case there are no changed
+ * ranges and the query runs over the whole tree.
+ *
+ * Returns the new tree, which is owned by the caller, as is `old_tree`.
+ * Returns `NULL` if parsing was halted by the parser's cancellation flag or
+ * timeout; the edits have been applied at that point, so resume by calling
+ * this function again with the same tree and no edits.
+ */
+TSTree *ts_pipeline_update(
+  TSPipeline *self,
+  TSTree *old_tree,
+  const TSInputEdit *edits,
+  uint32_t edit_count,
+  TSInput input
+);
+
+/**
+ * Get the ranges that changed in the pipeline's most recent update, in the
+ * same form as `ts_tree_get_changed_ranges`. The returned array is owned by
+ * the pipeline and is valid until the next update.
+ */
+const TSRange *ts_pipeline_changed_ranges(const TSPipeline *self, uint32_t *count);
+
+/**
+ * Advance to the next match of the query started by the pipeline's most
+ * recent update. Matches outside the updated byte range are not reported.
+ *
+ * If there is a match, write it to `*match` and return `true`. Otherwise,
+ * return `false`.
+ */
+bool ts_pipeline_next_match(TSPipeline *self, TSQueryMatch *match);
+
 /**********************/
 /* Section - Language */
 /**********************/
@@ -930,6 +1672,31 @@ TSSymbolType ts_language_symbol_type(const TSLanguage *, TSSymbol);
  */
 uint32_t ts_language_version(const TSLanguage *);
 
+/**
+ * Create a copy of the language whose tables are translated to this
+ * library's current `TREE_SITTER_LANGUAGE_VERSION` layout. Data that older
+ * ABI versions lack - the primary-state table, the sorted symbol-name
+ * index, and the dense small-state rows - is synthesized once, up front,
+ * so that every later lookup on the
+ * translated language takes the current version's branch-free fast path
+ * instead of re-checking the version. This lets a fleet keep running
+ * grammars built against older ABIs at full speed during a staged rollout.
+ *
+ * Returns `NULL` if the language's version is outside of the compatible
+ * range; languages already at the current version are still copied, so the
+ * result can always be freed with `ts_language_upgrade_delete`. The
+ * translated language shares its tables with the original, which must
+ * outlive it, and it must itself outlive any parsers, trees, and queries
+ * that use it - the same lifetime rule as a language loaded from a shared
+ * library.
+ */
+const TSLanguage *ts_language_upgrade(const TSLanguage *);
+
+/**
+ * Free a language translation created by `ts_language_upgrade`.
+ */
+void ts_language_upgrade_delete(const TSLanguage *);
+
 /**********************************/
 /* Section - Global Configuration */
 /**********************************/
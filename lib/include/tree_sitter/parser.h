@@ -79,6 +79,12 @@ typedef struct {
   uint16_t external_lex_state;
 } TSLexMode;
 
+typedef struct {
+  const char *text;
+  uint16_t length;
+  TSSymbol symbol;
+} TSKeywordHashEntry;
+
 typedef union {
   TSParseAction action;
   struct {
@@ -124,6 +130,11 @@ struct TSLanguage {
     void (*deserialize)(void *, const char *, unsigned);
   } external_scanner;
   const TSStateId *primary_state_ids;
+  const TSSymbol *symbol_name_index;
+  const uint32_t *small_parse_table_dense_map;
+  const uint16_t *small_parse_table_dense;
+  const TSKeywordHashEntry *keyword_hash_table;
+  uint32_t keyword_hash_table_size;
 };
 
 /*
@@ -1,6 +1,7 @@
 #ifndef TREE_SITTER_ATOMIC_H_
 #define TREE_SITTER_ATOMIC_H_
 
+#include <stdbool.h>
 #include <stdint.h>
 
 #ifdef __TINYC__
@@ -9,6 +10,10 @@ static inline size_t atomic_load(const volatile size_t *p) {
   return *p;
 }
 
+static inline uint32_t atomic_load_u32(const volatile uint32_t *p) {
+  return *p;
+}
+
 static inline uint32_t atomic_inc(volatile uint32_t *p) {
   *p += 1;
   return *p;
@@ -19,6 +24,16 @@ static inline uint32_t atomic_dec(volatile uint32_t *p) {
   return *p;
 }
 
+static inline bool atomic_compare_exchange(
+  volatile uint32_t *p,
+  uint32_t expected,
+  uint32_t desired
+) {
+  if (*p != expected) return false;
+  *p = desired;
+  return true;
+}
+
 #elif defined(_WIN32)
 
 #include <windows.h>
@@ -27,6 +42,10 @@ static inline size_t atomic_load(const volatile size_t *p) {
   return *p;
 }
 
+static inline uint32_t atomic_load_u32(const volatile uint32_t *p) {
+  return InterlockedOr((long volatile *)p, 0);
+}
+
 static inline uint32_t atomic_inc(volatile uint32_t *p) {
   return InterlockedIncrement((long volatile *)p);
 }
@@ -35,6 +54,14 @@ static inline uint32_t atomic_dec(volatile uint32_t *p) {
   return InterlockedDecrement((long volatile *)p);
 }
 
+static inline bool atomic_compare_exchange(
+  volatile uint32_t *p,
+  uint32_t expected,
+  uint32_t desired
+) {
+  return InterlockedCompareExchange((long volatile *)p, desired, expected) == (long)expected;
+}
+
 #else
 
 static inline size_t atomic_load(const volatile size_t *p) {
@@ -45,6 +72,14 @@ static inline size_t atomic_load(const volatile size_t *p) {
 #endif
 }
 
+static inline uint32_t atomic_load_u32(const volatile uint32_t *p) {
+#ifdef __ATOMIC_ACQUIRE
+  return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+#else
+  return __sync_fetch_and_add((volatile uint32_t *)p, 0);
+#endif
+}
+
 static inline uint32_t atomic_inc(volatile uint32_t *p) {
   return __sync_add_and_fetch(p, 1u);
 }
@@ -53,6 +88,14 @@ static inline uint32_t atomic_dec(volatile uint32_t *p) {
   return __sync_sub_and_fetch(p, 1u);
 }
 
+static inline bool atomic_compare_exchange(
+  volatile uint32_t *p,
+  uint32_t expected,
+  uint32_t desired
+) {
+  return __sync_bool_compare_and_swap(p, expected, desired);
+}
+
 #endif
 
 #endif  // TREE_SITTER_ATOMIC_H_
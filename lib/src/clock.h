@@ -48,6 +48,18 @@ static inline bool clock_is_gt(TSClock self, TSClock other) {
   return self > other;
 }
 
+static inline uint64_t clock_elapsed_micros(TSClock base, TSClock now) {
+  LARGE_INTEGER frequency;
+  QueryPerformanceFrequency(&frequency);
+  return (now - base) * 1000000 / (uint64_t)frequency.QuadPart;
+}
+
+static inline uint64_t clock_elapsed_nanos(TSClock base, TSClock now) {
+  LARGE_INTEGER frequency;
+  QueryPerformanceFrequency(&frequency);
+  return (now - base) * 1000000000 / (uint64_t)frequency.QuadPart;
+}
+
 #elif defined(CLOCK_MONOTONIC) && !defined(__APPLE__)
 
 // POSIX with monotonic clock support (Linux)
@@ -95,6 +107,20 @@ static inline bool clock_is_gt(TSClock self, TSClock other) {
   return self.tv_nsec > other.tv_nsec;
 }
 
+static inline uint64_t clock_elapsed_micros(TSClock base, TSClock now) {
+  int64_t nanos =
+    (int64_t)(now.tv_sec - base.tv_sec) * 1000000000 +
+    (int64_t)(now.tv_nsec - base.tv_nsec);
+  return (uint64_t)(nanos / 1000);
+}
+
+static inline uint64_t clock_elapsed_nanos(TSClock base, TSClock now) {
+  int64_t nanos =
+    (int64_t)(now.tv_sec - base.tv_sec) * 1000000000 +
+    (int64_t)(now.tv_nsec - base.tv_nsec);
+  return (uint64_t)nanos;
+}
+
 #else
 
 // macOS or POSIX without monotonic clock support
@@ -136,6 +162,14 @@ static inline bool clock_is_gt(TSClock self, TSClock other) {
   return self > other;
 }
 
+static inline uint64_t clock_elapsed_micros(TSClock base, TSClock now) {
+  return (now - base) * 1000000 / (uint64_t)CLOCKS_PER_SEC;
+}
+
+static inline uint64_t clock_elapsed_nanos(TSClock base, TSClock now) {
+  return (now - base) * 1000000000 / (uint64_t)CLOCKS_PER_SEC;
+}
+
 #endif
 
 #endif  // TREE_SITTER_CLOCK_H_
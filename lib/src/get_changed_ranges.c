@@ -2,6 +2,7 @@
 #include "./subtree.h"
 #include "./language.h"
 #include "./error_costs.h"
+#include "./tree.h"
 #include "./tree_cursor.h"
 #include <assert.h>
 
@@ -354,6 +355,128 @@ static inline void iterator_print_state(Iterator *self) {
 }
 #endif
 
+// Perform one comparison between the two iterators, moving both of them
+// forward. Returns true if the compared span changed, storing its bounds in
+// `change_start` and `change_end`. `position` tracks the current offset and
+// is advanced to the end of the compared span.
+static bool changed_ranges__step(
+  Iterator *old_iter, Iterator *new_iter,
+  const TSRangeArray *included_range_differences,
+  unsigned *included_range_difference_index,
+  Length *position,
+  Length *change_start, Length *change_end
+) {
+  #ifdef DEBUG_GET_CHANGED_RANGES
+  printf("At [%-2u, %-2u] Compare ", position->extent.row + 1, position->extent.column);
+  iterator_print_state(old_iter);
+  printf("\tvs\t");
+  iterator_print_state(new_iter);
+  puts("");
+  #endif
+
+  // Compare the old and new subtrees.
+  IteratorComparison comparison = iterator_compare(old_iter, new_iter);
+
+  // Even if the two subtrees appear to be identical, they could differ
+  // internally if they contain a range of text that was previously
+  // excluded from the parse, and is now included, or vice-versa.
+  if (comparison == IteratorMatches && ts_range_array_intersects(
+    included_range_differences,
+    *included_range_difference_index,
+    position->bytes,
+    iterator_end_position(old_iter).bytes
+  )) {
+    comparison = IteratorMayDiffer;
+  }
+
+  Length next_position = *position;
+  bool is_changed = false;
+  switch (comparison) {
+    // If the subtrees are definitely identical, move to the end
+    // of both subtrees.
+    case IteratorMatches:
+      next_position = iterator_end_position(old_iter);
+      break;
+
+    // If the subtrees might differ internally, descend into both
+    // subtrees, finding the first child that spans the current position.
+    case IteratorMayDiffer:
+      if (iterator_descend(old_iter, position->bytes)) {
+        if (!iterator_descend(new_iter, position->bytes)) {
+          is_changed = true;
+          next_position = iterator_end_position(old_iter);
+        }
+      } else if (iterator_descend(new_iter, position->bytes)) {
+        is_changed = true;
+        next_position = iterator_end_position(new_iter);
+      } else {
+        next_position = length_min(
+          iterator_end_position(old_iter),
+          iterator_end_position(new_iter)
+        );
+      }
+      break;
+
+    // If the subtrees are different, record a change and then move
+    // to the end of both subtrees.
+    case IteratorDiffers:
+      is_changed = true;
+      next_position = length_min(
+        iterator_end_position(old_iter),
+        iterator_end_position(new_iter)
+      );
+      break;
+  }
+
+  // Ensure that both iterators are caught up to the current position.
+  while (
+    !iterator_done(old_iter) &&
+    iterator_end_position(old_iter).bytes <= next_position.bytes
+  ) iterator_advance(old_iter);
+  while (
+    !iterator_done(new_iter) &&
+    iterator_end_position(new_iter).bytes <= next_position.bytes
+  ) iterator_advance(new_iter);
+
+  // Ensure that both iterators are at the same depth in the tree.
+  while (old_iter->visible_depth > new_iter->visible_depth) {
+    iterator_ascend(old_iter);
+  }
+  while (new_iter->visible_depth > old_iter->visible_depth) {
+    iterator_ascend(new_iter);
+  }
+
+  if (is_changed) {
+    #ifdef DEBUG_GET_CHANGED_RANGES
+    printf(
+      "  change: [[%u, %u] - [%u, %u]]\n",
+      position->extent.row + 1, position->extent.column,
+      next_position.extent.row + 1, next_position.extent.column
+    );
+    #endif
+
+    *change_start = *position;
+    *change_end = next_position;
+  }
+
+  *position = next_position;
+
+  // Keep track of the current position in the included range differences
+  // array in order to avoid scanning the entire array on each iteration.
+  while (*included_range_difference_index < included_range_differences->size) {
+    const TSRange *range = &included_range_differences->contents[
+      *included_range_difference_index
+    ];
+    if (range->end_byte <= position->bytes) {
+      (*included_range_difference_index)++;
+    } else {
+      break;
+    }
+  }
+
+  return is_changed;
+}
+
 unsigned ts_subtree_get_changed_ranges(
   const Subtree *old_tree, const Subtree *new_tree,
   TreeCursor *cursor1, TreeCursor *cursor2,
@@ -379,22 +502,364 @@ unsigned ts_subtree_get_changed_ranges(
   }
 
   do {
-    #ifdef DEBUG_GET_CHANGED_RANGES
-    printf("At [%-2u, %-2u] Compare ", position.extent.row + 1, position.extent.column);
-    iterator_print_state(&old_iter);
-    printf("\tvs\t");
-    iterator_print_state(&new_iter);
-    puts("");
-    #endif
+    Length change_start, change_end;
+    if (changed_ranges__step(
+      &old_iter, &new_iter,
+      included_range_differences, &included_range_difference_index,
+      &position, &change_start, &change_end
+    )) {
+      ts_range_array_add(&results, change_start, change_end);
+    }
+  } while (!iterator_done(&old_iter) && !iterator_done(&new_iter));
 
-    // Compare the old and new subtrees.
-    IteratorComparison comparison = iterator_compare(&old_iter, &new_iter);
+  Length old_size = ts_subtree_total_size(*old_tree);
+  Length new_size = ts_subtree_total_size(*new_tree);
+  if (old_size.bytes < new_size.bytes) {
+    ts_range_array_add(&results, old_size, new_size);
+  } else if (new_size.bytes < old_size.bytes) {
+    ts_range_array_add(&results, new_size, old_size);
+  }
 
-    // Even if the two subtrees appear to be identical, they could differ
-    // internally if they contain a range of text that was previously
-    // excluded from the parse, and is now included, or vice-versa.
+  *cursor1 = old_iter.cursor;
+  *cursor2 = new_iter.cursor;
+  *ranges = results.contents;
+  return results.size;
+}
+
+// A pull-based version of the changed-range computation. Instead of walking
+// both trees fully and materializing every range, the iterator performs one
+// comparison step per pull and coalesces adjacent changes on the fly, so a
+// caller that only cares about a window of the document - an editor's
+// visible viewport, for instance - pays for just the part of the walk that
+// reaches it. An optional byte-range clip skips ranges before the window
+// and stops the walk entirely once the position passes its end.
+struct TSChangedRangeIterator {
+  Iterator old_iter;
+  Iterator new_iter;
+  TSRangeArray included_range_differences;
+  unsigned included_range_difference_index;
+  Length position;
+  Length old_size;
+  Length new_size;
+  Length accum_start;
+  Length accum_end;
+  bool has_accum;
+  bool walk_done;
+  bool done;
+  uint32_t clip_start_byte;
+  uint32_t clip_end_byte;
+};
+
+// Fold a newly-discovered change into the accumulated range, mirroring the
+// coalescing that `ts_range_array_add` performs. Returns true if the
+// previous accumulated range is complete, storing it in `flushed`.
+static bool ts_changed_range_iterator__push(
+  TSChangedRangeIterator *self,
+  Length start,
+  Length end,
+  TSRange *flushed
+) {
+  if (self->has_accum && start.bytes <= self->accum_end.bytes) {
+    if (end.bytes > self->accum_end.bytes) self->accum_end = end;
+    return false;
+  }
+  bool did_flush = false;
+  if (self->has_accum) {
+    *flushed = (TSRange) {
+      self->accum_start.extent, self->accum_end.extent,
+      self->accum_start.bytes, self->accum_end.bytes,
+    };
+    did_flush = true;
+  }
+  if (start.bytes < end.bytes) {
+    self->accum_start = start;
+    self->accum_end = end;
+    self->has_accum = true;
+  } else {
+    self->has_accum = false;
+  }
+  return did_flush;
+}
+
+TSChangedRangeIterator *ts_tree_changed_ranges_iter_new(
+  const TSTree *old_tree,
+  const TSTree *new_tree
+) {
+  TSChangedRangeIterator *self = ts_calloc(1, sizeof(TSChangedRangeIterator));
+  TreeCursor cursor1 = {NULL, array_new()};
+  TreeCursor cursor2 = {NULL, array_new()};
+  ts_tree_cursor_init(&cursor1, ts_tree_root_node(old_tree));
+  ts_tree_cursor_init(&cursor2, ts_tree_root_node(new_tree));
+
+  array_init(&self->included_range_differences);
+  ts_range_array_get_changed_ranges(
+    old_tree->included_ranges, old_tree->included_range_count,
+    new_tree->included_ranges, new_tree->included_range_count,
+    &self->included_range_differences
+  );
+
+  self->old_iter = iterator_new(&cursor1, &old_tree->root, old_tree->language);
+  self->new_iter = iterator_new(&cursor2, &new_tree->root, new_tree->language);
+  self->old_size = ts_subtree_total_size(old_tree->root);
+  self->new_size = ts_subtree_total_size(new_tree->root);
+  self->clip_start_byte = 0;
+  self->clip_end_byte = UINT32_MAX;
+
+  Length position = iterator_start_position(&self->old_iter);
+  Length next_position = iterator_start_position(&self->new_iter);
+  if (position.bytes < next_position.bytes) {
+    self->accum_start = position;
+    self->accum_end = next_position;
+    self->has_accum = true;
+    position = next_position;
+  } else if (position.bytes > next_position.bytes) {
+    self->accum_start = next_position;
+    self->accum_end = position;
+    self->has_accum = true;
+  }
+  self->position = position;
+  return self;
+}
+
+void ts_changed_ranges_iter_set_byte_range(
+  TSChangedRangeIterator *self,
+  uint32_t start_byte,
+  uint32_t end_byte
+) {
+  self->clip_start_byte = start_byte;
+  self->clip_end_byte = end_byte;
+}
+
+// Whether a completed range should be handed to the caller, given the
+// current clip window.
+static bool ts_changed_range_iterator__in_clip(
+  const TSChangedRangeIterator *self,
+  const TSRange *range
+) {
+  return (
+    range->end_byte > self->clip_start_byte &&
+    range->start_byte < self->clip_end_byte
+  );
+}
+
+bool ts_changed_ranges_iter_next(TSChangedRangeIterator *self, TSRange *range) {
+  while (!self->done) {
+    // Stop walking once the whole clip window has been covered; everything
+    // that follows would be discarded anyway.
+    if (self->position.bytes >= self->clip_end_byte) {
+      self->done = true;
+      break;
+    }
+
+    if (!self->walk_done) {
+      Length change_start, change_end;
+      bool is_changed = changed_ranges__step(
+        &self->old_iter, &self->new_iter,
+        &self->included_range_differences, &self->included_range_difference_index,
+        &self->position, &change_start, &change_end
+      );
+      if (iterator_done(&self->old_iter) || iterator_done(&self->new_iter)) {
+        self->walk_done = true;
+      }
+      if (is_changed) {
+        TSRange flushed;
+        if (
+          ts_changed_range_iterator__push(self, change_start, change_end, &flushed) &&
+          ts_changed_range_iterator__in_clip(self, &flushed)
+        ) {
+          *range = flushed;
+          return true;
+        }
+      }
+    } else {
+      // The walk is over; account for a difference in total length, then
+      // stop.
+      self->done = true;
+      TSRange flushed;
+      bool did_flush = false;
+      if (self->old_size.bytes < self->new_size.bytes) {
+        did_flush = ts_changed_range_iterator__push(self, self->old_size, self->new_size, &flushed);
+      } else if (self->new_size.bytes < self->old_size.bytes) {
+        did_flush = ts_changed_range_iterator__push(self, self->new_size, self->old_size, &flushed);
+      }
+      if (did_flush && ts_changed_range_iterator__in_clip(self, &flushed)) {
+        *range = flushed;
+        return true;
+      }
+    }
+  }
+
+  // Emit the final accumulated range, if any.
+  if (self->has_accum) {
+    TSRange flushed = (TSRange) {
+      self->accum_start.extent, self->accum_end.extent,
+      self->accum_start.bytes, self->accum_end.bytes,
+    };
+    self->has_accum = false;
+    if (ts_changed_range_iterator__in_clip(self, &flushed)) {
+      *range = flushed;
+      return true;
+    }
+  }
+  return false;
+}
+
+void ts_changed_ranges_iter_delete(TSChangedRangeIterator *self) {
+  array_delete(&self->old_iter.cursor.stack);
+  array_delete(&self->new_iter.cursor.stack);
+  array_delete(&self->included_range_differences);
+  ts_free(self);
+}
+
+// Resolve the visible node an iterator is currently positioned on: the slot
+// holding its subtree (used as a stable identity), its public symbol with
+// aliases applied, and its padded byte-and-point range. Returns false when
+// the iterator is in leading padding with no visible ancestor.
+static bool iterator_visible_node(
+  const Iterator *self,
+  const Subtree **tree,
+  TSSymbol *symbol,
+  Length *start,
+  Length *end
+) {
+  uint32_t i = self->cursor.stack.size - 1;
+
+  if (self->in_padding) {
+    if (i == 0) return false;
+    i--;
+  }
+
+  for (; i + 1 > 0; i--) {
+    TreeCursorEntry entry = self->cursor.stack.contents[i];
+
+    TSSymbol alias_symbol = 0;
+    if (i > 0) {
+      const Subtree *parent = self->cursor.stack.contents[i - 1].subtree;
+      alias_symbol = ts_language_alias_at(
+        self->language,
+        parent->ptr->production_id,
+        entry.structural_child_index
+      );
+    }
+
+    if (ts_subtree_visible(*entry.subtree) || alias_symbol) {
+      *tree = entry.subtree;
+      *symbol = ts_language_public_symbol(
+        self->language,
+        alias_symbol ? alias_symbol : ts_subtree_symbol(*entry.subtree)
+      );
+      *start = length_add(entry.position, ts_subtree_padding(*entry.subtree));
+      *end = length_add(*start, ts_subtree_size(*entry.subtree));
+      return true;
+    }
+  }
+
+  return false;
+}
+
+typedef struct {
+  Array(TSTreeDiffEdit) edits;
+
+  // The most recently reported node on each side. The aligned walk can
+  // compare one node against several successive partners before moving past
+  // it, so each node must be reported at most once.
+  const Subtree *last_old;
+  const Subtree *last_new;
+} TreeDiffContext;
+
+static TSRange ts_tree_diff__range(Length start, Length end) {
+  return (TSRange) {start.extent, end.extent, start.bytes, end.bytes};
+}
+
+static void ts_tree_diff__record_delete(
+  TreeDiffContext *self,
+  const Subtree *tree,
+  TSSymbol symbol,
+  Length start,
+  Length end
+) {
+  if (tree == self->last_old) return;
+  self->last_old = tree;
+  array_push(&self->edits, ((TSTreeDiffEdit) {
+    .type = TSTreeDiffEditDelete,
+    .old_symbol = symbol,
+    .old_range = ts_tree_diff__range(start, end),
+  }));
+}
+
+static void ts_tree_diff__record_insert(
+  TreeDiffContext *self,
+  const Subtree *tree,
+  TSSymbol symbol,
+  Length start,
+  Length end
+) {
+  if (tree == self->last_new) return;
+  self->last_new = tree;
+  array_push(&self->edits, ((TSTreeDiffEdit) {
+    .type = TSTreeDiffEditInsert,
+    .new_symbol = symbol,
+    .new_range = ts_tree_diff__range(start, end),
+  }));
+}
+
+// Record an update pairing two same-symbol nodes. When one of them was
+// already reported - paired with an earlier partner - the remaining side
+// degrades to a plain insert or delete.
+static void ts_tree_diff__record_update(
+  TreeDiffContext *self,
+  const Subtree *old_node, TSSymbol old_symbol, Length old_start, Length old_end,
+  const Subtree *new_node, TSSymbol new_symbol, Length new_start, Length new_end
+) {
+  if (old_node != self->last_old && new_node != self->last_new) {
+    self->last_old = old_node;
+    self->last_new = new_node;
+    array_push(&self->edits, ((TSTreeDiffEdit) {
+      .type = TSTreeDiffEditUpdate,
+      .old_symbol = old_symbol,
+      .new_symbol = new_symbol,
+      .old_range = ts_tree_diff__range(old_start, old_end),
+      .new_range = ts_tree_diff__range(new_start, new_end),
+    }));
+  } else {
+    ts_tree_diff__record_delete(self, old_node, old_symbol, old_start, old_end);
+    ts_tree_diff__record_insert(self, new_node, new_symbol, new_start, new_end);
+  }
+}
+
+TSTreeDiffEdit *ts_tree_diff(
+  const TSTree *old_tree,
+  const TSTree *new_tree,
+  uint32_t *length
+) {
+  TreeDiffContext context = {.edits = array_new()};
+
+  TreeCursor cursor1 = {NULL, array_new()};
+  TreeCursor cursor2 = {NULL, array_new()};
+  ts_tree_cursor_init(&cursor1, ts_tree_root_node(old_tree));
+  ts_tree_cursor_init(&cursor2, ts_tree_root_node(new_tree));
+
+  TSRangeArray included_range_differences = array_new();
+  ts_range_array_get_changed_ranges(
+    old_tree->included_ranges, old_tree->included_range_count,
+    new_tree->included_ranges, new_tree->included_range_count,
+    &included_range_differences
+  );
+  unsigned included_range_difference_index = 0;
+
+  Iterator old_iter = iterator_new(&cursor1, &old_tree->root, old_tree->language);
+  Iterator new_iter = iterator_new(&cursor2, &new_tree->root, new_tree->language);
+
+  Length position = iterator_start_position(&old_iter);
+  Length new_start = iterator_start_position(&new_iter);
+  if (new_start.bytes > position.bytes) position = new_start;
+
+  do {
+    // This mirrors `changed_ranges__step`, but instead of recording the
+    // bytes a difference spans, it records the nodes involved.
+    IteratorComparison comparison = iterator_compare(&old_iter, &new_iter);
     if (comparison == IteratorMatches && ts_range_array_intersects(
-      included_range_differences,
+      &included_range_differences,
       included_range_difference_index,
       position.bytes,
       iterator_end_position(&old_iter).bytes
@@ -402,37 +867,88 @@ unsigned ts_subtree_get_changed_ranges(
       comparison = IteratorMayDiffer;
     }
 
-    bool is_changed = false;
+    const Subtree *old_node = NULL, *new_node = NULL;
+    TSSymbol old_symbol = 0, new_symbol = 0;
+    Length old_start = length_zero(), old_end = length_zero();
+    Length new_node_start = length_zero(), new_end = length_zero();
+    bool has_old = iterator_visible_node(
+      &old_iter, &old_node, &old_symbol, &old_start, &old_end
+    );
+    bool has_new = iterator_visible_node(
+      &new_iter, &new_node, &new_symbol, &new_node_start, &new_end
+    );
+
+    Length next_position = position;
+    bool changed = false;
     switch (comparison) {
-      // If the subtrees are definitely identical, move to the end
-      // of both subtrees.
+      // Identical subtrees contribute nothing to the script.
       case IteratorMatches:
         next_position = iterator_end_position(&old_iter);
         break;
 
-      // If the subtrees might differ internally, descend into both
-      // subtrees, finding the first child that spans the current position.
-      case IteratorMayDiffer:
-        if (iterator_descend(&old_iter, position.bytes)) {
-          if (!iterator_descend(&new_iter, position.bytes)) {
-            is_changed = true;
-            next_position = iterator_end_position(&old_iter);
+      // Same symbol at the same position, but the contents might differ:
+      // descend into both subtrees and let the children decide. When only
+      // one side can descend, or neither can, this pair is the shallowest
+      // point at which the trees stop aligning, so report it as an update.
+      // A descent that fails because an iterator is traversing a token's
+      // padding does not count: the visible node there is an ancestor that
+      // is still being walked, not a mismatched leaf. Unmatched nodes in
+      // the resulting span are picked up while catching up below.
+      case IteratorMayDiffer: {
+        bool old_in_padding = old_iter.in_padding;
+        bool new_in_padding = new_iter.in_padding;
+        bool old_descended = iterator_descend(&old_iter, position.bytes);
+        bool new_descended = iterator_descend(&new_iter, position.bytes);
+
+        // When neither node has children to compare, the pair differs only
+        // if the two nodes occupy different spans or the old node's own
+        // text was edited. A token that an edit merely shifted - marked
+        // `has_changes` but not `content_changed` - still matches its
+        // freshly-lexed counterpart.
+        bool is_pure_shift =
+          !old_descended && !new_descended &&
+          has_old && has_new &&
+          old_start.bytes == new_node_start.bytes &&
+          old_end.bytes == new_end.bytes &&
+          !ts_subtree_content_changed(*old_node);
+
+        if (!(old_descended && new_descended) && !is_pure_shift) {
+          changed = true;
+          if (
+            has_old && has_new &&
+            (old_descended || !old_in_padding) &&
+            (new_descended || !new_in_padding)
+          ) {
+            ts_tree_diff__record_update(
+              &context,
+              old_node, old_symbol, old_start, old_end,
+              new_node, new_symbol, new_node_start, new_end
+            );
           }
-        } else if (iterator_descend(&new_iter, position.bytes)) {
-          is_changed = true;
+        }
+        if (old_descended && !new_descended) {
+          next_position = iterator_end_position(&old_iter);
+        } else if (new_descended && !old_descended) {
           next_position = iterator_end_position(&new_iter);
-        } else {
+        } else if (!old_descended) {
           next_position = length_min(
             iterator_end_position(&old_iter),
             iterator_end_position(&new_iter)
           );
         }
         break;
+      }
 
-      // If the subtrees are different, record a change and then move
-      // to the end of both subtrees.
+      // Different symbols: the old node was removed and the new node was
+      // added.
       case IteratorDiffers:
-        is_changed = true;
+        changed = true;
+        if (has_old) ts_tree_diff__record_delete(
+          &context, old_node, old_symbol, old_start, old_end
+        );
+        if (has_new) ts_tree_diff__record_insert(
+          &context, new_node, new_symbol, new_node_start, new_end
+        );
         next_position = length_min(
           iterator_end_position(&old_iter),
           iterator_end_position(&new_iter)
@@ -440,17 +956,44 @@ unsigned ts_subtree_get_changed_ranges(
         break;
     }
 
-    // Ensure that both iterators are caught up to the current position.
+    // Catch both iterators up to the current position. Within a changed
+    // span, any node an iterator passes over that lies entirely inside the
+    // span has no aligned counterpart: record it as a deletion or an
+    // insertion unless it was already reported above. An old node that an
+    // edit collapsed to zero width was deleted outright, even when the
+    // surrounding span otherwise still aligns.
     while (
       !iterator_done(&old_iter) &&
       iterator_end_position(&old_iter).bytes <= next_position.bytes
-    ) iterator_advance(&old_iter);
+    ) {
+      if (iterator_visible_node(
+        &old_iter, &old_node, &old_symbol, &old_start, &old_end
+      ) && old_start.bytes >= position.bytes && old_end.bytes <= next_position.bytes) {
+        bool is_collapsed =
+          old_start.bytes == old_end.bytes &&
+          ts_subtree_content_changed(*old_node);
+        if (changed || is_collapsed) {
+          ts_tree_diff__record_delete(
+            &context, old_node, old_symbol, old_start, old_end
+          );
+        }
+      }
+      iterator_advance(&old_iter);
+    }
     while (
       !iterator_done(&new_iter) &&
       iterator_end_position(&new_iter).bytes <= next_position.bytes
-    ) iterator_advance(&new_iter);
+    ) {
+      if (changed && iterator_visible_node(
+        &new_iter, &new_node, &new_symbol, &new_node_start, &new_end
+      ) && new_node_start.bytes >= position.bytes && new_end.bytes <= next_position.bytes) {
+        ts_tree_diff__record_insert(
+          &context, new_node, new_symbol, new_node_start, new_end
+        );
+      }
+      iterator_advance(&new_iter);
+    }
 
-    // Ensure that both iterators are at the same depth in the tree.
     while (old_iter.visible_depth > new_iter.visible_depth) {
       iterator_ascend(&old_iter);
     }
@@ -458,24 +1001,10 @@ unsigned ts_subtree_get_changed_ranges(
       iterator_ascend(&new_iter);
     }
 
-    if (is_changed) {
-      #ifdef DEBUG_GET_CHANGED_RANGES
-      printf(
-        "  change: [[%u, %u] - [%u, %u]]\n",
-        position.extent.row + 1, position.extent.column,
-        next_position.extent.row + 1, next_position.extent.column
-      );
-      #endif
-
-      ts_range_array_add(&results, position, next_position);
-    }
-
     position = next_position;
 
-    // Keep track of the current position in the included range differences
-    // array in order to avoid scanning the entire array on each iteration.
-    while (included_range_difference_index < included_range_differences->size) {
-      const TSRange *range = &included_range_differences->contents[
+    while (included_range_difference_index < included_range_differences.size) {
+      const TSRange *range = &included_range_differences.contents[
         included_range_difference_index
       ];
       if (range->end_byte <= position.bytes) {
@@ -486,16 +1015,43 @@ unsigned ts_subtree_get_changed_ranges(
     }
   } while (!iterator_done(&old_iter) && !iterator_done(&new_iter));
 
-  Length old_size = ts_subtree_total_size(*old_tree);
-  Length new_size = ts_subtree_total_size(*new_tree);
-  if (old_size.bytes < new_size.bytes) {
-    ts_range_array_add(&results, old_size, new_size);
-  } else if (new_size.bytes < old_size.bytes) {
-    ts_range_array_add(&results, new_size, old_size);
+  // Whichever tree extends past the other contributes trailing deletions or
+  // insertions.
+  while (!iterator_done(&old_iter)) {
+    const Subtree *node;
+    TSSymbol symbol;
+    Length start, end;
+    if (iterator_visible_node(&old_iter, &node, &symbol, &start, &end)) {
+      ts_tree_diff__record_delete(&context, node, symbol, start, end);
+      uint32_t stop = iterator_end_position(&old_iter).bytes;
+      while (
+        !iterator_done(&old_iter) &&
+        iterator_end_position(&old_iter).bytes <= stop
+      ) iterator_advance(&old_iter);
+    } else {
+      iterator_advance(&old_iter);
+    }
+  }
+  while (!iterator_done(&new_iter)) {
+    const Subtree *node;
+    TSSymbol symbol;
+    Length start, end;
+    if (iterator_visible_node(&new_iter, &node, &symbol, &start, &end)) {
+      ts_tree_diff__record_insert(&context, node, symbol, start, end);
+      uint32_t stop = iterator_end_position(&new_iter).bytes;
+      while (
+        !iterator_done(&new_iter) &&
+        iterator_end_position(&new_iter).bytes <= stop
+      ) iterator_advance(&new_iter);
+    } else {
+      iterator_advance(&new_iter);
+    }
   }
 
-  *cursor1 = old_iter.cursor;
-  *cursor2 = new_iter.cursor;
-  *ranges = results.contents;
-  return results.size;
+  array_delete(&old_iter.cursor.stack);
+  array_delete(&new_iter.cursor.stack);
+  array_delete(&included_range_differences);
+
+  *length = context.edits.size;
+  return context.edits.contents;
 }
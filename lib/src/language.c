@@ -1,6 +1,7 @@
 #include "./language.h"
 #include "./subtree.h"
 #include "./error_costs.h"
+#include <stddef.h>
 #include <string.h>
 
 uint32_t ts_language_symbol_count(const TSLanguage *self) {
@@ -79,6 +80,37 @@ TSSymbol ts_language_symbol_for_name(
 ) {
   if (!strncmp(string, "ERROR", length)) return ts_builtin_sym_error;
   uint32_t count = ts_language_symbol_count(self);
+
+  // Languages generated with ABI version 15 or newer include an index of
+  // the symbols sorted by name, which allows a binary search here instead
+  // of a scan over every symbol name.
+  if (self->version >= 15 && self->symbol_name_index) {
+    uint32_t low = 0, high = count;
+    while (low < high) {
+      uint32_t mid = (low + high) / 2;
+      const char *symbol_name = self->symbol_names[self->symbol_name_index[mid]];
+      int comparison = strncmp(symbol_name, string, length);
+      if (comparison == 0 && symbol_name[length]) comparison = 1;
+      if (comparison < 0) {
+        low = mid + 1;
+      } else {
+        high = mid;
+      }
+    }
+
+    // Several symbols can share a name; walk the run of equal names to
+    // find one with the right visibility and named-ness.
+    for (uint32_t i = low; i < count; i++) {
+      TSSymbol symbol = self->symbol_name_index[i];
+      const char *symbol_name = self->symbol_names[symbol];
+      if (strncmp(symbol_name, string, length) || symbol_name[length]) break;
+      TSSymbolMetadata metadata = ts_language_symbol_metadata(self, symbol);
+      if ((!metadata.visible && !metadata.supertype) || metadata.named != is_named) continue;
+      return self->public_symbol_map[symbol];
+    }
+    return 0;
+  }
+
   for (TSSymbol i = 0; i < count; i++) {
     TSSymbolMetadata metadata = ts_language_symbol_metadata(self, i);
     if ((!metadata.visible && !metadata.supertype) || metadata.named != is_named) continue;
@@ -121,17 +153,169 @@ TSFieldId ts_language_field_id_for_name(
   const char *name,
   uint32_t name_length
 ) {
+  // Field names are stored in sorted order, so they can be binary-searched.
   uint32_t count = ts_language_field_count(self);
-  for (TSSymbol i = 1; i < count + 1; i++) {
-    switch (strncmp(name, self->field_names[i], name_length)) {
-      case 0:
-        if (self->field_names[i][name_length] == 0) return i;
-        break;
-      case -1:
-        return 0;
-      default:
-        break;
+  uint32_t low = 1, high = count + 1;
+  while (low < high) {
+    uint32_t mid = (low + high) / 2;
+    const char *field_name = self->field_names[mid];
+    int comparison = strncmp(field_name, name, name_length);
+    if (comparison == 0 && field_name[name_length]) comparison = 1;
+    if (comparison < 0) {
+      low = mid + 1;
+    } else if (comparison > 0) {
+      high = mid;
+    } else {
+      return mid;
     }
   }
   return 0;
 }
+
+// Build, or just measure, the dense row for one small state, given the
+// state's grouped sections. Returns the number of table slots the row
+// needs, or zero when the grouped form is at least as compact, in which
+// case nothing is written. Mirrors the per-state choice the generator
+// makes for ABI version 16 grammars.
+static uint32_t ts_language__small_state_dense_row(
+  const uint16_t *data,
+  uint16_t *row
+) {
+  const uint16_t *entry = data;
+  uint16_t group_count = *(entry++);
+  if (group_count == 0) return 0;
+  uint16_t min_symbol = UINT16_MAX, max_symbol = 0;
+  for (unsigned i = 0; i < group_count; i++) {
+    entry++;
+    uint16_t symbol_count = *(entry++);
+    for (unsigned j = 0; j < symbol_count; j++) {
+      uint16_t symbol = *(entry++);
+      if (symbol < min_symbol) min_symbol = symbol;
+      if (symbol > max_symbol) max_symbol = symbol;
+    }
+  }
+  uint32_t grouped_size = (uint32_t)(entry - data);
+  uint32_t dense_size = 2 + (uint32_t)(max_symbol - min_symbol) + 1;
+  if (dense_size > grouped_size) return 0;
+  if (row) {
+    memset(row, 0, dense_size * sizeof(uint16_t));
+    row[0] = min_symbol;
+    row[1] = (uint16_t)(dense_size - 2);
+    entry = data + 1;
+    for (unsigned i = 0; i < group_count; i++) {
+      uint16_t value = *(entry++);
+      uint16_t symbol_count = *(entry++);
+      for (unsigned j = 0; j < symbol_count; j++) {
+        row[2 + *(entry++) - min_symbol] = value;
+      }
+    }
+  }
+  return dense_size;
+}
+
+const TSLanguage *ts_language_upgrade(const TSLanguage *self) {
+  if (
+    !self ||
+    self->version > TREE_SITTER_LANGUAGE_VERSION ||
+    self->version < TREE_SITTER_MIN_COMPATIBLE_LANGUAGE_VERSION
+  ) return NULL;
+
+  // Lay out the translated table and any synthesized arrays in a single
+  // allocation, so that the whole translation can be freed at once without
+  // tracking which fields were synthesized and which are shared with the
+  // original table.
+  uint32_t symbol_count = ts_language_symbol_count(self);
+  uint32_t small_state_count = self->state_count - self->large_state_count;
+  bool needs_primary_states = self->version < 14;
+  bool needs_name_index = self->version < 15 || !self->symbol_name_index;
+  bool needs_dense_rows =
+    self->version < 16 && small_state_count > 0 && self->small_parse_table;
+  size_t size = sizeof(TSLanguage);
+  size_t dense_map_offset = size;
+  if (needs_dense_rows) size += small_state_count * sizeof(uint32_t);
+  size_t primary_states_offset = size;
+  if (needs_primary_states) size += self->state_count * sizeof(TSStateId);
+  size_t name_index_offset = size;
+  if (needs_name_index) size += symbol_count * sizeof(TSSymbol);
+  size_t dense_rows_offset = size;
+  uint32_t dense_rows_size = 1;
+  if (needs_dense_rows) {
+    for (uint32_t i = 0; i < small_state_count; i++) {
+      dense_rows_size += ts_language__small_state_dense_row(
+        &self->small_parse_table[self->small_parse_table_map[i]],
+        NULL
+      );
+    }
+    size += dense_rows_size * sizeof(uint16_t);
+  }
+
+  char *buffer = ts_malloc(size);
+  TSLanguage *result = (TSLanguage *)(void *)buffer;
+  memset(result, 0, sizeof(TSLanguage));
+  size_t prefix_size =
+    self->version < 14 ? offsetof(TSLanguage, primary_state_ids) :
+    self->version < 15 ? offsetof(TSLanguage, symbol_name_index) :
+    self->version < 16 ? offsetof(TSLanguage, small_parse_table_dense_map) :
+    sizeof(TSLanguage);
+  memcpy(result, self, prefix_size);
+
+  // Older tables have no primary-state information, and every state counts
+  // as primary. An identity mapping preserves that behavior while letting
+  // `ts_language_state_is_primary` use its single unconditional lookup.
+  if (needs_primary_states) {
+    TSStateId *primary_state_ids = (TSStateId *)(void *)(buffer + primary_states_offset);
+    for (uint32_t i = 0; i < self->state_count; i++) primary_state_ids[i] = i;
+    result->primary_state_ids = primary_state_ids;
+  }
+
+  // Older tables also predate the sorted symbol-name index. Building it
+  // here gives upgraded grammars the same binary-searched
+  // `ts_language_symbol_for_name` as freshly generated ones. The symbol
+  // counts are small and this runs once, so a simple insertion sort will do.
+  if (needs_name_index) {
+    TSSymbol *symbol_name_index = (TSSymbol *)(void *)(buffer + name_index_offset);
+    for (uint32_t i = 0; i < symbol_count; i++) {
+      TSSymbol symbol = i;
+      uint32_t j = i;
+      while (j > 0 && strcmp(
+        self->symbol_names[symbol_name_index[j - 1]],
+        self->symbol_names[symbol]
+      ) > 0) {
+        symbol_name_index[j] = symbol_name_index[j - 1];
+        j--;
+      }
+      symbol_name_index[j] = symbol;
+    }
+    result->symbol_name_index = symbol_name_index;
+  }
+
+  // Pre-16 tables store every small state in the grouped encoding, which
+  // costs a linear scan per lookup. Re-encode the states whose dense row
+  // would be no larger, exactly as the version 16 generator would have,
+  // so that upgraded grammars also get constant-time action lookups in
+  // their token-dense states. Offset zero of the row table is reserved to
+  // mean "no dense row"; those states keep the shared grouped sections.
+  if (needs_dense_rows) {
+    uint32_t *dense_map = (uint32_t *)(void *)(buffer + dense_map_offset);
+    uint16_t *dense_rows = (uint16_t *)(void *)(buffer + dense_rows_offset);
+    dense_rows[0] = 0;
+    uint32_t next_row = 1;
+    for (uint32_t i = 0; i < small_state_count; i++) {
+      uint32_t row_size = ts_language__small_state_dense_row(
+        &self->small_parse_table[self->small_parse_table_map[i]],
+        &dense_rows[next_row]
+      );
+      dense_map[i] = row_size ? next_row : 0;
+      next_row += row_size;
+    }
+    result->small_parse_table_dense_map = dense_map;
+    result->small_parse_table_dense = dense_rows;
+  }
+
+  result->version = TREE_SITTER_LANGUAGE_VERSION;
+  return result;
+}
+
+void ts_language_upgrade_delete(const TSLanguage *self) {
+  ts_free((void *)self);
+}
@@ -5,6 +5,8 @@
 extern "C" {
 #endif
 
+#include <string.h>
+
 #include "./subtree.h"
 #include "tree_sitter/parser.h"
 
@@ -25,6 +27,7 @@ typedef struct {
   uint16_t section_index;
   uint16_t group_count;
   bool is_small_state;
+  bool is_dense_state;
 
   const TSParseAction *actions;
   TSSymbol symbol;
@@ -64,19 +67,69 @@ static inline bool ts_language_has_reduce_action(
   return entry.action_count > 0 && entry.actions[0].type == TSParseActionTypeReduce;
 }
 
+// Get the dense row for a small parse state, if the state has one.
+//
+// Languages generated with ABI version 16 or newer can store some of their
+// small states in a dense encoding: a minimum symbol, a symbol span, and a
+// row of table values indexed directly by `symbol - minimum`, chosen at
+// generation time whenever that row is no larger than the grouped sections.
+// Offset zero of the dense table is reserved so that a zero map entry means
+// the state has only the grouped representation.
+static inline const uint16_t *ts_language_small_state_dense_row(
+  const TSLanguage *self,
+  TSStateId state
+) {
+  if (self->version >= 16 && self->small_parse_table_dense) {
+    uint32_t index = self->small_parse_table_dense_map[state - self->large_state_count];
+    if (index) return &self->small_parse_table_dense[index];
+  }
+  return NULL;
+}
+
+// Look up a keyword by the token's exact text.
+//
+// Languages generated with ABI version 16 or newer can carry a perfect-hash
+// table of their keyword strings: each keyword occupies one slot, chosen at
+// generation time so that no two keywords collide, and unused slots are left
+// empty. Returns zero when the text is not a keyword. The hash function must
+// match the one in the generator.
+static inline TSSymbol ts_language_keyword_lookup(
+  const TSLanguage *self,
+  const char *text,
+  uint32_t length
+) {
+  uint32_t hash = 2166136261u;
+  for (uint32_t i = 0; i < length; i++) {
+    hash ^= (uint8_t)text[i];
+    hash *= 16777619u;
+  }
+  const TSKeywordHashEntry *entry =
+    &self->keyword_hash_table[hash % self->keyword_hash_table_size];
+  if (entry->text && entry->length == length && memcmp(entry->text, text, length) == 0) {
+    return entry->symbol;
+  }
+  return 0;
+}
+
 // Lookup the table value for a given symbol and state.
 //
 // For non-terminal symbols, the table value represents a successor state.
 // For terminal symbols, it represents an index in the actions table.
 // For 'large' parse states, this is a direct lookup. For 'small' parse
-// states, this requires searching through the symbol groups to find
-// the given symbol.
+// states with a dense row, it is a bounds check and a direct lookup; the
+// remaining small states require searching through the symbol groups to
+// find the given symbol.
 static inline uint16_t ts_language_lookup(
   const TSLanguage *self,
   TSStateId state,
   TSSymbol symbol
 ) {
   if (state >= self->large_state_count) {
+    const uint16_t *row = ts_language_small_state_dense_row(self, state);
+    if (row) {
+      uint32_t offset = (uint32_t)symbol - (uint32_t)row[0];
+      return offset < row[1] ? row[2 + offset] : 0;
+    }
     uint32_t index = self->small_parse_table_map[state - self->large_state_count];
     const uint16_t *data = &self->small_parse_table[index];
     uint16_t group_count = *(data++);
@@ -112,14 +165,24 @@ static inline LookaheadIterator ts_language_lookaheads(
   TSStateId state
 ) {
   bool is_small_state = state >= self->large_state_count;
+  bool is_dense_state = false;
   const uint16_t *data;
   const uint16_t *group_end = NULL;
   uint16_t group_count = 0;
+  TSSymbol symbol = UINT16_MAX;
   if (is_small_state) {
-    uint32_t index = self->small_parse_table_map[state - self->large_state_count];
-    data = &self->small_parse_table[index];
-    group_end = data + 1;
-    group_count = *data;
+    const uint16_t *row = ts_language_small_state_dense_row(self, state);
+    if (row) {
+      is_dense_state = true;
+      data = row + 1;
+      group_end = row + 2 + row[1];
+      symbol = (TSSymbol)(row[0] - 1);
+    } else {
+      uint32_t index = self->small_parse_table_map[state - self->large_state_count];
+      data = &self->small_parse_table[index];
+      group_end = data + 1;
+      group_count = *data;
+    }
   } else {
     data = &self->parse_table[state * self->symbol_count] - 1;
   }
@@ -129,16 +192,28 @@ static inline LookaheadIterator ts_language_lookaheads(
     .group_end = group_end,
     .group_count = group_count,
     .is_small_state = is_small_state,
-    .symbol = UINT16_MAX,
+    .is_dense_state = is_dense_state,
+    .symbol = symbol,
     .next_state = 0,
   };
 }
 
 static inline bool ts_lookahead_iterator_next(LookaheadIterator *self) {
-  // For small parse states, valid symbols are listed explicitly,
-  // grouped by their value. There's no need to look up the actions
-  // again until moving to the next group.
-  if (self->is_small_state) {
+  // For dense small states, iterate through the row's symbol span,
+  // skipping the symbols with no table value.
+  if (self->is_dense_state) {
+    do {
+      self->data++;
+      self->symbol++;
+      if (self->data == self->group_end) return false;
+      self->table_value = *self->data;
+    } while (!self->table_value);
+  }
+
+  // For the remaining small parse states, valid symbols are listed
+  // explicitly, grouped by their value. There's no need to look up the
+  // actions again until moving to the next group.
+  else if (self->is_small_state) {
     self->data++;
     if (self->data == self->group_end) {
       if (self->group_count == 0) return false;
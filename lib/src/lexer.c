@@ -1,4 +1,9 @@
 #include <stdio.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "./atomic.h"
 #include "./lexer.h"
 #include "./subtree.h"
 #include "./length.h"
@@ -50,12 +55,25 @@ static void ts_lexer__clear_chunk(Lexer *self) {
   self->chunk = NULL;
   self->chunk_size = 0;
   self->chunk_start = 0;
+  self->ascii_span_start = 0;
+  self->ascii_span_end = 0;
 }
 
 // Call the lexer's input callback to obtain a new chunk of source code
-// for the current position.
+// for the current position. If the parse has been cancelled, report
+// end-of-input instead of reading more text, so that a token scan in
+// progress terminates within one chunk rather than running to the end of
+// the token.
 static void ts_lexer__get_chunk(Lexer *self) {
   self->chunk_start = self->current_position.bytes;
+  if (self->cancellation_flag && atomic_load(self->cancellation_flag)) {
+    self->chunk = NULL;
+    self->chunk_size = 0;
+    self->current_included_range_index = self->included_range_count;
+    self->ascii_span_start = self->chunk_start;
+    self->ascii_span_end = self->chunk_start;
+    return;
+  }
   self->chunk = self->input.read(
     self->input.payload,
     self->current_position.bytes,
@@ -66,6 +84,37 @@ static void ts_lexer__get_chunk(Lexer *self) {
     self->current_included_range_index = self->included_range_count;
     self->chunk = NULL;
   }
+  self->ascii_span_start = self->chunk_start;
+  self->ascii_span_end = self->chunk_start;
+}
+
+// Classify the span of bytes, starting at the current position, that are
+// known to be ASCII. Whole blocks of the chunk are classified at a time -
+// sixteen bytes with SSE2, otherwise eight bytes at a time with a wide
+// integer - and a scalar loop finds the exact boundary within the block that
+// stopped the scan. While the current position stays inside the resulting
+// span, the lookahead is just the next byte and no decoding is needed.
+static void ts_lexer__scan_ascii_span(Lexer *self) {
+  const uint8_t *chunk = (const uint8_t *)self->chunk;
+  uint32_t offset = self->current_position.bytes - self->chunk_start;
+  uint32_t end = self->chunk_size;
+  self->ascii_span_start = self->current_position.bytes;
+#ifdef __SSE2__
+  while (offset + 16 <= end) {
+    __m128i bytes = _mm_loadu_si128((const __m128i *)(chunk + offset));
+    if (_mm_movemask_epi8(bytes) != 0) break;
+    offset += 16;
+  }
+#else
+  while (offset + 8 <= end) {
+    uint64_t bytes;
+    memcpy(&bytes, chunk + offset, sizeof(bytes));
+    if (bytes & 0x8080808080808080ull) break;
+    offset += 8;
+  }
+#endif
+  while (offset < end && chunk[offset] < 0x80) offset++;
+  self->ascii_span_end = self->chunk_start + offset;
 }
 
 // Decode the next unicode character in the current chunk of source code.
@@ -82,6 +131,30 @@ static void ts_lexer__get_lookahead(Lexer *self) {
   }
 
   const uint8_t *chunk = (const uint8_t *)self->chunk + position_in_chunk;
+
+  // Single-byte characters dominate most source code: inside a span that
+  // has been classified as pure ASCII, the lookahead is just the next byte
+  // and a single range check replaces the decode dispatch. Spans are
+  // scanned lazily: when the position leaves the current span and the next
+  // byte is ASCII, the classifier runs forward from there, so the block
+  // scan's cost is amortized over the length of the span, and non-ASCII
+  // bytes go straight to the decoder.
+  if (self->input.encoding == TSInputEncodingUTF8) {
+    uint32_t position = self->current_position.bytes;
+    bool in_span =
+      self->ascii_span_start <= position &&
+      position < self->ascii_span_end;
+    if (!in_span && *chunk < 0x80) {
+      ts_lexer__scan_ascii_span(self);
+      in_span = true;
+    }
+    if (in_span) {
+      self->lookahead_size = 1;
+      self->data.lookahead = *chunk;
+      return;
+    }
+  }
+
   UnicodeDecodeFunction decode = self->input.encoding == TSInputEncodingUTF8
     ? ts_decode_utf8
     : ts_decode_utf16;
@@ -159,6 +232,7 @@ static void ts_lexer__do_advance(Lexer *self, bool skip) {
     if (self->data.lookahead == '\n') {
       self->current_position.extent.row++;
       self->current_position.extent.column = 0;
+      array_push(&self->observed_line_starts, self->current_position);
     } else {
       self->current_position.extent.column += self->lookahead_size;
     }
@@ -289,6 +363,8 @@ void ts_lexer_init(Lexer *self) {
     .chunk = NULL,
     .chunk_size = 0,
     .chunk_start = 0,
+    .ascii_span_start = 0,
+    .ascii_span_end = 0,
     .current_position = {0, {0, 0}},
     .logger = {
       .payload = NULL,
@@ -297,12 +373,15 @@ void ts_lexer_init(Lexer *self) {
     .included_ranges = NULL,
     .included_range_count = 0,
     .current_included_range_index = 0,
+    .cancellation_flag = NULL,
+    .observed_line_starts = array_new(),
   };
   ts_lexer_set_included_ranges(self, NULL, 0);
 }
 
 void ts_lexer_delete(Lexer *self) {
   ts_free(self->included_ranges);
+  array_delete(&self->observed_line_starts);
 }
 
 void ts_lexer_set_input(Lexer *self, TSInput input) {
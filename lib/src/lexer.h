@@ -25,9 +25,23 @@ typedef struct {
   uint32_t current_included_range_index;
   uint32_t chunk_start;
   uint32_t chunk_size;
+  uint32_t ascii_span_start;
+  uint32_t ascii_span_end;
   uint32_t lookahead_size;
   bool did_get_column;
 
+  // The parser's cancellation flag, if one was provided. When the flag
+  // becomes non-zero, the lexer reports end-of-input at the next chunk
+  // boundary so that a long scan returns promptly; the parser then checks
+  // the flag itself and discards the truncated token.
+  const volatile size_t *cancellation_flag;
+
+  // The positions just after each newline that the lexer has advanced past
+  // during the current parse. The parser assembles these into the finished
+  // tree's line-offset index. Re-lexed regions produce duplicate entries;
+  // later observations of the same row simply overwrite earlier ones.
+  Array(Length) observed_line_starts;
+
   char debug_buffer[TREE_SITTER_SERIALIZATION_BUFFER_SIZE];
 } Lexer;
 
@@ -11,8 +11,11 @@
 #include "./lexer.c"
 #include "./node.c"
 #include "./parser.c"
+#include "./pipeline.c"
 #include "./query.c"
 #include "./stack.c"
 #include "./subtree.c"
 #include "./tree_cursor.c"
 #include "./tree.c"
+#include "./tree_cache.c"
+#include "./tree_serialization.c"
@@ -12,6 +12,11 @@ typedef struct {
   const TSSymbol *alias_sequence;
 } NodeChildIterator;
 
+typedef struct {
+  TSNode node;
+  uint32_t index;
+} NodeWithIndex;
+
 // TSNode - constructors
 
 TSNode ts_node_new(
@@ -323,6 +328,77 @@ static inline TSNode ts_node__first_child_for_byte(
   return ts_node__null();
 }
 
+// If `self` is the root node of a tree with a descendant index, find the
+// deepest index entry that contains the given byte range and return it as
+// a starting point for the descent. The entries are disjoint named nodes
+// in traversal order, so at most one of them can contain a given range,
+// and a binary search by start byte finds it.
+static inline TSNode ts_node__indexed_start_for_byte_range(
+  TSNode self,
+  uint32_t range_start,
+  uint32_t range_end
+) {
+  const TSTree *tree = self.tree;
+  if (!tree || !tree->descendant_index) return self;
+  TSNode root = ts_tree_root_node(tree);
+  if (
+    self.id != root.id ||
+    self.context[0] != root.context[0] ||
+    self.context[1] != root.context[1] ||
+    self.context[2] != root.context[2]
+  ) return self;
+
+  const TSNode *entries = tree->descendant_index;
+  uint32_t low = 0, high = tree->descendant_index_size;
+  while (low < high) {
+    uint32_t mid = low + (high - low) / 2;
+    if (ts_node_start_byte(entries[mid]) <= range_start) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  if (low == 0) return self;
+
+  TSNode entry = entries[low - 1];
+  uint32_t entry_end = ts_node_end_byte(entry);
+  if (entry_end >= range_end && entry_end > range_start) return entry;
+  return self;
+}
+
+static inline TSNode ts_node__indexed_start_for_point_range(
+  TSNode self,
+  TSPoint range_start,
+  TSPoint range_end
+) {
+  const TSTree *tree = self.tree;
+  if (!tree || !tree->descendant_index) return self;
+  TSNode root = ts_tree_root_node(tree);
+  if (
+    self.id != root.id ||
+    self.context[0] != root.context[0] ||
+    self.context[1] != root.context[1] ||
+    self.context[2] != root.context[2]
+  ) return self;
+
+  const TSNode *entries = tree->descendant_index;
+  uint32_t low = 0, high = tree->descendant_index_size;
+  while (low < high) {
+    uint32_t mid = low + (high - low) / 2;
+    if (point_lte(ts_node_start_point(entries[mid]), range_start)) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  if (low == 0) return self;
+
+  TSNode entry = entries[low - 1];
+  TSPoint entry_end = ts_node_end_point(entry);
+  if (point_lte(range_end, entry_end) && point_lt(range_start, entry_end)) return entry;
+  return self;
+}
+
 static inline TSNode ts_node__descendant_for_byte_range(
   TSNode self,
   uint32_t range_start,
@@ -650,6 +726,7 @@ TSNode ts_node_descendant_for_byte_range(
   uint32_t start,
   uint32_t end
 ) {
+  self = ts_node__indexed_start_for_byte_range(self, start, end);
   return ts_node__descendant_for_byte_range(self, start, end, true);
 }
 
@@ -658,6 +735,7 @@ TSNode ts_node_named_descendant_for_byte_range(
   uint32_t start,
   uint32_t end
 ) {
+  self = ts_node__indexed_start_for_byte_range(self, start, end);
   return ts_node__descendant_for_byte_range(self, start, end, false);
 }
 
@@ -666,6 +744,7 @@ TSNode ts_node_descendant_for_point_range(
   TSPoint start,
   TSPoint end
 ) {
+  self = ts_node__indexed_start_for_point_range(self, start, end);
   return ts_node__descendant_for_point_range(self, start, end, true);
 }
 
@@ -674,9 +753,66 @@ TSNode ts_node_named_descendant_for_point_range(
   TSPoint start,
   TSPoint end
 ) {
+  self = ts_node__indexed_start_for_point_range(self, start, end);
   return ts_node__descendant_for_point_range(self, start, end, false);
 }
 
+uint32_t ts_node_compact_id(TSNode self) {
+  if (!self.id) return UINT32_MAX;
+  uint32_t target_start = ts_node_start_byte(self);
+  uint32_t target_end = ts_node_end_byte(self);
+
+  // Search downward from the root, visiting only the children whose ranges
+  // contain the target node's range. Multiple children can qualify when the
+  // target is zero-width and sits on a boundary between siblings, so keep
+  // a stack of candidates rather than descending greedily.
+  NodeWithIndex entry = {ts_tree_root_node(self.tree), 0};
+  Array(NodeWithIndex) candidates = array_new();
+  uint32_t result = UINT32_MAX;
+  for (;;) {
+    if (entry.node.id == self.id) {
+      result = entry.index;
+      break;
+    }
+    uint32_t child_index = entry.index + 1;
+    TSNode child;
+    NodeChildIterator iterator = ts_node_iterate_children(&entry.node);
+    while (ts_node_child_iterator_next(&iterator, &child)) {
+      uint32_t child_start = ts_node_start_byte(child);
+      uint32_t child_end = ts_node_end_byte(child);
+      if (child_start <= target_start && child_end >= target_end) {
+        array_push(&candidates, ((NodeWithIndex) {child, child_index}));
+      }
+      child_index += ts_subtree_node_count(ts_node__subtree(child));
+    }
+    if (candidates.size == 0) break;
+    entry = array_pop(&candidates);
+  }
+  array_delete(&candidates);
+  return result;
+}
+
+TSNode ts_tree_node_for_id(const TSTree *self, uint32_t id) {
+  TSNode node = ts_tree_root_node(self);
+  if (id >= ts_subtree_node_count(ts_node__subtree(node))) return ts_node__null();
+  uint32_t index = 0;
+  while (index < id) {
+    uint32_t child_index = index + 1;
+    TSNode child;
+    NodeChildIterator iterator = ts_node_iterate_children(&node);
+    while (ts_node_child_iterator_next(&iterator, &child)) {
+      uint32_t child_node_count = ts_subtree_node_count(ts_node__subtree(child));
+      if (id < child_index + child_node_count) {
+        node = child;
+        index = child_index;
+        break;
+      }
+      child_index += child_node_count;
+    }
+  }
+  return node;
+}
+
 void ts_node_edit(TSNode *self, const TSInputEdit *edit) {
   uint32_t start_byte = ts_node_start_byte(*self);
   TSPoint start_point = ts_node_start_point(*self);
@@ -3,6 +3,13 @@
 #include <stdio.h>
 #include <limits.h>
 #include <stdbool.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 #include "tree_sitter/api.h"
 #include "./alloc.h"
 #include "./array.h"
@@ -77,12 +84,31 @@ static const unsigned MAX_SUMMARY_DEPTH = 16;
 static const unsigned MAX_COST_DIFFERENCE = 16 * ERROR_COST_PER_SKIPPED_TREE;
 static const unsigned OP_COUNT_PER_TIMEOUT_CHECK = 100;
 
+#ifndef TREE_SITTER_TOKEN_CACHE_SIZE
+#define TREE_SITTER_TOKEN_CACHE_SIZE 16
+#endif
+
 typedef struct {
   Subtree token;
   Subtree last_external_token;
   uint32_t byte_index;
+} TokenCacheEntry;
+
+typedef struct {
+  TokenCacheEntry entries[TREE_SITTER_TOKEN_CACHE_SIZE];
 } TokenCache;
 
+// The most recent parse-table lookup performed while verifying reusable
+// nodes. When a candidate node is broken down because it contains changes,
+// each of its descendants along the left spine has the same first leaf, so
+// consecutive verifications tend to query the same state and symbol.
+typedef struct {
+  TSStateId state;
+  TSSymbol symbol;
+  TableEntry entry;
+  bool valid;
+} ReuseVerificationCache;
+
 struct TSParser {
   Lexer lexer;
   Stack *stack;
@@ -94,8 +120,17 @@ struct TSParser {
   SubtreeArray trailing_extras2;
   SubtreeArray scratch_trees;
   TokenCache token_cache;
+  ReuseVerificationCache reuse_verification;
   ReusableNode reusable_node;
   void *external_scanner_payload;
+  // The serialized state that the external scanner's live (heap) state is
+  // currently known to correspond to, so that restoring the same state
+  // repeatedly - as happens on stack-version splits and token reuse checks -
+  // can skip the deserialize call. Invalid whenever the scanner may have
+  // mutated its state since the last serialize.
+  char external_scanner_state_buffer[TREE_SITTER_SERIALIZATION_BUFFER_SIZE];
+  uint32_t external_scanner_state_buffer_length;
+  bool external_scanner_state_buffer_valid;
   FILE *dot_graph_file;
   TSClock end_clock;
   TSDuration timeout_duration;
@@ -105,6 +140,11 @@ struct TSParser {
   Subtree old_tree;
   TSRangeArray included_range_differences;
   unsigned included_range_difference_index;
+  uint32_t max_tree_depth;
+  TSRecoveryBudget recovery_budget;
+  size_t max_memory;
+  bool memory_exhausted;
+  TSParserStats stats;
 };
 
 typedef struct {
@@ -336,15 +376,25 @@ static void ts_parser__restore_external_scanner(
   TSParser *self,
   Subtree external_token
 ) {
+  const char *data = NULL;
+  uint32_t length = 0;
   if (external_token.ptr) {
-    self->language->external_scanner.deserialize(
-      self->external_scanner_payload,
-      ts_external_scanner_state_data(&external_token.ptr->external_scanner_state),
-      external_token.ptr->external_scanner_state.length
-    );
-  } else {
-    self->language->external_scanner.deserialize(self->external_scanner_payload, NULL, 0);
+    data = ts_external_scanner_state_data(&external_token.ptr->external_scanner_state);
+    length = external_token.ptr->external_scanner_state.length;
   }
+
+  // If the scanner's live state already corresponds to these bytes, the
+  // deserialize call can be skipped entirely.
+  if (
+    self->external_scanner_state_buffer_valid &&
+    self->external_scanner_state_buffer_length == length &&
+    (length == 0 || memcmp(self->external_scanner_state_buffer, data, length) == 0)
+  ) return;
+
+  self->language->external_scanner.deserialize(self->external_scanner_payload, data, length);
+  if (length > 0) memcpy(self->external_scanner_state_buffer, data, length);
+  self->external_scanner_state_buffer_length = length;
+  self->external_scanner_state_buffer_valid = true;
 }
 
 static bool ts_parser__can_reuse_first_leaf(
@@ -382,6 +432,35 @@ static bool ts_parser__can_reuse_first_leaf(
   return current_lex_mode.external_lex_state == 0 && table_entry->is_reusable;
 }
 
+static void ts_parser__reuse_table_entry(
+  TSParser *self,
+  TSStateId state,
+  TSSymbol symbol,
+  TableEntry *table_entry
+) {
+  ReuseVerificationCache *cache = &self->reuse_verification;
+  if (cache->valid && cache->state == state && cache->symbol == symbol) {
+    *table_entry = cache->entry;
+    return;
+  }
+  ts_language_table_entry(self->language, state, symbol, table_entry);
+  cache->state = state;
+  cache->symbol = symbol;
+  cache->entry = *table_entry;
+  cache->valid = true;
+}
+
+// Approximate the number of bytes of memory this parser currently has
+// allocated for the parse in progress: subtree storage, stack nodes, and
+// the lexer's line-start log. This deliberately ignores fixed-size
+// structures and the finished trees the caller already owns.
+static size_t ts_parser__memory_used(const TSParser *self) {
+  return
+    ts_subtree_pool_memory_used(&self->tree_pool) +
+    ts_stack_memory_used(self->stack) +
+    self->lexer.observed_line_starts.capacity * sizeof(Length);
+}
+
 static Subtree ts_parser__lex(
   TSParser *self,
   StackVersion version,
@@ -393,6 +472,18 @@ static Subtree ts_parser__lex(
     return NULL_SUBTREE;
   }
 
+  // Once the memory budget has been exceeded, stop consuming input and
+  // present an end-of-file token instead, so that the parse wraps up
+  // through the ordinary truncated-file recovery path and salvages a tree
+  // for the input consumed so far.
+  if (self->memory_exhausted) {
+    LOG("memory_limit_reached");
+    return ts_subtree_new_leaf(
+      &self->tree_pool, ts_builtin_sym_end, length_zero(), length_zero(),
+      0, parse_state, false, false, false, self->language
+    );
+  }
+
   const Length start_position = ts_stack_position(self->stack, version);
   const Subtree external_token = ts_stack_last_external_token(self->stack, version);
   const bool *valid_external_tokens = ts_language_enabled_external_tokens(
@@ -431,11 +522,22 @@ static Subtree ts_parser__lex(
       );
       ts_lexer_finish(&self->lexer, &lookahead_end_byte);
 
+      // The scan may have mutated the scanner's state, so the cached
+      // serialized form is stale until the next serialize.
+      self->external_scanner_state_buffer_valid = false;
+
       if (found_token) {
         external_scanner_state_len = self->language->external_scanner.serialize(
           self->external_scanner_payload,
           self->lexer.debug_buffer
         );
+        memcpy(
+          self->external_scanner_state_buffer,
+          self->lexer.debug_buffer,
+          external_scanner_state_len
+        );
+        self->external_scanner_state_buffer_length = external_scanner_state_len;
+        self->external_scanner_state_buffer_valid = true;
         external_scanner_state_changed = !ts_external_scanner_state_eq(
           ts_subtree_external_scanner_state(external_token),
           self->lexer.debug_buffer,
@@ -538,16 +640,41 @@ static Subtree ts_parser__lex(
     if (found_external_token) {
       symbol = self->language->external_scanner.symbol_map[symbol];
     } else if (symbol == self->language->keyword_capture_token && symbol != 0) {
+      uint32_t start_byte = self->lexer.token_start_position.bytes;
       uint32_t end_byte = self->lexer.token_end_position.bytes;
-      ts_lexer_reset(&self->lexer, self->lexer.token_start_position);
-      ts_lexer_start(&self->lexer);
       if (
-        self->language->keyword_lex_fn(&self->lexer.data, 0) &&
-        self->lexer.token_end_position.bytes == end_byte &&
-        ts_language_has_actions(self->language, parse_state, self->lexer.data.result_symbol)
+        self->language->version >= 16 &&
+        self->language->keyword_hash_table &&
+        self->lexer.chunk &&
+        start_byte >= self->lexer.chunk_start &&
+        end_byte <= self->lexer.chunk_start + self->lexer.chunk_size
       ) {
-        is_keyword = true;
-        symbol = self->lexer.data.result_symbol;
+        // The token's text is fully available in the lexer's current chunk,
+        // so the keyword can be recognized with a single hash lookup on the
+        // text instead of re-lexing the token with the keyword lexer.
+        TSSymbol keyword_symbol = ts_language_keyword_lookup(
+          self->language,
+          self->lexer.chunk + (start_byte - self->lexer.chunk_start),
+          end_byte - start_byte
+        );
+        if (
+          keyword_symbol != 0 &&
+          ts_language_has_actions(self->language, parse_state, keyword_symbol)
+        ) {
+          is_keyword = true;
+          symbol = keyword_symbol;
+        }
+      } else {
+        ts_lexer_reset(&self->lexer, self->lexer.token_start_position);
+        ts_lexer_start(&self->lexer);
+        if (
+          self->language->keyword_lex_fn(&self->lexer.data, 0) &&
+          self->lexer.token_end_position.bytes == end_byte &&
+          ts_language_has_actions(self->language, parse_state, self->lexer.data.result_symbol)
+        ) {
+          is_keyword = true;
+          symbol = self->lexer.data.result_symbol;
+        }
       }
     }
 
@@ -566,11 +693,18 @@ static Subtree ts_parser__lex(
 
     if (found_external_token) {
       MutableSubtree mut_result = ts_subtree_to_mut_unsafe(result);
-      ts_external_scanner_state_init(
-        &mut_result.ptr->external_scanner_state,
-        self->lexer.debug_buffer,
-        external_scanner_state_len
-      );
+      // When the serialized state is unchanged from the previous external
+      // token's, share that token's state instead of copying the bytes.
+      if (!external_scanner_state_changed && external_token.ptr) {
+        mut_result.ptr->external_scanner_state =
+          ts_external_scanner_state_copy(&external_token.ptr->external_scanner_state);
+      } else {
+        ts_external_scanner_state_init(
+          &mut_result.ptr->external_scanner_state,
+          self->lexer.debug_buffer,
+          external_scanner_state_len
+        );
+      }
       mut_result.ptr->has_external_scanner_state_change = external_scanner_state_changed;
     }
   }
@@ -589,15 +723,16 @@ static Subtree ts_parser__get_cached_token(
   Subtree last_external_token,
   TableEntry *table_entry
 ) {
-  TokenCache *cache = &self->token_cache;
+  TokenCacheEntry *entry =
+    &self->token_cache.entries[position % TREE_SITTER_TOKEN_CACHE_SIZE];
   if (
-    cache->token.ptr && cache->byte_index == position &&
-    ts_subtree_external_scanner_state_eq(cache->last_external_token, last_external_token)
+    entry->token.ptr && entry->byte_index == position &&
+    ts_subtree_external_scanner_state_eq(entry->last_external_token, last_external_token)
   ) {
-    ts_language_table_entry(self->language, state, ts_subtree_symbol(cache->token), table_entry);
-    if (ts_parser__can_reuse_first_leaf(self, state, cache->token, table_entry)) {
-      ts_subtree_retain(cache->token);
-      return cache->token;
+    ts_parser__reuse_table_entry(self, state, ts_subtree_symbol(entry->token), table_entry);
+    if (ts_parser__can_reuse_first_leaf(self, state, entry->token, table_entry)) {
+      ts_subtree_retain(entry->token);
+      return entry->token;
     }
   }
   return NULL_SUBTREE;
@@ -609,14 +744,30 @@ static void ts_parser__set_cached_token(
   Subtree last_external_token,
   Subtree token
 ) {
-  TokenCache *cache = &self->token_cache;
+  TokenCacheEntry *entry =
+    &self->token_cache.entries[byte_index % TREE_SITTER_TOKEN_CACHE_SIZE];
   if (token.ptr) ts_subtree_retain(token);
   if (last_external_token.ptr) ts_subtree_retain(last_external_token);
-  if (cache->token.ptr) ts_subtree_release(&self->tree_pool, cache->token);
-  if (cache->last_external_token.ptr) ts_subtree_release(&self->tree_pool, cache->last_external_token);
-  cache->token = token;
-  cache->byte_index = byte_index;
-  cache->last_external_token = last_external_token;
+  if (entry->token.ptr) ts_subtree_release(&self->tree_pool, entry->token);
+  if (entry->last_external_token.ptr) ts_subtree_release(&self->tree_pool, entry->last_external_token);
+  entry->token = token;
+  entry->byte_index = byte_index;
+  entry->last_external_token = last_external_token;
+}
+
+static void ts_parser__clear_cached_tokens(TSParser *self) {
+  for (unsigned i = 0; i < TREE_SITTER_TOKEN_CACHE_SIZE; i++) {
+    TokenCacheEntry *entry = &self->token_cache.entries[i];
+    if (entry->token.ptr) ts_subtree_release(&self->tree_pool, entry->token);
+    if (entry->last_external_token.ptr) {
+      ts_subtree_release(&self->tree_pool, entry->last_external_token);
+    }
+    *entry = (TokenCacheEntry) {
+      .token = NULL_SUBTREE,
+      .last_external_token = NULL_SUBTREE,
+      .byte_index = 0,
+    };
+  }
 }
 
 static bool ts_parser__has_included_range_difference(
@@ -692,7 +843,7 @@ static Subtree ts_parser__reuse_node(
     }
 
     TSSymbol leaf_symbol = ts_subtree_leaf_symbol(result);
-    ts_language_table_entry(self->language, *state, leaf_symbol, table_entry);
+    ts_parser__reuse_table_entry(self, *state, leaf_symbol, table_entry);
     if (!ts_parser__can_reuse_first_leaf(self, *state, result, table_entry)) {
       LOG(
         "cant_reuse_node symbol:%s, first_leaf_symbol:%s",
@@ -704,6 +855,8 @@ static Subtree ts_parser__reuse_node(
     }
 
     LOG("reuse_node symbol:%s", TREE_NAME(result));
+    self->stats.nodes_reused += ts_subtree_node_count(result);
+    self->stats.bytes_reused += ts_subtree_total_bytes(result);
     ts_subtree_retain(result);
     return result;
   }
@@ -774,6 +927,7 @@ static bool ts_parser__select_children(
   // room for its own heap data. The scratch tree is never explicitly released,
   // so the same 'scratch trees' array can be reused again later.
   MutableSubtree scratch_tree = ts_subtree_new_node(
+    &self->tree_pool,
     ts_subtree_symbol(left),
     &self->scratch_trees,
     0,
@@ -857,7 +1011,7 @@ static StackVersion ts_parser__reduce(
     ts_subtree_array_remove_trailing_extras(&children, &self->trailing_extras);
 
     MutableSubtree parent = ts_subtree_new_node(
-      symbol, &children, production_id, self->language
+      &self->tree_pool, symbol, &children, production_id, self->language
     );
 
     // This pop operation may have caused multiple stack versions to collapse
@@ -881,7 +1035,7 @@ static StackVersion ts_parser__reduce(
         ts_subtree_release(&self->tree_pool, ts_subtree_from_mut(parent));
         array_swap(&self->trailing_extras, &self->trailing_extras2);
         parent = ts_subtree_new_node(
-          symbol, &children, production_id, self->language
+          &self->tree_pool, symbol, &children, production_id, self->language
         );
       } else {
         array_clear(&self->trailing_extras2);
@@ -949,6 +1103,7 @@ static void ts_parser__accept(
         }
         array_splice(&trees, j, 1, child_count, children);
         root = ts_subtree_from_mut(ts_subtree_new_node(
+          &self->tree_pool,
           ts_subtree_symbol(tree),
           &trees,
           tree.ptr->production_id,
@@ -1110,7 +1265,7 @@ static bool ts_parser__recover_to_state(
     ts_subtree_array_remove_trailing_extras(&slice.subtrees, &self->trailing_extras);
 
     if (slice.subtrees.size > 0) {
-      Subtree error = ts_subtree_new_error_node(&slice.subtrees, true, self->language);
+      Subtree error = ts_subtree_new_error_node(&self->tree_pool, &slice.subtrees, true, self->language);
       ts_stack_push(self->stack, slice.version, error, false, goal_state);
     } else {
       array_delete(&slice.subtrees);
@@ -1127,6 +1282,37 @@ static bool ts_parser__recover_to_state(
   return previous_version != STACK_VERSION_NONE;
 }
 
+// The effective cap on the number of concurrent stack versions, taking any
+// user-provided recovery budget into account.
+static unsigned ts_parser__max_version_count(const TSParser *self) {
+  unsigned result = MAX_VERSION_COUNT;
+  if (
+    self->recovery_budget.max_stack_versions &&
+    self->recovery_budget.max_stack_versions < result
+  ) result = self->recovery_budget.max_stack_versions;
+  return result;
+}
+
+// Check whether the recovery budget still allows new recovery strategies to
+// be tried for this version. Skipping the remaining input into an ERROR node
+// is always allowed, so an exhausted budget degrades the quality of the tree
+// but never prevents a parse from finishing.
+static bool ts_parser__recovery_budget_exhausted(
+  const TSParser *self,
+  StackVersion version
+) {
+  const TSRecoveryBudget *budget = &self->recovery_budget;
+  if (
+    budget->max_recovery_count &&
+    self->stats.error_recoveries > budget->max_recovery_count
+  ) return true;
+  if (
+    budget->max_error_cost &&
+    ts_stack_error_cost(self->stack, version) > budget->max_error_cost
+  ) return true;
+  return false;
+}
+
 static void ts_parser__recover(
   TSParser *self,
   StackVersion version,
@@ -1135,10 +1321,21 @@ static void ts_parser__recover(
   bool did_recover = false;
   unsigned previous_version_count = ts_stack_version_count(self->stack);
   Length position = ts_stack_position(self->stack, version);
+
+  // Error recovery does far more work per parse action than ordinary
+  // parsing, so make the next action check the cancellation flag and the
+  // timeout instead of waiting out the usual schedule.
+  self->operation_count = OP_COUNT_PER_TIMEOUT_CHECK - 1;
+
   StackSummary *summary = ts_stack_get_summary(self->stack, version);
   unsigned node_count_since_error = ts_stack_node_count_since_error(self->stack, version);
   unsigned current_error_cost = ts_stack_error_cost(self->stack, version);
 
+  // When the recovery budget is exhausted, stop looking for recovery
+  // strategies altogether; only the token-skipping fallback below remains,
+  // so the rest of the invalid input accumulates into one ERROR node.
+  bool budget_exhausted = ts_parser__recovery_budget_exhausted(self, version);
+
   // When the parser is in the error state, there are two strategies for recovering with a
   // given lookahead token:
   // 1. Find a previous state on the stack in which that lookahead token would be valid. Then,
@@ -1151,7 +1348,7 @@ static void ts_parser__recover(
   // First, try the strategy 1. Upon entering the error state, the parser recorded a summary
   // of the previous parse states and their depths. Look at each state in the summary, to see
   // if the current lookahead token would be valid in that state.
-  if (summary && !ts_subtree_is_error(lookahead)) {
+  if (summary && !budget_exhausted && !ts_subtree_is_error(lookahead)) {
     for (unsigned i = 0; i < summary->size; i++) {
       StackSummaryEntry entry = summary->contents[i];
 
@@ -1207,7 +1404,7 @@ static void ts_parser__recover(
   // current lookahead token by wrapping it in an ERROR node.
 
   // Don't pursue this additional strategy if there are already too many stack versions.
-  if (did_recover && ts_stack_version_count(self->stack) > MAX_VERSION_COUNT) {
+  if (did_recover && ts_stack_version_count(self->stack) > ts_parser__max_version_count(self)) {
     ts_stack_halt(self->stack, version);
     ts_subtree_release(&self->tree_pool, lookahead);
     return;
@@ -1227,18 +1424,23 @@ static void ts_parser__recover(
   if (ts_subtree_is_eof(lookahead)) {
     LOG("recover_eof");
     SubtreeArray children = array_new();
-    Subtree parent = ts_subtree_new_error_node(&children, false, self->language);
+    Subtree parent = ts_subtree_new_error_node(&self->tree_pool, &children, false, self->language);
     ts_stack_push(self->stack, version, parent, false, 1);
     ts_parser__accept(self, version, lookahead);
     return;
   }
 
-  // Do not recover if the result would clearly be worse than some existing stack version.
+  // Do not recover if the result would clearly be worse than some existing
+  // stack version. With an exhausted budget, skipping the token is the only
+  // way for this version to reach the end of the file, so keep it alive.
   unsigned new_cost =
     current_error_cost + ERROR_COST_PER_SKIPPED_TREE +
     ts_subtree_total_bytes(lookahead) * ERROR_COST_PER_SKIPPED_CHAR +
     ts_subtree_total_size(lookahead).extent.row * ERROR_COST_PER_SKIPPED_LINE;
-  if (ts_parser__better_version_exists(self, version, false, new_cost)) {
+  if (
+    !budget_exhausted &&
+    ts_parser__better_version_exists(self, version, false, new_cost)
+  ) {
     ts_stack_halt(self->stack, version);
     ts_subtree_release(&self->tree_pool, lookahead);
     return;
@@ -1260,6 +1462,7 @@ static void ts_parser__recover(
   array_reserve(&children, 1);
   array_push(&children, lookahead);
   MutableSubtree error_repeat = ts_subtree_new_node(
+    &self->tree_pool,
     ts_builtin_sym_error_repeat,
     &children,
     0,
@@ -1288,6 +1491,7 @@ static void ts_parser__recover(
     ts_stack_renumber_version(self->stack, pop.contents[0].version, version);
     array_push(&pop.contents[0].subtrees, ts_subtree_from_mut(error_repeat));
     error_repeat = ts_subtree_new_node(
+      &self->tree_pool,
       ts_builtin_sym_error_repeat,
       &pop.contents[0].subtrees,
       0,
@@ -1310,6 +1514,8 @@ static void ts_parser__handle_error(
   Subtree lookahead
 ) {
   uint32_t previous_version_count = ts_stack_version_count(self->stack);
+  self->stats.error_recoveries++;
+  bool budget_exhausted = ts_parser__recovery_budget_exhausted(self, version);
 
   // Perform any reductions that can happen in this state, regardless of the lookahead. After
   // skipping one or more invalid tokens, the parser might find a token that would have allowed
@@ -1322,7 +1528,7 @@ static void ts_parser__handle_error(
   // were created in the previous step.
   bool did_insert_missing_token = false;
   for (StackVersion v = version; v < version_count;) {
-    if (!did_insert_missing_token) {
+    if (!did_insert_missing_token && !budget_exhausted) {
       TSStateId state = ts_stack_state(self->stack, v);
       for (
         TSSymbol missing_symbol = 1;
@@ -1415,8 +1621,10 @@ static bool ts_parser__advance(
   Subtree lookahead = NULL_SUBTREE;
   TableEntry table_entry = {.action_count = 0};
 
-  // If possible, reuse a node from the previous syntax tree.
-  if (allow_node_reuse) {
+  // If possible, reuse a node from the previous syntax tree. Once the
+  // memory budget has been exceeded, skip reuse so that the parse reaches
+  // the synthetic end-of-file promptly.
+  if (allow_node_reuse && !self->memory_exhausted) {
     lookahead = ts_parser__reuse_node(
       self, version, &state, position, last_external_token, &table_entry
     );
@@ -1426,9 +1634,11 @@ static bool ts_parser__advance(
   // reuse the token previously returned by the lexer.
   if (!lookahead.ptr) {
     did_reuse = false;
-    lookahead = ts_parser__get_cached_token(
-      self, state, position, last_external_token, &table_entry
-    );
+    if (!self->memory_exhausted) {
+      lookahead = ts_parser__get_cached_token(
+        self, state, position, last_external_token, &table_entry
+      );
+    }
   }
 
   bool needs_lex = !lookahead.ptr;
@@ -1436,9 +1646,23 @@ static bool ts_parser__advance(
     // Otherwise, re-run the lexer.
     if (needs_lex) {
       needs_lex = false;
+      TSClock lex_start_clock = clock_now();
       lookahead = ts_parser__lex(self, version, state);
+      self->stats.lex_micros += clock_elapsed_micros(lex_start_clock, clock_now());
+
+      // If the parse was cancelled while the lexer was running, the token
+      // may be truncated at the point where the lexer stopped reading
+      // input. Discard it without caching it, and abandon the parse; it
+      // can be resumed by calling `ts_parser_parse` again.
+      if (self->cancellation_flag && atomic_load(self->cancellation_flag)) {
+        if (lookahead.ptr) {
+          ts_subtree_release(&self->tree_pool, lookahead);
+        }
+        return false;
+      }
 
       if (lookahead.ptr) {
+        self->stats.tokens_lexed++;
         ts_parser__set_cached_token(self, position, last_external_token, lookahead);
         ts_language_table_entry(self->language, state, ts_subtree_symbol(lookahead), &table_entry);
       }
@@ -1467,6 +1691,18 @@ static bool ts_parser__advance(
       return false;
     }
 
+    // Check the memory budget on the same schedule. Exceeding it does not
+    // abort the parse: the lexer starts reporting end-of-file, and the
+    // parse finishes with a partial tree for the input consumed so far.
+    if (
+      self->operation_count == 0 &&
+      self->max_memory && !self->memory_exhausted &&
+      ts_parser__memory_used(self) > self->max_memory
+    ) {
+      LOG("memory_limit_exceeded budget:%zu", self->max_memory);
+      self->memory_exhausted = true;
+    }
+
     // Process each parse action for the current lookahead token in
     // the current state. If there are multiple actions, then this is
     // an ambiguous state. REDUCE actions always create a new stack
@@ -1622,6 +1858,7 @@ static bool ts_parser__advance(
 static unsigned ts_parser__condense_stack(TSParser *self) {
   bool made_changes = false;
   unsigned min_error_cost = UINT_MAX;
+  unsigned initial_version_count = ts_stack_version_count(self->stack);
   for (StackVersion i = 0; i < ts_stack_version_count(self->stack); i++) {
     // Prune any versions that have been marked for removal.
     if (ts_stack_is_halted(self->stack, i)) {
@@ -1682,8 +1919,9 @@ static unsigned ts_parser__condense_stack(TSParser *self) {
 
   // Enfore a hard upper bound on the number of stack versions by
   // discarding the least promising versions.
-  while (ts_stack_version_count(self->stack) > MAX_VERSION_COUNT) {
-    ts_stack_remove_version(self->stack, MAX_VERSION_COUNT);
+  unsigned max_version_count = ts_parser__max_version_count(self);
+  while (ts_stack_version_count(self->stack) > max_version_count) {
+    ts_stack_remove_version(self->stack, max_version_count);
     made_changes = true;
   }
 
@@ -1716,6 +1954,11 @@ static unsigned ts_parser__condense_stack(TSParser *self) {
     LOG_STACK();
   }
 
+  unsigned final_version_count = ts_stack_version_count(self->stack);
+  if (final_version_count < initial_version_count) {
+    self->stats.stack_versions_condensed += initial_version_count - final_version_count;
+  }
+
   return min_error_cost;
 }
 
@@ -1745,7 +1988,13 @@ TSParser *ts_parser_new(void) {
   self->old_tree = NULL_SUBTREE;
   self->included_range_differences = (TSRangeArray) array_new();
   self->included_range_difference_index = 0;
-  ts_parser__set_cached_token(self, 0, NULL_SUBTREE, NULL_SUBTREE);
+  self->max_tree_depth = UINT32_MAX;
+  self->recovery_budget = (TSRecoveryBudget) {0, 0, 0};
+  self->max_memory = 0;
+  self->memory_exhausted = false;
+  self->external_scanner_state_buffer_length = 0;
+  self->external_scanner_state_buffer_valid = false;
+  ts_parser__clear_cached_tokens(self);
   return self;
 }
 
@@ -1765,7 +2014,7 @@ void ts_parser_delete(TSParser *self) {
     self->old_tree = NULL_SUBTREE;
   }
   ts_lexer_delete(&self->lexer);
-  ts_parser__set_cached_token(self, 0, NULL_SUBTREE, NULL_SUBTREE);
+  ts_parser__clear_cached_tokens(self);
   ts_subtree_pool_delete(&self->tree_pool);
   reusable_node_delete(&self->reusable_node);
   array_delete(&self->trailing_extras);
@@ -1825,6 +2074,7 @@ const size_t *ts_parser_cancellation_flag(const TSParser *self) {
 
 void ts_parser_set_cancellation_flag(TSParser *self, const size_t *flag) {
   self->cancellation_flag = (const volatile size_t *)flag;
+  self->lexer.cancellation_flag = (const volatile size_t *)flag;
 }
 
 uint64_t ts_parser_timeout_micros(const TSParser *self) {
@@ -1835,6 +2085,10 @@ void ts_parser_set_timeout_micros(TSParser *self, uint64_t timeout_micros) {
   self->timeout_duration = duration_from_micros(timeout_micros);
 }
 
+TSParserStats ts_parser_stats(const TSParser *self) {
+  return self->stats;
+}
+
 bool ts_parser_set_included_ranges(
   TSParser *self,
   const TSRange *ranges,
@@ -1847,10 +2101,36 @@ const TSRange *ts_parser_included_ranges(const TSParser *self, uint32_t *count)
   return ts_lexer_included_ranges(&self->lexer, count);
 }
 
+uint32_t ts_parser_max_tree_depth(const TSParser *self) {
+  return self->max_tree_depth;
+}
+
+void ts_parser_set_max_tree_depth(TSParser *self, uint32_t max_depth) {
+  self->max_tree_depth = max_depth;
+}
+
+size_t ts_parser_max_memory(const TSParser *self) {
+  return self->max_memory;
+}
+
+void ts_parser_set_max_memory(TSParser *self, size_t max_memory) {
+  self->max_memory = max_memory;
+}
+
+TSRecoveryBudget ts_parser_recovery_budget(const TSParser *self) {
+  return self->recovery_budget;
+}
+
+void ts_parser_set_recovery_budget(TSParser *self, TSRecoveryBudget budget) {
+  self->recovery_budget = budget;
+}
+
 void ts_parser_reset(TSParser *self) {
   if (self->language && self->language->external_scanner.deserialize) {
     self->language->external_scanner.deserialize(self->external_scanner_payload, NULL, 0);
   }
+  self->external_scanner_state_buffer_length = 0;
+  self->external_scanner_state_buffer_valid = false;
 
   if (self->old_tree.ptr) {
     ts_subtree_release(&self->tree_pool, self->old_tree);
@@ -1858,9 +2138,14 @@ void ts_parser_reset(TSParser *self) {
   }
 
   reusable_node_clear(&self->reusable_node);
+  self->reuse_verification.valid = false;
+  self->memory_exhausted = false;
+  // Finished trees are handed to the caller and eventually released against
+  // other pools, so start each parse's memory accounting from zero.
+  self->tree_pool.allocated_bytes = 0;
   ts_lexer_reset(&self->lexer, length_zero());
   ts_stack_clear(self->stack);
-  ts_parser__set_cached_token(self, 0, NULL_SUBTREE, NULL_SUBTREE);
+  ts_parser__clear_cached_tokens(self);
   if (self->finished_tree.ptr) {
     ts_subtree_release(&self->tree_pool, self->finished_tree);
     self->finished_tree = NULL_SUBTREE;
@@ -1875,6 +2160,9 @@ TSTree *ts_parser_parse(
 ) {
   if (!self->language || !input.read) return NULL;
 
+  self->stats = (TSParserStats) {0};
+  TSClock parse_start_clock = clock_now();
+
   ts_lexer_set_input(&self->lexer, input);
 
   array_clear(&self->included_range_differences);
@@ -1883,6 +2171,7 @@ TSTree *ts_parser_parse(
   if (ts_parser_has_outstanding_parse(self)) {
     LOG("resume_parsing");
   } else if (old_tree) {
+    array_clear(&self->lexer.observed_line_starts);
     ts_subtree_retain(old_tree->root);
     self->old_tree = old_tree->root;
     ts_range_array_get_changed_ranges(
@@ -1898,6 +2187,7 @@ TSTree *ts_parser_parse(
       LOG("different_included_range %u - %u", range->start_byte, range->end_byte);
     }
   } else {
+    array_clear(&self->lexer.observed_line_starts);
     reusable_node_clear(&self->reusable_node);
     LOG("new_parse");
   }
@@ -1928,7 +2218,10 @@ TSTree *ts_parser_parse(
           ts_stack_position(self->stack, version).extent.column
         );
 
-        if (!ts_parser__advance(self, version, allow_node_reuse)) return NULL;
+        if (!ts_parser__advance(self, version, allow_node_reuse)) {
+          self->stats.parse_micros = clock_elapsed_micros(parse_start_clock, clock_now());
+          return NULL;
+        }
         LOG_STACK();
 
         position = ts_stack_position(self->stack, version).bytes;
@@ -1965,8 +2258,24 @@ TSTree *ts_parser_parse(
     self->lexer.included_ranges,
     self->lexer.included_range_count
   );
+  ts_tree_build_line_index(
+    result,
+    old_tree,
+    self->lexer.observed_line_starts.contents,
+    self->lexer.observed_line_starts.size
+  );
   self->finished_tree = NULL_SUBTREE;
+
+  // In preview mode, hand back the collapsed tree and release the full
+  // one immediately, so that deep interior structure never outlives the
+  // parse.
+  if (self->max_tree_depth != UINT32_MAX) {
+    TSTree *limited = ts_tree_with_depth_limit(result, self->max_tree_depth);
+    ts_tree_delete(result);
+    result = limited;
+  }
   ts_parser_reset(self);
+  self->stats.parse_micros = clock_elapsed_micros(parse_start_clock, clock_now());
   return result;
 }
 
@@ -1994,4 +2303,86 @@ TSTree *ts_parser_parse_string_encoding(
   });
 }
 
+bool ts_parser_parse_streaming(
+  TSParser *self,
+  TSInput input,
+  bool (*callback)(void *payload, TSNode node),
+  void *payload
+) {
+  if (!callback) return false;
+  TSTree *tree = ts_parser_parse(self, NULL, input);
+  if (!tree) return false;
+  TSNode root = ts_tree_root_node(tree);
+  uint32_t child_count = ts_node_child_count(root);
+  for (uint32_t i = 0; i < child_count; i++) {
+    if (!callback(payload, ts_node_child(root, i))) break;
+  }
+  ts_tree_delete(tree);
+  return true;
+}
+
+TSTree *ts_parser_parse_fd(
+  TSParser *self,
+  const TSTree *old_tree,
+  int fd,
+  TSInputEncoding encoding
+) {
+#ifndef _WIN32
+  struct stat file_info;
+  if (fstat(fd, &file_info) != 0) return NULL;
+  if (file_info.st_size > (off_t)UINT32_MAX) return NULL;
+  uint32_t length = file_info.st_size;
+  if (length == 0) {
+    return ts_parser_parse_string_encoding(self, old_tree, "", 0, encoding);
+  }
+
+  // Hand the lexer chunks directly out of a private mapping of the file,
+  // so that the source text is never copied into a separate buffer. The
+  // lexer reads the file front to back, which the kernel is told about
+  // up front.
+  void *mapping = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (mapping != MAP_FAILED) {
+    posix_madvise(mapping, length, POSIX_MADV_SEQUENTIAL);
+    TSTree *result = ts_parser_parse_string_encoding(
+      self, old_tree, mapping, length, encoding
+    );
+    munmap(mapping, length);
+    return result;
+  }
+#endif
+
+  // Fall back to reading the file into a heap buffer when it cannot be
+  // mapped, e.g. for pipes or on platforms without mmap.
+  uint32_t length_read = 0;
+  uint32_t capacity = 1024 * 64;
+  char *buffer = ts_malloc(capacity);
+  for (;;) {
+    if (length_read == capacity) {
+      if (capacity > UINT32_MAX / 2) {
+        ts_free(buffer);
+        return NULL;
+      }
+      capacity *= 2;
+      buffer = ts_realloc(buffer, capacity);
+    }
+#ifdef _WIN32
+    int bytes_read = _read(fd, buffer + length_read, capacity - length_read);
+#else
+    ssize_t bytes_read = read(fd, buffer + length_read, capacity - length_read);
+#endif
+    if (bytes_read < 0) {
+      ts_free(buffer);
+      return NULL;
+    }
+    if (bytes_read == 0) break;
+    length_read += (uint32_t)bytes_read;
+  }
+
+  TSTree *result = ts_parser_parse_string_encoding(
+    self, old_tree, buffer, length_read, encoding
+  );
+  ts_free(buffer);
+  return result;
+}
+
 #undef LOG
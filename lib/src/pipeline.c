@@ -0,0 +1,151 @@
+#include "tree_sitter/api.h"
+#include "./alloc.h"
+#include "./array.h"
+#include "./get_changed_ranges.h"
+#include "./subtree.h"
+#include "./tree_cursor.h"
+#include "./tree.h"
+
+// A pipeline bundles a parser, a query cursor, and the scratch memory that
+// the edit -> reparse -> changed-ranges -> query sequence would otherwise
+// allocate and free on every update. The tree cursors and the range arrays
+// keep their capacity between updates, and the changed ranges from the most
+// recent update are retained until the next one, so a steady stream of small
+// edits settles into a state where an update performs no allocations beyond
+// the parse itself.
+struct TSPipeline {
+  TSParser *parser;
+  TSQueryCursor *cursor;
+  const TSQuery *query;
+  bool did_exec_query;
+  TSRange *changed_ranges;
+  uint32_t changed_range_count;
+  TreeCursor tree_cursors[2];
+  TSRangeArray included_range_differences;
+};
+
+TSPipeline *ts_pipeline_new(void) {
+  TSPipeline *self = ts_malloc(sizeof(TSPipeline));
+  self->parser = ts_parser_new();
+  self->cursor = ts_query_cursor_new();
+  self->query = NULL;
+  self->did_exec_query = false;
+  self->changed_ranges = NULL;
+  self->changed_range_count = 0;
+  self->tree_cursors[0] = (TreeCursor) {NULL, array_new()};
+  self->tree_cursors[1] = (TreeCursor) {NULL, array_new()};
+  array_init(&self->included_range_differences);
+  return self;
+}
+
+void ts_pipeline_delete(TSPipeline *self) {
+  if (!self) return;
+  ts_parser_delete(self->parser);
+  ts_query_cursor_delete(self->cursor);
+  if (self->changed_ranges) ts_free(self->changed_ranges);
+  array_delete(&self->tree_cursors[0].stack);
+  array_delete(&self->tree_cursors[1].stack);
+  array_delete(&self->included_range_differences);
+  ts_free(self);
+}
+
+TSParser *ts_pipeline_parser(TSPipeline *self) {
+  return self->parser;
+}
+
+TSQueryCursor *ts_pipeline_query_cursor(TSPipeline *self) {
+  return self->cursor;
+}
+
+void ts_pipeline_set_query(TSPipeline *self, const TSQuery *query) {
+  self->query = query;
+  self->did_exec_query = false;
+}
+
+TSTree *ts_pipeline_update(
+  TSPipeline *self,
+  TSTree *old_tree,
+  const TSInputEdit *edits,
+  uint32_t edit_count,
+  TSInput input
+) {
+  if (old_tree && edit_count > 0) {
+    ts_tree_edit_batch(old_tree, edits, edit_count);
+  }
+
+  TSTree *new_tree = ts_parser_parse(self->parser, old_tree, input);
+  if (!new_tree) return NULL;
+
+  if (self->changed_ranges) {
+    ts_free(self->changed_ranges);
+    self->changed_ranges = NULL;
+  }
+  self->changed_range_count = 0;
+
+  if (old_tree) {
+    ts_tree_cursor_init(&self->tree_cursors[0], ts_tree_root_node(old_tree));
+    ts_tree_cursor_init(&self->tree_cursors[1], ts_tree_root_node(new_tree));
+
+    array_clear(&self->included_range_differences);
+    ts_range_array_get_changed_ranges(
+      old_tree->included_ranges, old_tree->included_range_count,
+      new_tree->included_ranges, new_tree->included_range_count,
+      &self->included_range_differences
+    );
+
+    self->changed_range_count = ts_subtree_get_changed_ranges(
+      &old_tree->root, &new_tree->root,
+      &self->tree_cursors[0], &self->tree_cursors[1],
+      old_tree->language, &self->included_range_differences,
+      &self->changed_ranges
+    );
+  }
+
+  if (self->query) {
+    // On an incremental update, clip the query to the byte range that covers
+    // the edits and the changed ranges, so that unchanged subtrees are
+    // skipped rather than re-matched. The edits are included because the
+    // changed ranges only report where the *structure* of the tree changed;
+    // an edit that renames one token can leave them empty. On a full parse,
+    // run over the whole tree.
+    uint32_t start_byte = 0;
+    uint32_t end_byte = UINT32_MAX;
+    if (old_tree) {
+      start_byte = UINT32_MAX;
+      end_byte = 0;
+      for (uint32_t i = 0; i < edit_count; i++) {
+        if (edits[i].start_byte < start_byte) start_byte = edits[i].start_byte;
+        if (edits[i].new_end_byte > end_byte) end_byte = edits[i].new_end_byte;
+      }
+      if (self->changed_range_count > 0) {
+        if (self->changed_ranges[0].start_byte < start_byte) {
+          start_byte = self->changed_ranges[0].start_byte;
+        }
+        uint32_t last = self->changed_range_count - 1;
+        if (self->changed_ranges[last].end_byte > end_byte) {
+          end_byte = self->changed_ranges[last].end_byte;
+        }
+      }
+      if (start_byte > end_byte) {
+        // Nothing was edited and nothing changed; produce no matches.
+        start_byte = UINT32_MAX;
+        end_byte = UINT32_MAX;
+      }
+    }
+    ts_query_cursor_set_byte_range(self->cursor, start_byte, end_byte);
+    ts_query_cursor_exec(self->cursor, self->query, ts_tree_root_node(new_tree));
+    self->did_exec_query = true;
+  }
+
+  return new_tree;
+}
+
+const TSRange *ts_pipeline_changed_ranges(const TSPipeline *self, uint32_t *count) {
+  *count = self->changed_range_count;
+  return self->changed_ranges;
+}
+
+bool ts_pipeline_next_match(TSPipeline *self, TSQueryMatch *match) {
+  if (!self->did_exec_query) return false;
+  return ts_query_cursor_next_match(self->cursor, match);
+}
@@ -1,16 +1,19 @@
 #include "tree_sitter/api.h"
 #include "./alloc.h"
 #include "./array.h"
+#include "./clock.h"
 #include "./language.h"
 #include "./point.h"
 #include "./tree_cursor.h"
 #include "./unicode.h"
+#include <string.h>
 #include <wctype.h>
 
 // #define DEBUG_ANALYZE_QUERY
 // #define DEBUG_EXECUTE_QUERY
 
 #define MAX_STEP_CAPTURE_COUNT 3
+#define MAX_INLINE_CAPTURE_COUNT 2
 #define MAX_NEGATED_FIELD_COUNT 8
 #define MAX_STATE_PREDECESSOR_COUNT 256
 #define MAX_ANALYSIS_STATE_DEPTH 8
@@ -145,9 +148,30 @@ typedef struct {
 typedef struct {
   Slice steps;
   Slice predicate_steps;
+  Slice text_predicates;
   uint32_t start_byte;
 } QueryPattern;
 
+/*
+ * TextPredicate - A compiled form of an `#eq?` or `#not-eq?` predicate,
+ * resolved once when the query is constructed so that the query cursor can
+ * evaluate it natively with interned-string comparisons instead of leaving
+ * the raw predicate steps for a binding to interpret. Other predicates -
+ * notably `#match?`, since this library contains no regex engine - are not
+ * compiled and remain the bindings' responsibility.
+ */
+typedef enum {
+  TextPredicateEqString,
+  TextPredicateEqCapture,
+} TextPredicateType;
+
+typedef struct {
+  uint32_t capture_id;
+  uint32_t value_id;
+  uint8_t type;
+  bool is_positive;
+} TextPredicate;
+
 typedef struct {
   uint32_t byte_offset;
   uint16_t step_index;
@@ -167,7 +191,12 @@ typedef struct {
  * - `consumed_capture_count` - The number of captures from this match that
  *    have already been returned.
  * - `capture_list_id` - A numeric id that can be used to retrieve the state's
- *    list of captures from the `CaptureListPool`.
+ *    list of captures from the `CaptureListPool`. Most patterns capture only
+ *    one or two nodes, so to keep the pool out of that hot path, the first
+ *    `MAX_INLINE_CAPTURE_COUNT` captures are stored in `inline_captures`
+ *    within the state itself, and `capture_list_id` remains
+ *    `CAPTURE_LIST_NONE`. Only when a state outgrows its inline storage are
+ *    its captures moved into a list acquired from the pool.
  * - `seeking_immediate_match` - A flag that indicates that the state's next
  *    step must be matched by the very next sibling. This is used when
  *    processing repetitions.
@@ -180,9 +209,11 @@ typedef struct {
 typedef struct {
   uint32_t id;
   uint32_t capture_list_id;
+  TSQueryCapture inline_captures[MAX_INLINE_CAPTURE_COUNT];
   uint16_t start_depth;
   uint16_t step_index;
   uint16_t pattern_index;
+  uint8_t inline_capture_count;
   uint16_t consumed_capture_count: 12;
   bool seeking_immediate_match: 1;
   bool has_in_progress_alternatives: 1;
@@ -205,11 +236,15 @@ typedef struct {
   // never allow `list` to allocate more entries than this, dropping pending
   // matches if needed to stay under the limit.
   uint32_t max_capture_list_count;
-  // The number of capture lists allocated in `list` that are not currently in
-  // use. We reuse those existing-but-unused capture lists before trying to
+  // The maximum number of bytes of capture-list memory that we are allowed
+  // to retain. As with `max_capture_list_count`, reaching the limit causes
+  // pending matches to be dropped rather than allocating further.
+  uint32_t max_memory_bytes;
+  // The ids of the capture lists in `list` that are not currently in use.
+  // Those existing-but-unused capture lists are reused before trying to
   // allocate any new ones. We use an invalid value (UINT32_MAX) for a capture
   // list's length to indicate that it's not in use.
-  uint32_t free_capture_list_count;
+  Array(uint32_t) free_list;
 } CaptureListPool;
 
 /*
@@ -274,6 +309,7 @@ struct TSQuery {
   Array(QueryStep) steps;
   Array(PatternEntry) pattern_map;
   Array(TSQueryPredicateStep) predicate_steps;
+  Array(TextPredicate) text_predicates;
   Array(QueryPattern) patterns;
   Array(StepOffset) step_offsets;
   Array(TSFieldId) negated_fields;
@@ -282,6 +318,27 @@ struct TSQuery {
   uint16_t wildcard_root_pattern_count;
 };
 
+/*
+ * PatternStatsEntry - Execution statistics that a cursor accumulates for one
+ * of its query's patterns. The public counters are accompanied by a
+ * bookkeeping mark that is used to count each visited node at most once per
+ * pattern.
+ */
+typedef struct {
+  TSQueryPatternStats stats;
+  uint32_t last_node_mark;
+} PatternStatsEntry;
+
+/*
+ * ReturnedCapture - The identity of a capture that has already been returned
+ * from `ts_query_cursor_next_capture`. Used to filter out duplicate captures
+ * when deduplication is enabled.
+ */
+typedef struct {
+  const void *node_id;
+  uint32_t capture_index;
+} ReturnedCapture;
+
 /*
  * TSQueryCursor - A stateful struct used to execute a query on a tree.
  */
@@ -291,12 +348,33 @@ struct TSQueryCursor {
   Array(QueryState) states;
   Array(QueryState) finished_states;
   CaptureListPool capture_list_pool;
+  // Scratch space for handing a state's inline captures to the caller. The
+  // state that owns them may be erased or moved before the caller is done
+  // with the match, so they are copied here, where they remain valid until
+  // the cursor is next advanced - the same lifetime that a released capture
+  // list from the pool would have.
+  TSQueryCapture returned_inline_captures[MAX_INLINE_CAPTURE_COUNT];
   uint32_t depth;
   uint32_t start_byte;
   uint32_t end_byte;
   TSPoint start_point;
   TSPoint end_point;
+  Array(TSRange) included_ranges;
+  const char *text;
+  uint32_t text_length;
+  uint32_t skipped_node_count;
+  Array(PatternStatsEntry) pattern_stats;
+  uint32_t pattern_step_limit;
+  uint32_t visited_node_mark;
   uint32_t next_state_id;
+  // The captures that have already been returned at the current start byte.
+  // Captures are returned in order of their nodes' start bytes, so this
+  // array is cleared whenever that byte advances.
+  Array(ReturnedCapture) returned_captures;
+  uint32_t returned_capture_byte;
+  bool deduplicate_captures;
+  bool pattern_timing_enabled;
+  bool query_has_non_rooted_patterns;
   bool ascending;
   bool halted;
   bool did_exceed_match_limit;
@@ -305,6 +383,7 @@ struct TSQueryCursor {
 static const TSQueryError PARENT_DONE = -1;
 static const uint16_t PATTERN_DONE_MARKER = UINT16_MAX;
 static const uint16_t NONE = UINT16_MAX;
+static const uint32_t CAPTURE_LIST_NONE = UINT32_MAX;
 static const TSSymbol WILDCARD_SYMBOL = 0;
 
 /**********
@@ -396,31 +475,47 @@ static CaptureListPool capture_list_pool_new(void) {
     .list = array_new(),
     .empty_list = array_new(),
     .max_capture_list_count = UINT32_MAX,
-    .free_capture_list_count = 0,
+    .max_memory_bytes = UINT32_MAX,
+    .free_list = array_new(),
   };
 }
 
+// The number of bytes of scratch memory the pool currently retains. The
+// individual capture lists grow while matches are in progress, so this is
+// recomputed on demand rather than tracked incrementally.
+static uint32_t capture_list_pool_memory(const CaptureListPool *self) {
+  uint32_t bytes =
+    self->list.capacity * sizeof(CaptureList) +
+    self->free_list.capacity * sizeof(uint32_t);
+  for (uint32_t i = 0; i < self->list.size; i++) {
+    bytes += self->list.contents[i].capacity * sizeof(TSQueryCapture);
+  }
+  return bytes;
+}
+
 static void capture_list_pool_reset(CaptureListPool *self) {
-  for (uint16_t i = 0; i < self->list.size; i++) {
+  array_clear(&self->free_list);
+  for (uint32_t i = 0; i < self->list.size; i++) {
     // This invalid size means that the list is not in use.
     self->list.contents[i].size = UINT32_MAX;
+    array_push(&self->free_list, i);
   }
-  self->free_capture_list_count = self->list.size;
 }
 
 static void capture_list_pool_delete(CaptureListPool *self) {
-  for (uint16_t i = 0; i < self->list.size; i++) {
+  for (uint32_t i = 0; i < self->list.size; i++) {
     array_delete(&self->list.contents[i]);
   }
   array_delete(&self->list);
+  array_delete(&self->free_list);
 }
 
-static const CaptureList *capture_list_pool_get(const CaptureListPool *self, uint16_t id) {
+static const CaptureList *capture_list_pool_get(const CaptureListPool *self, uint32_t id) {
   if (id >= self->list.size) return &self->empty_list;
   return &self->list.contents[id];
 }
 
-static CaptureList *capture_list_pool_get_mut(CaptureListPool *self, uint16_t id) {
+static CaptureList *capture_list_pool_get_mut(CaptureListPool *self, uint32_t id) {
   assert(id < self->list.size);
   return &self->list.contents[id];
 }
@@ -428,26 +523,28 @@ static CaptureList *capture_list_pool_get_mut(CaptureListPool *self, uint16_t id
 static bool capture_list_pool_is_empty(const CaptureListPool *self) {
   // The capture list pool is empty if all allocated lists are in use, and we
   // have reached the maximum allowed number of allocated lists.
-  return self->free_capture_list_count == 0 && self->list.size >= self->max_capture_list_count;
+  return self->free_list.size == 0 && self->list.size >= self->max_capture_list_count;
 }
 
-static uint16_t capture_list_pool_acquire(CaptureListPool *self) {
-  // First see if any already allocated capture list is currently unused.
-  if (self->free_capture_list_count > 0) {
-    for (uint16_t i = 0; i < self->list.size; i++) {
-      if (self->list.contents[i].size == UINT32_MAX) {
-        array_clear(&self->list.contents[i]);
-        self->free_capture_list_count--;
-        return i;
-      }
-    }
+static uint32_t capture_list_pool_acquire(CaptureListPool *self) {
+  // First reuse any already-allocated capture list that is currently unused.
+  if (self->free_list.size > 0) {
+    uint32_t id = array_pop(&self->free_list);
+    array_clear(&self->list.contents[id]);
+    return id;
   }
 
   // Otherwise allocate and initialize a new capture list, as long as that
-  // doesn't put us over the requested maximum.
+  // doesn't put us over the requested maximum count or memory budget.
   uint32_t i = self->list.size;
   if (i >= self->max_capture_list_count) {
-    return NONE;
+    return CAPTURE_LIST_NONE;
+  }
+  if (
+    self->max_memory_bytes != UINT32_MAX &&
+    capture_list_pool_memory(self) + sizeof(CaptureList) > self->max_memory_bytes
+  ) {
+    return CAPTURE_LIST_NONE;
   }
   CaptureList list;
   array_init(&list);
@@ -455,10 +552,10 @@ static uint16_t capture_list_pool_acquire(CaptureListPool *self) {
   return i;
 }
 
-static void capture_list_pool_release(CaptureListPool *self, uint16_t id) {
+static void capture_list_pool_release(CaptureListPool *self, uint32_t id) {
   if (id >= self->list.size) return;
   self->list.contents[id].size = UINT32_MAX;
-  self->free_capture_list_count++;
+  array_push(&self->free_list, id);
 }
 
 /**************
@@ -2543,6 +2640,56 @@ static TSQueryError ts_query__parse_pattern(
   return 0;
 }
 
+// Scan each pattern's predicates for well-formed `#eq?` and `#not-eq?`
+// applications - a predicate name, a capture, and one more capture or
+// string - and compile them into the query's `text_predicates` table.
+// Malformed applications and all other predicate names are skipped and left
+// in `predicate_steps` untouched, so bindings that interpret the raw steps
+// themselves keep working unchanged.
+static void ts_query__compile_text_predicates(TSQuery *self) {
+  for (uint32_t i = 0; i < self->patterns.size; i++) {
+    QueryPattern *pattern = &self->patterns.contents[i];
+    pattern->text_predicates.offset = self->text_predicates.size;
+    pattern->text_predicates.length = 0;
+    uint32_t group_start = pattern->predicate_steps.offset;
+    uint32_t end = group_start + pattern->predicate_steps.length;
+    for (uint32_t j = group_start; j < end; j++) {
+      if (self->predicate_steps.contents[j].type != TSQueryPredicateStepTypeDone) continue;
+      const TSQueryPredicateStep *steps = &self->predicate_steps.contents[group_start];
+      uint32_t step_count = j - group_start;
+      group_start = j + 1;
+      if (
+        step_count != 3 ||
+        steps[0].type != TSQueryPredicateStepTypeString ||
+        steps[1].type != TSQueryPredicateStepTypeCapture
+      ) continue;
+      uint32_t name_length;
+      const char *name = symbol_table_name_for_id(
+        &self->predicate_values,
+        steps[0].value_id,
+        &name_length
+      );
+      bool is_positive;
+      if (name_length == 3 && !strncmp(name, "eq?", 3)) {
+        is_positive = true;
+      } else if (name_length == 7 && !strncmp(name, "not-eq?", 7)) {
+        is_positive = false;
+      } else {
+        continue;
+      }
+      array_push(&self->text_predicates, ((TextPredicate) {
+        .capture_id = steps[1].value_id,
+        .value_id = steps[2].value_id,
+        .type = steps[2].type == TSQueryPredicateStepTypeCapture
+          ? TextPredicateEqCapture
+          : TextPredicateEqString,
+        .is_positive = is_positive,
+      }));
+      pattern->text_predicates.length++;
+    }
+  }
+}
+
 TSQuery *ts_query_new(
   const TSLanguage *language,
   const char *source,
@@ -2567,6 +2714,7 @@ TSQuery *ts_query_new(
     .capture_quantifiers = array_new(),
     .predicate_values = symbol_table_new(),
     .predicate_steps = array_new(),
+    .text_predicates = array_new(),
     .patterns = array_new(),
     .step_offsets = array_new(),
     .string_buffer = array_new(),
@@ -2672,6 +2820,8 @@ TSQuery *ts_query_new(
     return NULL;
   }
 
+  ts_query__compile_text_predicates(self);
+
   array_delete(&self->string_buffer);
   return self;
 }
@@ -2681,6 +2831,7 @@ void ts_query_delete(TSQuery *self) {
     array_delete(&self->steps);
     array_delete(&self->pattern_map);
     array_delete(&self->predicate_steps);
+    array_delete(&self->text_predicates);
     array_delete(&self->patterns);
     array_delete(&self->step_offsets);
     array_delete(&self->string_buffer);
@@ -2828,6 +2979,220 @@ void ts_query_disable_pattern(
   }
 }
 
+/*********************
+ * QuerySerialization
+ *********************/
+
+// A serialized query starts with this header, which pins down everything
+// that has to match before the arrays that follow it can be interpreted:
+// the format itself, the host's in-memory step layout (the arrays are raw
+// struct images, so the format is host-specific), and a fingerprint of the
+// language build the query was compiled against.
+typedef struct {
+  char magic[4];
+  uint32_t format_version;
+  uint32_t step_size;
+  uint32_t language_version;
+  uint32_t symbol_count;
+  uint32_t state_count;
+  uint32_t production_id_count;
+  uint32_t field_count;
+  uint32_t wildcard_root_pattern_count;
+} SerializedQueryHeader;
+
+static const char SERIALIZED_QUERY_MAGIC[4] = {'T', 'S', 'Q', 'S'};
+static const uint32_t SERIALIZED_QUERY_FORMAT_VERSION = 2;
+
+typedef struct {
+  char *contents;
+  uint32_t size;
+  uint32_t capacity;
+} QueryWriter;
+
+typedef struct {
+  const char *data;
+  uint32_t size;
+  uint32_t position;
+} QueryReader;
+
+static void query_writer_push(
+  QueryWriter *self,
+  const void *data,
+  uint32_t length
+) {
+  if (length == 0) return;
+  if (self->size + length > self->capacity) {
+    while (self->size + length > self->capacity) self->capacity *= 2;
+    self->contents = ts_realloc(self->contents, self->capacity);
+  }
+  memcpy(self->contents + self->size, data, length);
+  self->size += length;
+}
+
+static void query_writer_push_array(
+  QueryWriter *self,
+  const VoidArray *array,
+  size_t element_size
+) {
+  query_writer_push(self, &array->size, sizeof(array->size));
+  query_writer_push(self, array->contents, array->size * element_size);
+}
+
+static bool query_reader_read(
+  QueryReader *self,
+  void *out,
+  uint32_t length
+) {
+  if (length == 0) return true;
+  if (length > self->size - self->position) return false;
+  memcpy(out, self->data + self->position, length);
+  self->position += length;
+  return true;
+}
+
+static bool query_reader_read_array(
+  QueryReader *self,
+  VoidArray *array,
+  size_t element_size
+) {
+  uint32_t count;
+  if (!query_reader_read(self, &count, sizeof(count))) return false;
+  if (count > (self->size - self->position) / element_size) return false;
+  array__reserve(array, element_size, count);
+  array->size = count;
+  return query_reader_read(self, array->contents, count * element_size);
+}
+
+void *ts_query_serialize(const TSQuery *self, uint32_t *length) {
+  QueryWriter writer = {
+    .contents = ts_malloc(1024),
+    .size = 0,
+    .capacity = 1024,
+  };
+
+  SerializedQueryHeader header = {
+    .format_version = SERIALIZED_QUERY_FORMAT_VERSION,
+    .step_size = sizeof(QueryStep),
+    .language_version = self->language->version,
+    .symbol_count = self->language->symbol_count,
+    .state_count = self->language->state_count,
+    .production_id_count = self->language->production_id_count,
+    .field_count = self->language->field_count,
+    .wildcard_root_pattern_count = self->wildcard_root_pattern_count,
+  };
+  memcpy(header.magic, SERIALIZED_QUERY_MAGIC, sizeof(header.magic));
+  query_writer_push(&writer, &header, sizeof(header));
+
+  query_writer_push_array(&writer, (const VoidArray *)&self->captures.characters, sizeof(char));
+  query_writer_push_array(&writer, (const VoidArray *)&self->captures.slices, sizeof(Slice));
+  query_writer_push_array(&writer, (const VoidArray *)&self->predicate_values.characters, sizeof(char));
+  query_writer_push_array(&writer, (const VoidArray *)&self->predicate_values.slices, sizeof(Slice));
+  query_writer_push_array(&writer, (const VoidArray *)&self->steps, sizeof(QueryStep));
+  query_writer_push_array(&writer, (const VoidArray *)&self->pattern_map, sizeof(PatternEntry));
+  query_writer_push_array(&writer, (const VoidArray *)&self->predicate_steps, sizeof(TSQueryPredicateStep));
+  query_writer_push_array(&writer, (const VoidArray *)&self->text_predicates, sizeof(TextPredicate));
+  query_writer_push_array(&writer, (const VoidArray *)&self->patterns, sizeof(QueryPattern));
+  query_writer_push_array(&writer, (const VoidArray *)&self->step_offsets, sizeof(StepOffset));
+  query_writer_push_array(&writer, (const VoidArray *)&self->negated_fields, sizeof(TSFieldId));
+
+  // Capture quantifiers are an array of arrays, so each entry carries its
+  // own length.
+  query_writer_push(&writer, &self->capture_quantifiers.size, sizeof(uint32_t));
+  for (uint32_t i = 0; i < self->capture_quantifiers.size; i++) {
+    const CaptureQuantifiers *quantifiers = &self->capture_quantifiers.contents[i];
+    query_writer_push_array(&writer, (const VoidArray *)quantifiers, sizeof(uint8_t));
+  }
+
+  *length = writer.size;
+  return writer.contents;
+}
+
+TSQuery *ts_query_deserialize(
+  const void *buffer,
+  uint32_t length,
+  const TSLanguage *language
+) {
+  if (!buffer || !language) return NULL;
+
+  QueryReader reader = {
+    .data = buffer,
+    .size = length,
+    .position = 0,
+  };
+
+  SerializedQueryHeader header;
+  if (!query_reader_read(&reader, &header, sizeof(header))) return NULL;
+  if (
+    memcmp(header.magic, SERIALIZED_QUERY_MAGIC, sizeof(header.magic)) != 0 ||
+    header.format_version != SERIALIZED_QUERY_FORMAT_VERSION ||
+    header.step_size != sizeof(QueryStep) ||
+    header.language_version != language->version ||
+    header.symbol_count != language->symbol_count ||
+    header.state_count != language->state_count ||
+    header.production_id_count != language->production_id_count ||
+    header.field_count != language->field_count
+  ) return NULL;
+
+  TSQuery *self = ts_malloc(sizeof(TSQuery));
+  *self = (TSQuery) {
+    .steps = array_new(),
+    .pattern_map = array_new(),
+    .captures = symbol_table_new(),
+    .capture_quantifiers = array_new(),
+    .predicate_values = symbol_table_new(),
+    .predicate_steps = array_new(),
+    .text_predicates = array_new(),
+    .patterns = array_new(),
+    .step_offsets = array_new(),
+    .string_buffer = array_new(),
+    .negated_fields = array_new(),
+    .wildcard_root_pattern_count = header.wildcard_root_pattern_count,
+    .language = language,
+  };
+
+  bool ok =
+    query_reader_read_array(&reader, (VoidArray *)&self->captures.characters, sizeof(char)) &&
+    query_reader_read_array(&reader, (VoidArray *)&self->captures.slices, sizeof(Slice)) &&
+    query_reader_read_array(&reader, (VoidArray *)&self->predicate_values.characters, sizeof(char)) &&
+    query_reader_read_array(&reader, (VoidArray *)&self->predicate_values.slices, sizeof(Slice)) &&
+    query_reader_read_array(&reader, (VoidArray *)&self->steps, sizeof(QueryStep)) &&
+    query_reader_read_array(&reader, (VoidArray *)&self->pattern_map, sizeof(PatternEntry)) &&
+    query_reader_read_array(&reader, (VoidArray *)&self->predicate_steps, sizeof(TSQueryPredicateStep)) &&
+    query_reader_read_array(&reader, (VoidArray *)&self->text_predicates, sizeof(TextPredicate)) &&
+    query_reader_read_array(&reader, (VoidArray *)&self->patterns, sizeof(QueryPattern)) &&
+    query_reader_read_array(&reader, (VoidArray *)&self->step_offsets, sizeof(StepOffset)) &&
+    query_reader_read_array(&reader, (VoidArray *)&self->negated_fields, sizeof(TSFieldId));
+
+  uint32_t quantifier_count = 0;
+  ok = ok && query_reader_read(&reader, &quantifier_count, sizeof(quantifier_count));
+  for (uint32_t i = 0; ok && i < quantifier_count; i++) {
+    CaptureQuantifiers quantifiers = capture_quantifiers_new();
+    ok = query_reader_read_array(&reader, (VoidArray *)&quantifiers, sizeof(uint8_t));
+    array_push(&self->capture_quantifiers, quantifiers);
+  }
+
+  // The header's wildcard count and the pattern map entries index into the
+  // arrays read above; the header fingerprint cannot vouch for them, so an
+  // out-of-range value here must reject the buffer rather than drive later
+  // pattern-map searches out of bounds.
+  if (ok && header.wildcard_root_pattern_count > self->pattern_map.size) {
+    ok = false;
+  }
+  for (uint32_t i = 0; ok && i < self->pattern_map.size; i++) {
+    const PatternEntry *entry = &self->pattern_map.contents[i];
+    if (
+      entry->step_index >= self->steps.size ||
+      entry->pattern_index >= self->patterns.size
+    ) ok = false;
+  }
+
+  if (!ok || reader.position != reader.size) {
+    ts_query_delete(self);
+    return NULL;
+  }
+  return self;
+}
+
 /***************
  * QueryCursor
  ***************/
@@ -2845,6 +3210,17 @@ TSQueryCursor *ts_query_cursor_new(void) {
     .end_byte = UINT32_MAX,
     .start_point = {0, 0},
     .end_point = POINT_MAX,
+    .included_ranges = array_new(),
+    .text = NULL,
+    .text_length = 0,
+    .skipped_node_count = 0,
+    .pattern_stats = array_new(),
+    .pattern_step_limit = 0,
+    .visited_node_mark = 0,
+    .returned_captures = array_new(),
+    .returned_capture_byte = UINT32_MAX,
+    .deduplicate_captures = false,
+    .pattern_timing_enabled = false,
   };
   array_reserve(&self->states, 8);
   array_reserve(&self->finished_states, 8);
@@ -2854,6 +3230,9 @@ TSQueryCursor *ts_query_cursor_new(void) {
 void ts_query_cursor_delete(TSQueryCursor *self) {
   array_delete(&self->states);
   array_delete(&self->finished_states);
+  array_delete(&self->included_ranges);
+  array_delete(&self->pattern_stats);
+  array_delete(&self->returned_captures);
   ts_tree_cursor_delete(&self->cursor);
   capture_list_pool_delete(&self->capture_list_pool);
   ts_free(self);
@@ -2863,6 +3242,10 @@ bool ts_query_cursor_did_exceed_match_limit(const TSQueryCursor *self) {
   return self->did_exceed_match_limit;
 }
 
+uint32_t ts_query_cursor_skipped_node_count(const TSQueryCursor *self) {
+  return self->skipped_node_count;
+}
+
 uint32_t ts_query_cursor_match_limit(const TSQueryCursor *self) {
   return self->capture_list_pool.max_capture_list_count;
 }
@@ -2871,6 +3254,109 @@ void ts_query_cursor_set_match_limit(TSQueryCursor *self, uint32_t limit) {
   self->capture_list_pool.max_capture_list_count = limit;
 }
 
+uint32_t ts_query_cursor_max_memory(const TSQueryCursor *self) {
+  return self->capture_list_pool.max_memory_bytes;
+}
+
+void ts_query_cursor_set_max_memory(TSQueryCursor *self, uint32_t max_bytes) {
+  self->capture_list_pool.max_memory_bytes = max_bytes;
+}
+
+TSQueryPatternStats ts_query_cursor_pattern_stats(
+  const TSQueryCursor *self,
+  uint32_t pattern_index
+) {
+  if (pattern_index >= self->pattern_stats.size) {
+    return (TSQueryPatternStats) {0, 0, 0, 0, false};
+  }
+  return self->pattern_stats.contents[pattern_index].stats;
+}
+
+void ts_query_cursor_set_pattern_timing_enabled(TSQueryCursor *self, bool enabled) {
+  self->pattern_timing_enabled = enabled;
+}
+
+uint32_t ts_query_cursor_pattern_step_limit(const TSQueryCursor *self) {
+  return self->pattern_step_limit;
+}
+
+void ts_query_cursor_set_pattern_step_limit(TSQueryCursor *self, uint32_t limit) {
+  self->pattern_step_limit = limit;
+}
+
+bool ts_query_cursor_deduplicate_captures(const TSQueryCursor *self) {
+  return self->deduplicate_captures;
+}
+
+void ts_query_cursor_set_deduplicate_captures(TSQueryCursor *self, bool enabled) {
+  self->deduplicate_captures = enabled;
+}
+
+void ts_query_cursor_set_text(
+  TSQueryCursor *self,
+  const char *text,
+  uint32_t length
+) {
+  self->text = text;
+  self->text_length = text ? length : 0;
+}
+
+void ts_query_cursor_reset(TSQueryCursor *self) {
+  array_clear(&self->states);
+  array_clear(&self->finished_states);
+  array_clear(&self->included_ranges);
+  array_clear(&self->pattern_stats);
+  array_clear(&self->returned_captures);
+  self->returned_capture_byte = UINT32_MAX;
+  self->visited_node_mark = 0;
+  capture_list_pool_reset(&self->capture_list_pool);
+  self->query = NULL;
+  self->next_state_id = 0;
+  self->depth = 0;
+  self->ascending = false;
+  self->halted = true;
+  self->did_exceed_match_limit = false;
+  self->start_byte = 0;
+  self->end_byte = UINT32_MAX;
+  self->start_point = (TSPoint) {0, 0};
+  self->end_point = POINT_MAX;
+  self->text = NULL;
+  self->text_length = 0;
+  self->skipped_node_count = 0;
+}
+
+// Check whether a span of the document intersects the region the cursor
+// is restricted to: the single start/end range, and - when one was set -
+// the sorted array of included ranges.
+static bool ts_query_cursor__intersects_range(
+  const TSQueryCursor *self,
+  uint32_t start_byte,
+  uint32_t end_byte,
+  TSPoint start_point,
+  TSPoint end_point
+) {
+  if (!(
+    end_byte > self->start_byte &&
+    start_byte < self->end_byte &&
+    point_gt(end_point, self->start_point) &&
+    point_lt(start_point, self->end_point)
+  )) return false;
+  if (self->included_ranges.size == 0) return true;
+
+  // Find the first included range that ends after the span starts.
+  uint32_t low = 0, high = self->included_ranges.size;
+  while (low < high) {
+    uint32_t mid = low + (high - low) / 2;
+    if (self->included_ranges.contents[mid].end_byte > start_byte) {
+      high = mid;
+    } else {
+      low = mid + 1;
+    }
+  }
+  if (low == self->included_ranges.size) return false;
+  return self->included_ranges.contents[low].start_byte < end_byte;
+}
+
 void ts_query_cursor_exec(
   TSQueryCursor *self,
   const TSQuery *query,
@@ -2886,6 +3372,72 @@ void ts_query_cursor_exec(
   self->halted = false;
   self->query = query;
   self->did_exceed_match_limit = false;
+  self->skipped_node_count = 0;
+  array_clear(&self->returned_captures);
+  self->returned_capture_byte = UINT32_MAX;
+
+  array_clear(&self->pattern_stats);
+  for (uint32_t i = 0; i < query->patterns.size; i++) {
+    array_push(&self->pattern_stats, ((PatternStatsEntry) {.last_node_mark = 0}));
+  }
+  self->visited_node_mark = 0;
+
+  // Subtrees outside of the cursor's range can only be skipped wholesale if
+  // no pattern can start at a node whose *parent* intersects the range.
+  self->query_has_non_rooted_patterns = false;
+  for (uint32_t i = 0; i < query->pattern_map.size; i++) {
+    if (!query->pattern_map.contents[i].is_rooted) {
+      self->query_has_non_rooted_patterns = true;
+      break;
+    }
+  }
+}
+
+uint32_t ts_query_cursor_exec_sharded(
+  const TSQuery *query,
+  TSNode node,
+  TSQueryCursor **cursors,
+  uint32_t cursor_count
+) {
+  uint32_t child_count = ts_node_child_count(node);
+  uint32_t start_byte = ts_node_start_byte(node);
+  uint32_t end_byte = ts_node_end_byte(node);
+
+  if (cursor_count == 0) return 0;
+  if (cursor_count == 1 || child_count < 2 || end_byte <= start_byte) {
+    ts_query_cursor_set_byte_range(cursors[0], start_byte, end_byte);
+    ts_query_cursor_exec(cursors[0], query, node);
+    return 1;
+  }
+
+  // Walk the node's children, closing out a shard whenever the current
+  // shard has accumulated its share of the node's bytes. Boundaries are
+  // only placed between two children that both have non-zero width, so
+  // that every child - including zero-width children like missing
+  // nodes - intersects exactly one shard's byte range.
+  uint32_t bytes_per_shard = (end_byte - start_byte) / cursor_count;
+  uint32_t shard_index = 0;
+  uint32_t shard_start_byte = start_byte;
+  for (uint32_t i = 0; i + 1 < child_count && shard_index + 1 < cursor_count; i++) {
+    TSNode child = ts_node_child(node, i);
+    TSNode next_child = ts_node_child(node, i + 1);
+    uint32_t boundary = ts_node_end_byte(child);
+    if (
+      boundary >= shard_start_byte + bytes_per_shard &&
+      ts_node_start_byte(child) < ts_node_end_byte(child) &&
+      ts_node_start_byte(next_child) < ts_node_end_byte(next_child) &&
+      ts_node_start_byte(next_child) >= boundary
+    ) {
+      ts_query_cursor_set_byte_range(cursors[shard_index], shard_start_byte, boundary);
+      ts_query_cursor_exec(cursors[shard_index], query, node);
+      shard_index++;
+      shard_start_byte = boundary;
+    }
+  }
+
+  ts_query_cursor_set_byte_range(cursors[shard_index], shard_start_byte, end_byte);
+  ts_query_cursor_exec(cursors[shard_index], query, node);
+  return shard_index + 1;
 }
 
 void ts_query_cursor_set_byte_range(
@@ -2912,10 +3464,75 @@ void ts_query_cursor_set_point_range(
   self->end_point = end_point;
 }
 
+bool ts_query_cursor_set_included_ranges(
+  TSQueryCursor *self,
+  const TSRange *ranges,
+  uint32_t count
+) {
+  uint32_t previous_byte = 0;
+  for (unsigned i = 0; i < count; i++) {
+    const TSRange *range = &ranges[i];
+    if (
+      range->start_byte < previous_byte ||
+      range->end_byte < range->start_byte
+    ) return false;
+    previous_byte = range->end_byte;
+  }
+
+  array_clear(&self->included_ranges);
+  for (unsigned i = 0; i < count; i++) {
+    array_push(&self->included_ranges, ranges[i]);
+  }
+  return true;
+}
+
+void ts_query_cursor_exec_changed(
+  TSQueryCursor *self,
+  const TSQuery *query,
+  TSNode node,
+  const TSTree *old_tree
+) {
+  uint32_t range_count;
+  TSRange *ranges = ts_tree_get_changed_ranges(old_tree, node.tree, &range_count);
+  if (range_count > 0) {
+    ts_query_cursor_set_included_ranges(self, ranges, range_count);
+  } else {
+    // Nothing changed: restrict the cursor to an empty range so that it
+    // reports no matches.
+    TSRange empty_range = {{0, 0}, {0, 0}, 0, 0};
+    ts_query_cursor_set_included_ranges(self, &empty_range, 1);
+  }
+  ts_free(ranges);
+  ts_query_cursor_exec(self, query, node);
+}
+
+// Get a state's captures, which are stored inline in the state itself until
+// their number exceeds `MAX_INLINE_CAPTURE_COUNT`, at which point they are
+// moved into a list acquired from the capture list pool.
+static const TSQueryCapture *ts_query_cursor__state_captures(
+  const TSQueryCursor *self,
+  const QueryState *state,
+  uint32_t *count
+) {
+  if (state->capture_list_id == CAPTURE_LIST_NONE) {
+    *count = state->inline_capture_count;
+    return state->inline_captures;
+  }
+  const CaptureList *list = capture_list_pool_get(
+    &self->capture_list_pool,
+    state->capture_list_id
+  );
+  *count = list->size;
+  return list->contents;
+}
+
 // Search through all of the in-progress states, and find the captured
-// node that occurs earliest in the document.
+// node that occurs earliest in the document. When `pooled_only` is set,
+// only consider states whose captures occupy a list from the pool; this
+// is used when looking for a capture list to steal.
 static bool ts_query_cursor__first_in_progress_capture(
   TSQueryCursor *self,
+  bool pooled_only,
   uint32_t *state_index,
   uint32_t *byte_offset,
   uint32_t *pattern_index,
@@ -2928,16 +3545,19 @@ static bool ts_query_cursor__first_in_progress_capture(
   for (unsigned i = 0; i < self->states.size; i++) {
     QueryState *state = &self->states.contents[i];
     if (state->dead) continue;
+    if (pooled_only && state->capture_list_id == CAPTURE_LIST_NONE) continue;
 
-    const CaptureList *captures = capture_list_pool_get(
-      &self->capture_list_pool,
-      state->capture_list_id
+    uint32_t capture_count;
+    const TSQueryCapture *captures = ts_query_cursor__state_captures(
+      self,
+      state,
+      &capture_count
     );
-    if (state->consumed_capture_count >= captures->size) {
+    if (state->consumed_capture_count >= capture_count) {
       continue;
     }
 
-    TSNode node = captures->contents[state->consumed_capture_count].node;
+    TSNode node = captures[state->consumed_capture_count].node;
     if (
       ts_node_end_byte(node) <= self->start_byte ||
       point_lte(ts_node_end_point(node), self->start_point)
@@ -2992,22 +3612,25 @@ void ts_query_cursor__compare_captures(
   bool *left_contains_right,
   bool *right_contains_left
 ) {
-  const CaptureList *left_captures = capture_list_pool_get(
-    &self->capture_list_pool,
-    left_state->capture_list_id
+  uint32_t left_capture_count, right_capture_count;
+  const TSQueryCapture *left_captures = ts_query_cursor__state_captures(
+    self,
+    left_state,
+    &left_capture_count
   );
-  const CaptureList *right_captures = capture_list_pool_get(
-    &self->capture_list_pool,
-    right_state->capture_list_id
+  const TSQueryCapture *right_captures = ts_query_cursor__state_captures(
+    self,
+    right_state,
+    &right_capture_count
   );
   *left_contains_right = true;
   *right_contains_left = true;
   unsigned i = 0, j = 0;
   for (;;) {
-    if (i < left_captures->size) {
-      if (j < right_captures->size) {
-        TSQueryCapture *left = &left_captures->contents[i];
-        TSQueryCapture *right = &right_captures->contents[j];
+    if (i < left_capture_count) {
+      if (j < right_capture_count) {
+        const TSQueryCapture *left = &left_captures[i];
+        const TSQueryCapture *right = &right_captures[j];
         if (left->node.id == right->node.id && left->index == right->index) {
           i++;
           j++;
@@ -3034,7 +3657,7 @@ void ts_query_cursor__compare_captures(
         break;
       }
     } else {
-      if (j < right_captures->size) {
+      if (j < right_capture_count) {
         *left_contains_right = false;
       }
       break;
@@ -3048,6 +3671,30 @@ void ts_query_cursor__compare_captures(
 #define LOG(...)
 #endif
 
+// Record that one step of the given pattern was evaluated against the
+// current node, and report whether the pattern is still allowed to make
+// progress under the cursor's per-pattern step limit. Once a pattern has
+// exhausted the limit, it is halted for the rest of the execution; the
+// query's other patterns are unaffected.
+static inline bool ts_query_cursor__account_step(
+  TSQueryCursor *self,
+  uint16_t pattern_index
+) {
+  PatternStatsEntry *entry = &self->pattern_stats.contents[pattern_index];
+  entry->stats.steps_evaluated++;
+  if (entry->last_node_mark != self->visited_node_mark) {
+    entry->last_node_mark = self->visited_node_mark;
+    entry->stats.nodes_visited++;
+  }
+  if (
+    self->pattern_step_limit &&
+    entry->stats.steps_evaluated > self->pattern_step_limit
+  ) {
+    entry->stats.exceeded_step_limit = true;
+  }
+  return !entry->stats.exceeded_step_limit;
+}
+
 static void ts_query_cursor__add_state(
   TSQueryCursor *self,
   const PatternEntry *pattern
@@ -3095,9 +3742,11 @@ static void ts_query_cursor__add_state(
     pattern->pattern_index,
     pattern->step_index
   );
+  self->pattern_stats.contents[pattern->pattern_index].stats.states_created++;
   array_insert(&self->states, index, ((QueryState) {
     .id = UINT32_MAX,
-    .capture_list_id = NONE,
+    .capture_list_id = CAPTURE_LIST_NONE,
+    .inline_capture_count = 0,
     .step_index = pattern->step_index,
     .pattern_index = pattern->pattern_index,
     .start_depth = start_depth,
@@ -3109,26 +3758,29 @@ static void ts_query_cursor__add_state(
   }));
 }
 
-// Acquire a capture list for this state. If there are no capture lists left in the
-// pool, this will steal the capture list from another existing state, and mark that
-// other state as 'dead'.
+// Acquire a capture list for this state, moving any captures that were stored
+// inline in the state into the acquired list. If there are no capture lists left
+// in the pool, this will steal the capture list from another existing state, and
+// mark that other state as 'dead'.
 static CaptureList *ts_query_cursor__prepare_to_capture(
   TSQueryCursor *self,
   QueryState *state,
   unsigned state_index_to_preserve
 ) {
-  if (state->capture_list_id == NONE) {
+  if (state->capture_list_id == CAPTURE_LIST_NONE) {
     state->capture_list_id = capture_list_pool_acquire(&self->capture_list_pool);
 
     // If there are no capture lists left in the pool, then terminate whichever
     // state has captured the earliest node in the document, and steal its
-    // capture list.
-    if (state->capture_list_id == NONE) {
+    // capture list. Only states whose captures have already spilled out of
+    // their inline storage actually hold a list that can be stolen.
+    if (state->capture_list_id == CAPTURE_LIST_NONE) {
       self->did_exceed_match_limit = true;
       uint32_t state_index, byte_offset, pattern_index;
       if (
         ts_query_cursor__first_in_progress_capture(
           self,
+          true,
           &state_index,
           &byte_offset,
           &pattern_index,
@@ -3142,21 +3794,26 @@ static CaptureList *ts_query_cursor__prepare_to_capture(
         );
         QueryState *other_state = &self->states.contents[state_index];
         state->capture_list_id = other_state->capture_list_id;
-        other_state->capture_list_id = NONE;
+        other_state->capture_list_id = CAPTURE_LIST_NONE;
         other_state->dead = true;
         CaptureList *list = capture_list_pool_get_mut(
           &self->capture_list_pool,
           state->capture_list_id
         );
         array_clear(list);
-        return list;
       } else {
         LOG("  ran out of capture lists");
         return NULL;
       }
     }
   }
-  return capture_list_pool_get_mut(&self->capture_list_pool, state->capture_list_id);
+
+  CaptureList *list = capture_list_pool_get_mut(&self->capture_list_pool, state->capture_list_id);
+  for (unsigned i = 0; i < state->inline_capture_count; i++) {
+    array_push(list, state->inline_captures[i]);
+  }
+  state->inline_capture_count = 0;
+  return list;
 }
 
 static void ts_query_cursor__capture(
@@ -3166,22 +3823,34 @@ static void ts_query_cursor__capture(
   TSNode node
 ) {
   if (state->dead) return;
-  CaptureList *capture_list = ts_query_cursor__prepare_to_capture(self, state, UINT32_MAX);
-  if (!capture_list) {
-    state->dead = true;
-    return;
-  }
 
   for (unsigned j = 0; j < MAX_STEP_CAPTURE_COUNT; j++) {
     uint16_t capture_id = step->capture_ids[j];
     if (step->capture_ids[j] == NONE) break;
-    array_push(capture_list, ((TSQueryCapture) { node, capture_id }));
+    uint32_t capture_count;
+    if (
+      state->capture_list_id == CAPTURE_LIST_NONE &&
+      state->inline_capture_count < MAX_INLINE_CAPTURE_COUNT
+    ) {
+      state->inline_captures[state->inline_capture_count++] =
+        (TSQueryCapture) { node, capture_id };
+      capture_count = state->inline_capture_count;
+    } else {
+      CaptureList *capture_list = ts_query_cursor__prepare_to_capture(self, state, UINT32_MAX);
+      if (!capture_list) {
+        state->dead = true;
+        return;
+      }
+      array_push(capture_list, ((TSQueryCapture) { node, capture_id }));
+      capture_count = capture_list->size;
+    }
+    (void)capture_count;
     LOG(
       "  capture node. type:%s, pattern:%u, capture_id:%u, capture_count:%u\n",
       ts_node_type(node),
       state->pattern_index,
       capture_id,
-      capture_list->size
+      capture_count
     );
   }
 }
@@ -3196,10 +3865,11 @@ static QueryState *ts_query_cursor__copy_state(
   const QueryState *state = *state_ref;
   uint32_t state_index = state - self->states.contents;
   QueryState copy = *state;
-  copy.capture_list_id = NONE;
+  copy.capture_list_id = CAPTURE_LIST_NONE;
 
-  // If the state has captures, copy its capture list.
-  if (state->capture_list_id != NONE) {
+  // If the state's captures have spilled into the pool, copy its capture list.
+  // Captures still stored inline were already duplicated along with the state.
+  if (state->capture_list_id != CAPTURE_LIST_NONE) {
     CaptureList *new_captures = ts_query_cursor__prepare_to_capture(self, &copy, state_index);
     if (!new_captures) return NULL;
     const CaptureList *old_captures = capture_list_pool_get(
@@ -3209,6 +3879,7 @@ static QueryState *ts_query_cursor__copy_state(
     array_push_all(new_captures, old_captures);
   }
 
+  self->pattern_stats.contents[state->pattern_index].stats.states_created++;
   array_insert(&self->states, state_index + 1, copy);
   *state_ref = &self->states.contents[state_index];
   return &self->states.contents[state_index + 1];
@@ -3302,6 +3973,47 @@ static inline bool ts_query_cursor__advance(
       TSNode parent_node = ts_tree_cursor_parent_node(&self->cursor);
       TSSymbol symbol = ts_node_symbol(node);
       bool is_named = ts_node_is_named(node);
+
+      bool node_intersects_range = ts_query_cursor__intersects_range(
+        self,
+        ts_node_start_byte(node), ts_node_end_byte(node),
+        ts_node_start_point(node), ts_node_end_point(node)
+      );
+      bool parent_intersects_range =
+        ts_node_is_null(parent_node) ||
+        ts_query_cursor__intersects_range(
+          self,
+          ts_node_start_byte(parent_node), ts_node_end_byte(parent_node),
+          ts_node_start_point(parent_node), ts_node_end_point(parent_node)
+        );
+      bool node_is_error = symbol == ts_builtin_sym_error;
+      bool parent_is_error =
+        !ts_node_is_null(parent_node) &&
+        ts_node_symbol(parent_node) == ts_builtin_sym_error;
+
+      // If this subtree lies entirely outside of the cursor's range, no
+      // in-progress state needs anything inside of it, and no pattern can
+      // start at one of its descendants, then step over it without visiting
+      // its contents or computing this node's field and supertype status.
+      if (
+        !node_intersects_range &&
+        self->states.size == 0 &&
+        (
+          !self->query_has_non_rooted_patterns ||
+          !parent_intersects_range ||
+          parent_is_error
+        )
+      ) {
+        LOG(
+          "skip node. depth:%u, type:%s\n",
+          self->depth,
+          ts_node_type(node)
+        );
+        self->skipped_node_count += ts_subtree_node_count(*(const Subtree *)node.id);
+        self->ascending = true;
+        continue;
+      }
+
       bool has_later_siblings;
       bool has_later_named_siblings;
       bool can_have_later_siblings_with_this_field;
@@ -3327,22 +4039,7 @@ static inline bool ts_query_cursor__advance(
         self->finished_states.size
       );
 
-      bool node_intersects_range = (
-        ts_node_end_byte(node) > self->start_byte &&
-        ts_node_start_byte(node) < self->end_byte &&
-        point_gt(ts_node_end_point(node), self->start_point) &&
-        point_lt(ts_node_start_point(node), self->end_point)
-      );
-      bool parent_intersects_range = ts_node_is_null(parent_node) || (
-        ts_node_end_byte(parent_node) > self->start_byte &&
-        ts_node_start_byte(parent_node) < self->end_byte &&
-        point_gt(ts_node_end_point(parent_node), self->start_point) &&
-        point_lt(ts_node_start_point(parent_node), self->end_point)
-      );
-      bool node_is_error = symbol == ts_builtin_sym_error;
-      bool parent_is_error =
-        !ts_node_is_null(parent_node) &&
-        ts_node_symbol(parent_node) == ts_builtin_sym_error;
+      self->visited_node_mark++;
 
       // Add new states for any patterns whose root node is a wildcard.
       if (!node_is_error) {
@@ -3353,6 +4050,7 @@ static inline bool ts_query_cursor__advance(
           // state at the start of this pattern.
           QueryStep *step = &self->query->steps.contents[pattern->step_index];
           if (
+            ts_query_cursor__account_step(self, pattern->pattern_index) &&
             (pattern->is_rooted ?
               node_intersects_range :
               (parent_intersects_range && !parent_is_error)) &&
@@ -3374,6 +4072,7 @@ static inline bool ts_query_cursor__advance(
           // If this node matches the first step of the pattern, then add a new
           // state at the start of this pattern.
           if (
+            ts_query_cursor__account_step(self, pattern->pattern_index) &&
             (pattern->is_rooted ?
               node_intersects_range :
               (parent_intersects_range && !parent_is_error)) &&
@@ -3390,6 +4089,13 @@ static inline bool ts_query_cursor__advance(
         } while (step->symbol == symbol);
       }
 
+      // When per-pattern timing is enabled, attribute the time spent in each
+      // iteration of the following loop to the pattern whose state it
+      // processed, using one clock read per iteration.
+      TSClock stats_clock = clock_null();
+      uint32_t timed_pattern = UINT32_MAX;
+      if (self->pattern_timing_enabled) stats_clock = clock_now();
+
       // Update all of the in-progress states with current node.
       for (unsigned i = 0, copy_count = 0; i < self->states.size; i += 1 + copy_count) {
         QueryState *state = &self->states.contents[i];
@@ -3397,10 +4103,32 @@ static inline bool ts_query_cursor__advance(
         state->has_in_progress_alternatives = false;
         copy_count = 0;
 
+        if (self->pattern_timing_enabled) {
+          TSClock now = clock_now();
+          if (timed_pattern != UINT32_MAX) {
+            self->pattern_stats.contents[timed_pattern].stats.elapsed_nanos +=
+              clock_elapsed_nanos(stats_clock, now);
+          }
+          stats_clock = now;
+          timed_pattern = state->pattern_index;
+        }
+
         // Check that the node matches all of the criteria for the next
         // step of the pattern.
         if ((uint32_t)state->start_depth + (uint32_t)step->depth != self->depth) continue;
 
+        // Account for this step evaluation, and abandon the state if its
+        // pattern has exhausted the per-pattern step limit.
+        if (!ts_query_cursor__account_step(self, state->pattern_index)) {
+          capture_list_pool_release(
+            &self->capture_list_pool,
+            state->capture_list_id
+          );
+          array_erase(&self->states, i);
+          i--;
+          continue;
+        }
+
         // Determine if this node matches this step of the pattern, and also
         // if this node can have later siblings that match this step of the
         // pattern.
@@ -3570,13 +4298,16 @@ static inline bool ts_query_cursor__advance(
 
             QueryState *copy = ts_query_cursor__copy_state(self, &state);
             if (copy) {
+              uint32_t copy_capture_count;
+              ts_query_cursor__state_captures(self, copy, &copy_capture_count);
+              (void)copy_capture_count;
               LOG(
                 "  split state for branch. pattern:%u, from_step:%u, to_step:%u, immediate:%d, capture_count: %u\n",
                 copy->pattern_index,
                 copy->step_index,
                 next_step->alternative_index,
                 next_step->alternative_is_immediate,
-                capture_list_pool_get(&self->capture_list_pool, copy->capture_list_id)->size
+                copy_capture_count
               );
               end_index++;
               copy_count++;
@@ -3589,6 +4320,11 @@ static inline bool ts_query_cursor__advance(
         }
       }
 
+      if (self->pattern_timing_enabled && timed_pattern != UINT32_MAX) {
+        self->pattern_stats.contents[timed_pattern].stats.elapsed_nanos +=
+          clock_elapsed_nanos(stats_clock, clock_now());
+      }
+
       for (unsigned i = 0; i < self->states.size; i++) {
         QueryState *state = &self->states.contents[i];
         if (state->dead) {
@@ -3655,12 +4391,15 @@ static inline bool ts_query_cursor__advance(
         // If the state is at the end of its pattern, remove it from the list
         // of in-progress states and add it to the list of finished states.
         if (!did_remove) {
+          uint32_t capture_count;
+          ts_query_cursor__state_captures(self, state, &capture_count);
+          (void)capture_count;
           LOG(
             "  keep state. pattern: %u, start_depth: %u, step_index: %u, capture_count: %u\n",
             state->pattern_index,
             state->start_depth,
             state->step_index,
-            capture_list_pool_get(&self->capture_list_pool, state->capture_list_id)->size
+            capture_count
           );
           QueryStep *next_step = &self->query->steps.contents[state->step_index];
           if (next_step->depth == PATTERN_DONE_MARKER) {
@@ -3711,29 +4450,128 @@ static inline bool ts_query_cursor__advance(
   }
 }
 
+// Retrieve the document text for a node, if the text given to
+// `ts_query_cursor_set_text` covers the node's byte range.
+static bool ts_query_cursor__node_text(
+  const TSQueryCursor *self,
+  TSNode node,
+  const char **text,
+  uint32_t *length
+) {
+  uint32_t start_byte = ts_node_start_byte(node);
+  uint32_t end_byte = ts_node_end_byte(node);
+  if (end_byte > self->text_length) return false;
+  *text = self->text + start_byte;
+  *length = end_byte - start_byte;
+  return true;
+}
+
+// Evaluate the compiled `#eq?` / `#not-eq?` predicates for a finished match
+// against the text given to `ts_query_cursor_set_text`. Captures whose byte
+// ranges fall outside of that text cannot be evaluated and are not held
+// against the match.
+static bool ts_query_cursor__satisfies_text_predicates(
+  const TSQueryCursor *self,
+  const QueryState *state
+) {
+  const TSQuery *query = self->query;
+  Slice slice = query->patterns.contents[state->pattern_index].text_predicates;
+  if (slice.length == 0) return true;
+  uint32_t capture_count;
+  const TSQueryCapture *captures = ts_query_cursor__state_captures(
+    self,
+    state,
+    &capture_count
+  );
+  for (uint32_t i = 0; i < slice.length; i++) {
+    const TextPredicate *predicate = &query->text_predicates.contents[slice.offset + i];
+    if (predicate->type == TextPredicateEqString) {
+      // Every occurrence of the capture must compare as required with the
+      // interned string.
+      uint32_t value_length;
+      const char *value = symbol_table_name_for_id(
+        &query->predicate_values,
+        predicate->value_id,
+        &value_length
+      );
+      for (uint32_t j = 0; j < capture_count; j++) {
+        if (captures[j].index != predicate->capture_id) continue;
+        const char *text;
+        uint32_t length;
+        if (!ts_query_cursor__node_text(self, captures[j].node, &text, &length)) continue;
+        bool is_equal = length == value_length && memcmp(text, value, length) == 0;
+        if (is_equal != predicate->is_positive) return false;
+      }
+    } else {
+      // Compare the first occurrence of each of the two captures.
+      TSNode node1 = (TSNode) {.id = NULL};
+      TSNode node2 = (TSNode) {.id = NULL};
+      for (uint32_t j = 0; j < capture_count; j++) {
+        const TSQueryCapture *capture = &captures[j];
+        if (ts_node_is_null(node1) && capture->index == predicate->capture_id) node1 = capture->node;
+        if (ts_node_is_null(node2) && capture->index == predicate->value_id) node2 = capture->node;
+      }
+      if (ts_node_is_null(node1) || ts_node_is_null(node2)) continue;
+      const char *text1, *text2;
+      uint32_t length1, length2;
+      if (
+        !ts_query_cursor__node_text(self, node1, &text1, &length1) ||
+        !ts_query_cursor__node_text(self, node2, &text2, &length2)
+      ) continue;
+      bool is_equal = length1 == length2 && memcmp(text1, text2, length1) == 0;
+      if (is_equal != predicate->is_positive) return false;
+    }
+  }
+  return true;
+}
+
 bool ts_query_cursor_next_match(
   TSQueryCursor *self,
   TSQueryMatch *match
 ) {
-  if (self->finished_states.size == 0) {
-    if (!ts_query_cursor__advance(self, false)) {
-      return false;
+  for (;;) {
+    if (self->finished_states.size == 0) {
+      if (!ts_query_cursor__advance(self, false)) {
+        return false;
+      }
     }
-  }
 
-  QueryState *state = &self->finished_states.contents[0];
-  if (state->id == UINT32_MAX) state->id = self->next_state_id++;
-  match->id = state->id;
-  match->pattern_index = state->pattern_index;
-  const CaptureList *captures = capture_list_pool_get(
-    &self->capture_list_pool,
-    state->capture_list_id
-  );
-  match->captures = captures->contents;
-  match->capture_count = captures->size;
-  capture_list_pool_release(&self->capture_list_pool, state->capture_list_id);
-  array_erase(&self->finished_states, 0);
-  return true;
+    QueryState *state = &self->finished_states.contents[0];
+
+    // When the document text has been provided, filter out matches that fail
+    // their pattern's compiled text predicates.
+    if (self->text && !ts_query_cursor__satisfies_text_predicates(self, state)) {
+      capture_list_pool_release(&self->capture_list_pool, state->capture_list_id);
+      array_erase(&self->finished_states, 0);
+      continue;
+    }
+
+    if (state->id == UINT32_MAX) state->id = self->next_state_id++;
+    match->id = state->id;
+    match->pattern_index = state->pattern_index;
+    uint32_t capture_count;
+    const TSQueryCapture *captures = ts_query_cursor__state_captures(
+      self,
+      state,
+      &capture_count
+    );
+    if (state->capture_list_id == CAPTURE_LIST_NONE) {
+      // The captures live inside the state, which is about to be erased, so
+      // copy them into the cursor's scratch space.
+      memcpy(
+        self->returned_inline_captures,
+        captures,
+        capture_count * sizeof(TSQueryCapture)
+      );
+      match->captures = self->returned_inline_captures;
+    } else {
+      match->captures = captures;
+      capture_list_pool_release(&self->capture_list_pool, state->capture_list_id);
+    }
+    match->capture_count = capture_count;
+    array_erase(&self->finished_states, 0);
+    return true;
+  }
 }
 
 void ts_query_cursor_remove_match(
@@ -3783,6 +4621,7 @@ bool ts_query_cursor_next_capture(
     bool first_unfinished_state_is_definite = false;
     ts_query_cursor__first_in_progress_capture(
       self,
+      false,
       &first_unfinished_state_index,
       &first_unfinished_capture_byte,
       &first_unfinished_pattern_index,
@@ -3796,13 +4635,31 @@ bool ts_query_cursor_next_capture(
     uint32_t first_finished_pattern_index = first_unfinished_pattern_index;
     for (unsigned i = 0; i < self->finished_states.size;) {
       QueryState *state = &self->finished_states.contents[i];
-      const CaptureList *captures = capture_list_pool_get(
-        &self->capture_list_pool,
-        state->capture_list_id
+      uint32_t capture_count;
+      const TSQueryCapture *captures = ts_query_cursor__state_captures(
+        self,
+        state,
+        &capture_count
       );
 
       // Remove states whose captures are all consumed.
-      if (state->consumed_capture_count >= captures->size) {
+      if (state->consumed_capture_count >= capture_count) {
+        capture_list_pool_release(
+          &self->capture_list_pool,
+          state->capture_list_id
+        );
+        array_erase(&self->finished_states, i);
+        continue;
+      }
+
+      // When the document text has been provided, remove states that fail
+      // their pattern's compiled text predicates before consuming any of
+      // their captures.
+      if (
+        self->text &&
+        state->consumed_capture_count == 0 &&
+        !ts_query_cursor__satisfies_text_predicates(self, state)
+      ) {
         capture_list_pool_release(
           &self->capture_list_pool,
           state->capture_list_id
@@ -3812,7 +4669,7 @@ bool ts_query_cursor_next_capture(
       }
 
       // Skip captures that precede the cursor's start byte.
-      TSNode node = captures->contents[state->consumed_capture_count].node;
+      TSNode node = captures[state->consumed_capture_count].node;
       if (ts_node_end_byte(node) <= self->start_byte) {
         state->consumed_capture_count++;
         continue;
@@ -3846,21 +4703,72 @@ bool ts_query_cursor_next_capture(
     }
 
     if (state) {
+      uint32_t capture_count;
+      const TSQueryCapture *captures = ts_query_cursor__state_captures(
+        self,
+        state,
+        &capture_count
+      );
+
+      // When deduplication is enabled, consume - but don't return - any
+      // capture that refers to the same node and capture id as one that has
+      // already been returned. All captures of a given node share its start
+      // byte, so only the captures returned at the current start byte need
+      // to be remembered.
+      if (self->deduplicate_captures) {
+        TSQueryCapture capture = captures[state->consumed_capture_count];
+        uint32_t capture_byte = ts_node_start_byte(capture.node);
+        if (capture_byte != self->returned_capture_byte) {
+          array_clear(&self->returned_captures);
+          self->returned_capture_byte = capture_byte;
+        }
+        bool already_returned = false;
+        for (unsigned i = 0; i < self->returned_captures.size; i++) {
+          ReturnedCapture *returned = &self->returned_captures.contents[i];
+          if (
+            returned->node_id == capture.node.id &&
+            returned->capture_index == capture.index
+          ) {
+            already_returned = true;
+            break;
+          }
+        }
+        if (already_returned) {
+          state->consumed_capture_count++;
+          continue;
+        }
+        array_push(&self->returned_captures, ((ReturnedCapture) {
+          .node_id = capture.node.id,
+          .capture_index = capture.index,
+        }));
+      }
+
       if (state->id == UINT32_MAX) state->id = self->next_state_id++;
       match->id = state->id;
       match->pattern_index = state->pattern_index;
-      const CaptureList *captures = capture_list_pool_get(
-        &self->capture_list_pool,
-        state->capture_list_id
-      );
-      match->captures = captures->contents;
-      match->capture_count = captures->size;
+      if (state->capture_list_id == CAPTURE_LIST_NONE) {
+        // The captures live inside the state, which may be moved or erased
+        // as the cursor continues to advance, so copy them into the cursor's
+        // scratch space.
+        memcpy(
+          self->returned_inline_captures,
+          captures,
+          capture_count * sizeof(TSQueryCapture)
+        );
+        match->captures = self->returned_inline_captures;
+      } else {
+        match->captures = captures;
+      }
+      match->capture_count = capture_count;
       *capture_index = state->consumed_capture_count;
       state->consumed_capture_count++;
       return true;
     }
 
-    if (capture_list_pool_is_empty(&self->capture_list_pool)) {
+    if (
+      first_unfinished_state_index != UINT32_MAX &&
+      capture_list_pool_is_empty(&self->capture_list_pool)
+    ) {
       LOG(
         "  abandon state. index:%u, pattern:%u, offset:%u.\n",
         first_unfinished_state_index,
@@ -8,7 +8,7 @@
 #include <stdio.h>
 
 #define MAX_LINK_COUNT 8
-#define MAX_NODE_POOL_SIZE 50
+#define STACK_NODE_SLAB_SIZE 64
 #define MAX_ITERATOR_COUNT 64
 
 #if defined _WIN32 && !defined __GNUC__
@@ -45,6 +45,43 @@ typedef struct {
 
 typedef Array(StackNode *) StackNodeArray;
 
+// A slab allocator for stack nodes. Nodes are carved out of fixed-size
+// slabs owned by the pool and returned to a free list when released, so
+// creating and releasing nodes never touches malloc once a slab exists -
+// deep error recovery can churn through thousands of nodes without
+// allocator traffic. The slabs themselves are freed in bulk when the
+// stack is deleted.
+typedef struct {
+  StackNodeArray slabs;
+  StackNodeArray free_nodes;
+} StackNodePool;
+
+static void stack_node_pool_init(StackNodePool *self) {
+  array_init(&self->slabs);
+  array_init(&self->free_nodes);
+  array_reserve(&self->free_nodes, STACK_NODE_SLAB_SIZE);
+}
+
+static void stack_node_pool_delete(StackNodePool *self) {
+  for (uint32_t i = 0; i < self->slabs.size; i++) {
+    ts_free(self->slabs.contents[i]);
+  }
+  array_delete(&self->slabs);
+  array_delete(&self->free_nodes);
+}
+
+static StackNode *stack_node_pool_allocate(StackNodePool *self) {
+  if (self->free_nodes.size == 0) {
+    StackNode *slab = ts_malloc(STACK_NODE_SLAB_SIZE * sizeof(StackNode));
+    array_push(&self->slabs, slab);
+    array_reserve(&self->free_nodes, STACK_NODE_SLAB_SIZE);
+    for (uint32_t i = 0; i < STACK_NODE_SLAB_SIZE; i++) {
+      array_push(&self->free_nodes, &slab[i]);
+    }
+  }
+  return array_pop(&self->free_nodes);
+}
+
 typedef enum {
   StackStatusActive,
   StackStatusPaused,
@@ -64,7 +101,7 @@ struct Stack {
   Array(StackHead) heads;
   StackSliceArray slices;
   Array(StackIterator) iterators;
-  StackNodeArray node_pool;
+  StackNodePool node_pool;
   StackNode *base_node;
   SubtreePool *subtree_pool;
 };
@@ -88,7 +125,7 @@ static void stack_node_retain(StackNode *self) {
 
 static void stack_node_release(
   StackNode *self,
-  StackNodeArray *pool,
+  StackNodePool *pool,
   SubtreePool *subtree_pool
 ) {
 recur:
@@ -108,11 +145,7 @@ recur:
     first_predecessor = self->links[0].node;
   }
 
-  if (pool->size < MAX_NODE_POOL_SIZE) {
-    array_push(pool, self);
-  } else {
-    ts_free(self);
-  }
+  array_push(&pool->free_nodes, self);
 
   if (first_predecessor) {
     self = first_predecessor;
@@ -125,11 +158,9 @@ static StackNode *stack_node_new(
   Subtree subtree,
   bool is_pending,
   TSStateId state,
-  StackNodeArray *pool
+  StackNodePool *pool
 ) {
-  StackNode *node = pool->size > 0
-    ? array_pop(pool)
-    : ts_malloc(sizeof(StackNode));
+  StackNode *node = stack_node_pool_allocate(pool);
   *node = (StackNode) {
     .ref_count = 1,
     .link_count = 0,
@@ -249,7 +280,7 @@ static void stack_node_add_link(
 
 static void stack_head_delete(
   StackHead *self,
-  StackNodeArray *pool,
+  StackNodePool *pool,
   SubtreePool *subtree_pool
 ) {
   if (self->node) {
@@ -408,11 +439,10 @@ Stack *ts_stack_new(SubtreePool *subtree_pool) {
   array_init(&self->heads);
   array_init(&self->slices);
   array_init(&self->iterators);
-  array_init(&self->node_pool);
+  stack_node_pool_init(&self->node_pool);
   array_reserve(&self->heads, 4);
   array_reserve(&self->slices, 4);
   array_reserve(&self->iterators, 4);
-  array_reserve(&self->node_pool, MAX_NODE_POOL_SIZE);
 
   self->subtree_pool = subtree_pool;
   self->base_node = stack_node_new(NULL, NULL_SUBTREE, false, 1, &self->node_pool);
@@ -431,11 +461,7 @@ void ts_stack_delete(Stack *self) {
     stack_head_delete(&self->heads.contents[i], &self->node_pool, self->subtree_pool);
   }
   array_clear(&self->heads);
-  if (self->node_pool.contents) {
-    for (uint32_t i = 0; i < self->node_pool.size; i++)
-      ts_free(self->node_pool.contents[i]);
-    array_delete(&self->node_pool);
-  }
+  stack_node_pool_delete(&self->node_pool);
   array_delete(&self->heads);
   ts_free(self);
 }
@@ -444,6 +470,14 @@ uint32_t ts_stack_version_count(const Stack *self) {
   return self->heads.size;
 }
 
+size_t ts_stack_memory_used(const Stack *self) {
+  return
+    (size_t)self->node_pool.slabs.size * STACK_NODE_SLAB_SIZE * sizeof(StackNode) +
+    self->heads.capacity * sizeof(StackHead) +
+    self->slices.capacity * sizeof(StackSlice) +
+    self->iterators.capacity * sizeof(StackIterator);
+}
+
 TSStateId ts_stack_state(const Stack *self, StackVersion version) {
   return array_get(&self->heads, version)->node->state;
 }
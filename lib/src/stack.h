@@ -37,6 +37,10 @@ void ts_stack_delete(Stack *);
 // Get the stack's current number of versions.
 uint32_t ts_stack_version_count(const Stack *);
 
+// Get the approximate number of bytes of memory that the stack currently
+// has allocated, including recycled node slabs.
+size_t ts_stack_memory_used(const Stack *);
+
 // Get the state at the top of the given version of the stack. If the stack is
 // empty, this returns the initial state, 0.
 TSStateId ts_stack_state(const Stack *, StackVersion);
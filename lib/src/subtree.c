@@ -20,13 +20,27 @@ typedef struct {
 
 #define TS_MAX_INLINE_TREE_LENGTH UINT8_MAX
 #define TS_MAX_TREE_POOL_SIZE 32
+#define TS_MAX_NODE_BLOCK_POOL_SIZE 32
 
 // ExternalScannerState
 
+// Long external scanner states are immutable once created, so they are
+// stored in shared, reference-counted heap blocks: copying a state shares
+// the block instead of duplicating the bytes. This matters for scanners
+// with large states (indentation stacks, heredoc tags), whose tokens are
+// cloned on every stack-version split and whose states rarely change from
+// one token to the next. The reference count prefixes the state's bytes;
+// it is managed atomically because subtree clones may happen on any thread.
+typedef struct {
+  volatile uint32_t ref_count;
+} ExternalScannerStateHeader;
+
 void ts_external_scanner_state_init(ExternalScannerState *self, const char *data, unsigned length) {
   self->length = length;
   if (length > sizeof(self->short_data)) {
-    self->long_data = ts_malloc(length);
+    ExternalScannerStateHeader *header = ts_malloc(sizeof(*header) + length);
+    header->ref_count = 1;
+    self->long_data = (char *)(header + 1);
     memcpy(self->long_data, data, length);
   } else {
     memcpy(self->short_data, data, length);
@@ -36,15 +50,18 @@ void ts_external_scanner_state_init(ExternalScannerState *self, const char *data
 ExternalScannerState ts_external_scanner_state_copy(const ExternalScannerState *self) {
   ExternalScannerState result = *self;
   if (self->length > sizeof(self->short_data)) {
-    result.long_data = ts_malloc(self->length);
-    memcpy(result.long_data, self->long_data, self->length);
+    ExternalScannerStateHeader *header = (ExternalScannerStateHeader *)self->long_data - 1;
+    atomic_inc(&header->ref_count);
   }
   return result;
 }
 
 void ts_external_scanner_state_delete(ExternalScannerState *self) {
   if (self->length > sizeof(self->short_data)) {
-    ts_free(self->long_data);
+    ExternalScannerStateHeader *header = (ExternalScannerStateHeader *)self->long_data - 1;
+    if (atomic_dec(&header->ref_count) == 0) {
+      ts_free(header);
+    }
   }
 }
 
@@ -118,11 +135,22 @@ void ts_subtree_array_reverse(SubtreeArray *self) {
 // SubtreePool
 
 SubtreePool ts_subtree_pool_new(uint32_t capacity) {
-  SubtreePool self = {array_new(), array_new()};
+  SubtreePool self = {array_new(), array_new(), array_new(), 0};
   array_reserve(&self.free_trees, capacity);
   return self;
 }
 
+// Forget some bytes of pool-owned storage. The counter is approximate -
+// child arrays can enter the pool after being grown outside of it - so
+// clamp rather than underflow.
+static inline void ts_subtree_pool_forget_bytes(SubtreePool *self, size_t bytes) {
+  self->allocated_bytes -= bytes < self->allocated_bytes ? bytes : self->allocated_bytes;
+}
+
+size_t ts_subtree_pool_memory_used(const SubtreePool *self) {
+  return self->allocated_bytes;
+}
+
 void ts_subtree_pool_delete(SubtreePool *self) {
   if (self->free_trees.contents) {
     for (unsigned i = 0; i < self->free_trees.size; i++) {
@@ -130,10 +158,17 @@ void ts_subtree_pool_delete(SubtreePool *self) {
     }
     array_delete(&self->free_trees);
   }
+  if (self->free_node_blocks.contents) {
+    for (unsigned i = 0; i < self->free_node_blocks.size; i++) {
+      ts_free(self->free_node_blocks.contents[i].contents);
+    }
+    array_delete(&self->free_node_blocks);
+  }
   if (self->tree_stack.contents) array_delete(&self->tree_stack);
 }
 
 static SubtreeHeapData *ts_subtree_pool_allocate(SubtreePool *self) {
+  self->allocated_bytes += sizeof(SubtreeHeapData);
   if (self->free_trees.size > 0) {
     return array_pop(&self->free_trees).ptr;
   } else {
@@ -142,6 +177,7 @@ static SubtreeHeapData *ts_subtree_pool_allocate(SubtreePool *self) {
 }
 
 static void ts_subtree_pool_free(SubtreePool *self, SubtreeHeapData *tree) {
+  ts_subtree_pool_forget_bytes(self, sizeof(SubtreeHeapData));
   if (self->free_trees.capacity > 0 && self->free_trees.size + 1 <= TS_MAX_TREE_POOL_SIZE) {
     array_push(&self->free_trees, (MutableSubtree) {.ptr = tree});
   } else {
@@ -149,6 +185,44 @@ static void ts_subtree_pool_free(SubtreePool *self, SubtreeHeapData *tree) {
   }
 }
 
+// Take a recycled node block that can hold at least `byte_size` bytes,
+// returning NULL if the pool has no block that large. The block's
+// actual size is stored in `*block_byte_size`.
+static Subtree *ts_subtree_pool_allocate_node_block(
+  SubtreePool *self,
+  size_t byte_size,
+  uint32_t *block_byte_size
+) {
+  for (unsigned i = 0; i < self->free_node_blocks.size; i++) {
+    PooledNodeBlock block = self->free_node_blocks.contents[i];
+    if (block.byte_size >= byte_size) {
+      array_erase(&self->free_node_blocks, i);
+      *block_byte_size = block.byte_size;
+      return block.contents;
+    }
+  }
+  return NULL;
+}
+
+static void ts_subtree_pool_free_node_block(
+  SubtreePool *self,
+  Subtree *contents,
+  size_t byte_size
+) {
+  ts_subtree_pool_forget_bytes(self, byte_size);
+  if (
+    byte_size <= UINT32_MAX &&
+    self->free_node_blocks.size < TS_MAX_NODE_BLOCK_POOL_SIZE
+  ) {
+    array_push(&self->free_node_blocks, ((PooledNodeBlock) {
+      .contents = contents,
+      .byte_size = byte_size,
+    }));
+  } else {
+    ts_free(contents);
+  }
+}
+
 // Subtree
 
 static inline bool ts_subtree_can_inline(Length padding, Length size, uint32_t lookahead_bytes) {
@@ -278,10 +352,17 @@ MutableSubtree ts_subtree_clone(Subtree self) {
 //
 // This takes ownership of the subtree. If the subtree has only one owner,
 // this will directly convert it into a mutable version. Otherwise, it will
-// perform a copy.
+// perform a copy, leaving the shared version untouched. This is what makes
+// editing a tree copy-on-write: nodes that are also reachable from another
+// tree always have a reference count greater than one by the time they are
+// visited, because uniquifying a shared node retains its children, so only
+// the spine of nodes that an edit actually touches ever gets cloned. The
+// reference count is loaded atomically so that another thread may release
+// a snapshot of the tree while this one is being edited: a stale count can
+// only over-estimate the number of owners and cause a harmless extra clone.
 MutableSubtree ts_subtree_make_mut(SubtreePool *pool, Subtree self) {
   if (self.data.is_inline) return (MutableSubtree) {self.data};
-  if (self.ptr->ref_count == 1) return ts_subtree_to_mut_unsafe(self);
+  if (atomic_load_u32(&self.ptr->ref_count) == 1) return ts_subtree_to_mut_unsafe(self);
   MutableSubtree result = ts_subtree_clone(self);
   ts_subtree_release(pool, self);
   return result;
@@ -501,6 +582,7 @@ void ts_subtree_summarize_children(
 //
 // This takes ownership of the children array.
 MutableSubtree ts_subtree_new_node(
+  SubtreePool *pool,
   TSSymbol symbol,
   SubtreeArray *children,
   unsigned production_id,
@@ -509,12 +591,27 @@ MutableSubtree ts_subtree_new_node(
   TSSymbolMetadata metadata = ts_language_symbol_metadata(language, symbol);
   bool fragile = symbol == ts_builtin_sym_error || symbol == ts_builtin_sym_error_repeat;
 
-  // Allocate the node's data at the end of the array of children.
+  // Allocate the node's data at the end of the array of children,
+  // preferring a recycled block from the pool over a fresh allocation.
   size_t new_byte_size = ts_subtree_alloc_size(children->size);
   if (children->capacity * sizeof(Subtree) < new_byte_size) {
-    children->contents = ts_realloc(children->contents, new_byte_size);
-    children->capacity = new_byte_size / sizeof(Subtree);
+    uint32_t block_byte_size;
+    Subtree *block = ts_subtree_pool_allocate_node_block(pool, new_byte_size, &block_byte_size);
+    if (block) {
+      memcpy(block, children->contents, children->size * sizeof(Subtree));
+      if (children->contents) {
+        ts_subtree_pool_free_node_block(
+          pool, children->contents, children->capacity * sizeof(Subtree)
+        );
+      }
+      children->contents = block;
+      children->capacity = block_byte_size / sizeof(Subtree);
+    } else {
+      children->contents = ts_realloc(children->contents, new_byte_size);
+      children->capacity = new_byte_size / sizeof(Subtree);
+    }
   }
+  pool->allocated_bytes += new_byte_size;
   SubtreeHeapData *data = (SubtreeHeapData *)&children->contents[children->size];
 
   *data = (SubtreeHeapData) {
@@ -544,12 +641,13 @@ MutableSubtree ts_subtree_new_node(
 // This node is treated as 'extra'. Its children are prevented from having
 // having any effect on the parse state.
 Subtree ts_subtree_new_error_node(
+  SubtreePool *pool,
   SubtreeArray *children,
   bool extra,
   const TSLanguage *language
 ) {
   MutableSubtree result = ts_subtree_new_node(
-    ts_builtin_sym_error, children, 0, language
+    pool, ts_builtin_sym_error, children, 0, language
   );
   result.ptr->extra = extra;
   return ts_subtree_from_mut(result);
@@ -606,7 +704,9 @@ void ts_subtree_release(SubtreePool *pool, Subtree self) {
           array_push(&pool->tree_stack, ts_subtree_to_mut_unsafe(child));
         }
       }
-      ts_free(children);
+      ts_subtree_pool_free_node_block(
+        pool, children, ts_subtree_alloc_size(tree.ptr->child_count)
+      );
     } else {
       if (tree.ptr->has_external_tokens) {
         ts_external_scanner_state_delete(&tree.ptr->external_scanner_state);
@@ -641,6 +741,19 @@ static inline void ts_subtree_set_has_changes(MutableSubtree *self) {
   }
 }
 
+// Mark a subtree whose own text - not just its position - was altered by an
+// edit. Pure shifts, where an edit falls entirely within the space before a
+// subtree, set `has_changes` but leave this flag alone; `ts_tree_diff` uses
+// the distinction to avoid reporting shifted-but-identical tokens as
+// updates.
+static inline void ts_subtree_set_content_changed(MutableSubtree *self) {
+  if (self->data.is_inline) {
+    self->data.content_changed = true;
+  } else {
+    self->ptr->content_changed = true;
+  }
+}
+
 Subtree ts_subtree_edit(Subtree self, const TSInputEdit *edit, SubtreePool *pool) {
   typedef struct {
     Subtree *tree;
@@ -671,6 +784,8 @@ Subtree ts_subtree_edit(Subtree self, const TSInputEdit *edit, SubtreePool *pool
     uint32_t end_byte = total_size.bytes + lookahead_bytes;
     if (edit.start.bytes > end_byte || (is_noop && edit.start.bytes == end_byte)) continue;
 
+    bool content_changed = false;
+
     // If the edit is entirely within the space before this subtree, then shift this
     // subtree over according to the edit without changing its size.
     if (edit.old_end.bytes <= padding.bytes) {
@@ -682,6 +797,7 @@ Subtree ts_subtree_edit(Subtree self, const TSInputEdit *edit, SubtreePool *pool
     else if (edit.start.bytes < padding.bytes) {
       size = length_saturating_sub(size, length_sub(edit.old_end, padding));
       padding = edit.new_end;
+      content_changed = true;
     }
 
     // If the edit is a pure insertion right at the start of the subtree,
@@ -699,6 +815,9 @@ Subtree ts_subtree_edit(Subtree self, const TSInputEdit *edit, SubtreePool *pool
         length_sub(edit.new_end, padding),
         length_saturating_sub(total_size, edit.old_end)
       );
+      // A no-op edit, produced when an edit is clamped while propagating to
+      // a child it does not overlap, alters nothing.
+      if (!is_noop) content_changed = true;
     }
 
     MutableSubtree result = ts_subtree_make_mut(pool, *entry.tree);
@@ -725,6 +844,7 @@ Subtree ts_subtree_edit(Subtree self, const TSInputEdit *edit, SubtreePool *pool
         data->fragile_left = false;
         data->fragile_right = false;
         data->has_changes = false;
+        data->content_changed = result.data.content_changed;
         data->has_external_tokens = false;
         data->depends_on_column = false;
         data->is_missing = result.data.is_missing;
@@ -737,6 +857,7 @@ Subtree ts_subtree_edit(Subtree self, const TSInputEdit *edit, SubtreePool *pool
     }
 
     ts_subtree_set_has_changes(&result);
+    if (content_changed) ts_subtree_set_content_changed(&result);
     *entry.tree = ts_subtree_from_mut(result);
 
     Length child_left, child_right = length_zero();
@@ -797,6 +918,213 @@ Subtree ts_subtree_edit(Subtree self, const TSInputEdit *edit, SubtreePool *pool
   return self;
 }
 
+// Apply a batch of edits, sorted by start byte in *descending* order, in a
+// single pass over the tree. This produces the same tree as calling
+// `ts_subtree_edit` once per edit in that order, but each affected node is
+// copied, resized, and marked as changed only once, instead of once per
+// edit whose root-to-leaf path passes through it.
+Subtree ts_subtree_edit_batch(
+  Subtree self,
+  const TSInputEdit *edits,
+  uint32_t edit_count,
+  SubtreePool *pool
+) {
+  typedef struct {
+    Subtree *tree;
+    Edit *edits;
+    uint32_t edit_count;
+  } StackEntry;
+
+  typedef struct {
+    uint32_t child_index;
+    Edit edit;
+  } ChildEdit;
+
+  Edit *root_edits = ts_malloc(edit_count * sizeof(Edit));
+  for (uint32_t i = 0; i < edit_count; i++) {
+    const TSInputEdit *edit = &edits[i];
+    root_edits[i] = (Edit) {
+      .start = {edit->start_byte, edit->start_point},
+      .old_end = {edit->old_end_byte, edit->old_end_point},
+      .new_end = {edit->new_end_byte, edit->new_end_point},
+    };
+  }
+
+  Array(StackEntry) stack = array_new();
+  Array(ChildEdit) child_edits = array_new();
+  array_push(&stack, ((StackEntry) {
+    .tree = &self,
+    .edits = root_edits,
+    .edit_count = edit_count,
+  }));
+
+  while (stack.size) {
+    StackEntry entry = array_pop(&stack);
+    bool invalidate_first_row = ts_subtree_depends_on_column(*entry.tree);
+    uint32_t lookahead_bytes = ts_subtree_lookahead_bytes(*entry.tree);
+    Length size = ts_subtree_size(*entry.tree);
+    Length padding = ts_subtree_padding(*entry.tree);
+    bool did_change = false;
+    bool content_changed = false;
+    array_clear(&child_edits);
+
+    // Apply each edit to this node in turn, accumulating the padding and
+    // size adjustments, and record which edits must be propagated to which
+    // children. Because the edits are ordered from the end of the document
+    // backward, an edit never changes the coordinates of a later one.
+    for (uint32_t e = 0; e < entry.edit_count; e++) {
+      Edit edit = entry.edits[e];
+      bool is_noop = edit.old_end.bytes == edit.start.bytes && edit.new_end.bytes == edit.start.bytes;
+      bool is_pure_insertion = edit.old_end.bytes == edit.start.bytes;
+
+      Length total_size = length_add(padding, size);
+      uint32_t end_byte = total_size.bytes + lookahead_bytes;
+      if (edit.start.bytes > end_byte || (is_noop && edit.start.bytes == end_byte)) continue;
+      did_change = true;
+
+      // The same case analysis as in `ts_subtree_edit`.
+      if (edit.old_end.bytes <= padding.bytes) {
+        padding = length_add(edit.new_end, length_sub(padding, edit.old_end));
+      } else if (edit.start.bytes < padding.bytes) {
+        size = length_saturating_sub(size, length_sub(edit.old_end, padding));
+        padding = edit.new_end;
+        content_changed = true;
+      } else if (edit.start.bytes == padding.bytes && is_pure_insertion) {
+        padding = edit.new_end;
+      } else if (
+        edit.start.bytes < total_size.bytes ||
+        (edit.start.bytes == total_size.bytes && is_pure_insertion)
+      ) {
+        size = length_add(
+          length_sub(edit.new_end, padding),
+          length_saturating_sub(total_size, edit.old_end)
+        );
+        if (!is_noop) content_changed = true;
+      }
+
+      Length child_left, child_right = length_zero();
+      for (uint32_t i = 0, n = ts_subtree_child_count(*entry.tree); i < n; i++) {
+        const Subtree *child = &ts_subtree_children(*entry.tree)[i];
+        Length child_size = ts_subtree_total_size(*child);
+        child_left = child_right;
+        child_right = length_add(child_left, child_size);
+
+        if (child_right.bytes + ts_subtree_lookahead_bytes(*child) < edit.start.bytes) continue;
+
+        if ((
+          (child_left.bytes > edit.old_end.bytes) ||
+          (child_left.bytes == edit.old_end.bytes && child_size.bytes > 0 && i > 0)
+        ) && (
+          !invalidate_first_row ||
+          child_left.extent.row > padding.extent.row
+        )) {
+          break;
+        }
+
+        Edit child_edit = {
+          .start = length_saturating_sub(edit.start, child_left),
+          .old_end = length_saturating_sub(edit.old_end, child_left),
+          .new_end = length_saturating_sub(edit.new_end, child_left),
+        };
+
+        if (
+          child_right.bytes > edit.start.bytes ||
+          (child_right.bytes == edit.start.bytes && is_pure_insertion)
+        ) {
+          edit.new_end = edit.start;
+        } else {
+          child_edit.old_end = child_edit.start;
+          child_edit.new_end = child_edit.start;
+        }
+
+        array_push(&child_edits, ((ChildEdit) {
+          .child_index = i,
+          .edit = child_edit,
+        }));
+      }
+    }
+
+    if (did_change) {
+      MutableSubtree result = ts_subtree_make_mut(pool, *entry.tree);
+
+      if (result.data.is_inline) {
+        if (ts_subtree_can_inline(padding, size, lookahead_bytes)) {
+          result.data.padding_bytes = padding.bytes;
+          result.data.padding_rows = padding.extent.row;
+          result.data.padding_columns = padding.extent.column;
+          result.data.size_bytes = size.bytes;
+        } else {
+          SubtreeHeapData *data = ts_subtree_pool_allocate(pool);
+          data->ref_count = 1;
+          data->padding = padding;
+          data->size = size;
+          data->lookahead_bytes = lookahead_bytes;
+          data->error_cost = 0;
+          data->child_count = 0;
+          data->symbol = result.data.symbol;
+          data->parse_state = result.data.parse_state;
+          data->visible = result.data.visible;
+          data->named = result.data.named;
+          data->extra = result.data.extra;
+          data->fragile_left = false;
+          data->fragile_right = false;
+          data->has_changes = false;
+          data->content_changed = result.data.content_changed;
+          data->has_external_tokens = false;
+          data->depends_on_column = false;
+          data->is_missing = result.data.is_missing;
+          data->is_keyword = result.data.is_keyword;
+          result.ptr = data;
+        }
+      } else {
+        result.ptr->padding = padding;
+        result.ptr->size = size;
+      }
+
+      ts_subtree_set_has_changes(&result);
+      if (content_changed) ts_subtree_set_content_changed(&result);
+      *entry.tree = ts_subtree_from_mut(result);
+
+      // Group the collected child edits by child, preserving the order in
+      // which they were applied, and queue one stack entry per child.
+      for (uint32_t i = 0; i < child_edits.size; i++) {
+        uint32_t child_index = child_edits.contents[i].child_index;
+        bool seen = false;
+        for (uint32_t j = 0; j < i; j++) {
+          if (child_edits.contents[j].child_index == child_index) {
+            seen = true;
+            break;
+          }
+        }
+        if (seen) continue;
+
+        uint32_t count = 0;
+        for (uint32_t j = i; j < child_edits.size; j++) {
+          if (child_edits.contents[j].child_index == child_index) count++;
+        }
+        Edit *list = ts_malloc(count * sizeof(Edit));
+        uint32_t k = 0;
+        for (uint32_t j = i; j < child_edits.size; j++) {
+          if (child_edits.contents[j].child_index == child_index) {
+            list[k++] = child_edits.contents[j].edit;
+          }
+        }
+        array_push(&stack, ((StackEntry) {
+          .tree = &ts_subtree_children(*entry.tree)[child_index],
+          .edits = list,
+          .edit_count = count,
+        }));
+      }
+    }
+
+    ts_free(entry.edits);
+  }
+
+  array_delete(&child_edits);
+  array_delete(&stack);
+  return self;
+}
+
 Subtree ts_subtree_last_external_token(Subtree tree) {
   if (!ts_subtree_has_external_tokens(tree)) return NULL_SUBTREE;
   while (tree.ptr->child_count > 0) {
@@ -71,7 +71,7 @@ struct SubtreeInlineData {
   uint16_t parse_state;
   uint8_t symbol;
   SUBTREE_BITS
-  bool unused : 1;
+  bool content_changed : 1;
   bool is_inline : 1;
   SUBTREE_SIZE
 };
@@ -83,7 +83,7 @@ struct SubtreeInlineData {
   uint16_t parse_state;
   uint8_t symbol;
   SUBTREE_BITS
-  bool unused : 1;
+  bool content_changed : 1;
   bool is_inline : 1;
 };
 
@@ -93,6 +93,7 @@ struct SubtreeInlineData {
 struct SubtreeInlineData {
   bool is_inline : 1;
   SUBTREE_BITS
+  bool content_changed : 1;
   uint8_t symbol;
   uint16_t parse_state;
   SUBTREE_SIZE
@@ -124,6 +125,7 @@ typedef struct {
   bool fragile_left : 1;
   bool fragile_right : 1;
   bool has_changes : 1;
+  bool content_changed : 1;
   bool has_external_tokens : 1;
   bool has_external_scanner_state_change : 1;
   bool depends_on_column: 1;
@@ -168,12 +170,31 @@ typedef union {
 typedef Array(Subtree) SubtreeArray;
 typedef Array(MutableSubtree) MutableSubtreeArray;
 
+// A recycled allocation that previously held a parent node together
+// with its children.
+//
+// Parent nodes are laid out in one heap block: an array of children
+// followed by the node's own `SubtreeHeapData`. The blocks vary in
+// size, so recycled blocks record their sizes and are reused for any
+// node whose layout fits.
+typedef struct {
+  Subtree *contents;
+  uint32_t byte_size;
+} PooledNodeBlock;
+
 typedef struct {
   MutableSubtreeArray free_trees;
+  Array(PooledNodeBlock) free_node_blocks;
   MutableSubtreeArray tree_stack;
+
+  // Approximate number of bytes of storage held by live subtrees created
+  // through this pool. The parser zeroes this at the start of a parse, so
+  // for a parser's pool it measures the tree under construction.
+  size_t allocated_bytes;
 } SubtreePool;
 
 void ts_external_scanner_state_init(ExternalScannerState *, const char *, unsigned);
+ExternalScannerState ts_external_scanner_state_copy(const ExternalScannerState *);
 const char *ts_external_scanner_state_data(const ExternalScannerState *);
 bool ts_external_scanner_state_eq(const ExternalScannerState *a, const char *, unsigned);
 void ts_external_scanner_state_delete(ExternalScannerState *self);
@@ -186,6 +207,7 @@ void ts_subtree_array_reverse(SubtreeArray *);
 
 SubtreePool ts_subtree_pool_new(uint32_t capacity);
 void ts_subtree_pool_delete(SubtreePool *);
+size_t ts_subtree_pool_memory_used(const SubtreePool *);
 
 Subtree ts_subtree_new_leaf(
   SubtreePool *, TSSymbol, Length, Length, uint32_t,
@@ -194,8 +216,8 @@ Subtree ts_subtree_new_leaf(
 Subtree ts_subtree_new_error(
   SubtreePool *, int32_t, Length, Length, uint32_t, TSStateId, const TSLanguage *
 );
-MutableSubtree ts_subtree_new_node(TSSymbol, SubtreeArray *, unsigned, const TSLanguage *);
-Subtree ts_subtree_new_error_node(SubtreeArray *, bool, const TSLanguage *);
+MutableSubtree ts_subtree_new_node(SubtreePool *, TSSymbol, SubtreeArray *, unsigned, const TSLanguage *);
+Subtree ts_subtree_new_error_node(SubtreePool *, SubtreeArray *, bool, const TSLanguage *);
 Subtree ts_subtree_new_missing_leaf(SubtreePool *, TSSymbol, Length, uint32_t, const TSLanguage *);
 MutableSubtree ts_subtree_make_mut(SubtreePool *, Subtree);
 void ts_subtree_retain(Subtree);
@@ -206,6 +228,7 @@ void ts_subtree_summarize(MutableSubtree, const Subtree *, uint32_t, const TSLan
 void ts_subtree_summarize_children(MutableSubtree, const TSLanguage *);
 void ts_subtree_balance(Subtree, SubtreePool *, const TSLanguage *);
 Subtree ts_subtree_edit(Subtree, const TSInputEdit *edit, SubtreePool *);
+Subtree ts_subtree_edit_batch(Subtree, const TSInputEdit *edits, uint32_t, SubtreePool *);
 char *ts_subtree_string(Subtree, const TSLanguage *, bool include_all);
 void ts_subtree_print_dot_graph(Subtree, const TSLanguage *, FILE *);
 Subtree ts_subtree_last_external_token(Subtree);
@@ -219,6 +242,7 @@ static inline bool ts_subtree_visible(Subtree self) { return SUBTREE_GET(self, v
 static inline bool ts_subtree_named(Subtree self) { return SUBTREE_GET(self, named); }
 static inline bool ts_subtree_extra(Subtree self) { return SUBTREE_GET(self, extra); }
 static inline bool ts_subtree_has_changes(Subtree self) { return SUBTREE_GET(self, has_changes); }
+static inline bool ts_subtree_content_changed(Subtree self) { return SUBTREE_GET(self, content_changed); }
 static inline bool ts_subtree_missing(Subtree self) { return SUBTREE_GET(self, is_missing); }
 static inline bool ts_subtree_is_keyword(Subtree self) { return SUBTREE_GET(self, is_keyword); }
 static inline TSStateId ts_subtree_parse_state(Subtree self) { return SUBTREE_GET(self, parse_state); }
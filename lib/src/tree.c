@@ -16,12 +16,25 @@ TSTree *ts_tree_new(
   result->included_ranges = ts_calloc(included_range_count, sizeof(TSRange));
   memcpy(result->included_ranges, included_ranges, included_range_count * sizeof(TSRange));
   result->included_range_count = included_range_count;
+  result->descendant_index = NULL;
+  result->descendant_index_size = 0;
+  result->line_starts = NULL;
+  result->line_start_count = 0;
   return result;
 }
 
+static void ts_tree__copy_line_index(TSTree *dest, const TSTree *src) {
+  if (!src->line_starts) return;
+  dest->line_starts = ts_malloc(src->line_start_count * sizeof(uint32_t));
+  memcpy(dest->line_starts, src->line_starts, src->line_start_count * sizeof(uint32_t));
+  dest->line_start_count = src->line_start_count;
+}
+
 TSTree *ts_tree_copy(const TSTree *self) {
   ts_subtree_retain(self->root);
-  return ts_tree_new(self->root, self->language, self->included_ranges, self->included_range_count);
+  TSTree *result = ts_tree_new(self->root, self->language, self->included_ranges, self->included_range_count);
+  ts_tree__copy_line_index(result, self);
+  return result;
 }
 
 void ts_tree_delete(TSTree *self) {
@@ -31,6 +44,8 @@ void ts_tree_delete(TSTree *self) {
   ts_subtree_release(&pool, self->root);
   ts_subtree_pool_delete(&pool);
   ts_free(self->included_ranges);
+  ts_free(self->descendant_index);
+  ts_free(self->line_starts);
   ts_free(self);
 }
 
@@ -51,7 +66,213 @@ const TSLanguage *ts_tree_language(const TSTree *self) {
   return self->language;
 }
 
-void ts_tree_edit(TSTree *self, const TSInputEdit *edit) {
+// The number of entries that the descendant index is allowed to grow to.
+// Expansion stops once a whole level of the index would exceed this limit.
+#define TREE_DESCENDANT_INDEX_MAX_SIZE 512
+
+void ts_tree_build_descendant_index(TSTree *self) {
+  if (self->descendant_index) return;
+
+  // Build a frontier of disjoint named nodes, in traversal order, by
+  // repeatedly replacing each node with its named children. Anonymous
+  // nodes are not indexed; lookups that land in the gaps they leave fall
+  // back to a full descent from the root.
+  typedef Array(TSNode) NodeArray;
+  NodeArray frontier = array_new();
+  array_push(&frontier, ts_tree_root_node(self));
+  TSTreeCursor cursor = ts_tree_cursor_new(ts_tree_root_node(self));
+  bool did_expand = true;
+  while (did_expand && frontier.size < TREE_DESCENDANT_INDEX_MAX_SIZE) {
+    did_expand = false;
+    NodeArray next_frontier = array_new();
+    for (uint32_t i = 0; i < frontier.size; i++) {
+      TSNode node = frontier.contents[i];
+      if (
+        ts_node_named_child_count(node) > 0 &&
+        next_frontier.size < TREE_DESCENDANT_INDEX_MAX_SIZE
+      ) {
+        ts_tree_cursor_reset(&cursor, node);
+        if (ts_tree_cursor_goto_first_child(&cursor)) {
+          did_expand = true;
+          do {
+            TSNode child = ts_tree_cursor_current_node(&cursor);
+            if (ts_node_is_named(child)) array_push(&next_frontier, child);
+          } while (ts_tree_cursor_goto_next_sibling(&cursor));
+        }
+      } else {
+        array_push(&next_frontier, node);
+      }
+    }
+    array_delete(&frontier);
+    frontier = next_frontier;
+  }
+  ts_tree_cursor_delete(&cursor);
+
+  self->descendant_index = frontier.contents;
+  self->descendant_index_size = frontier.size;
+}
+
+// Copy a subtree, collapsing nodes more than `depth` visible levels deep
+// into opaque leaves that keep their symbol and extent but none of their
+// children. Levels occupied by invisible nodes (including the balanced
+// auxiliary repetition nodes, whose chains are logarithmic in length) do
+// not count toward the depth, so the recursion is bounded.
+static Subtree ts_tree__depth_limited_copy(
+  Subtree self,
+  uint32_t depth,
+  SubtreePool *pool,
+  const TSLanguage *language
+) {
+  uint32_t child_count = ts_subtree_child_count(self);
+  if (child_count == 0) {
+    ts_subtree_retain(self);
+    return self;
+  }
+
+  if (depth == 0) {
+    return ts_subtree_new_leaf(
+      pool,
+      ts_subtree_symbol(self),
+      ts_subtree_padding(self),
+      ts_subtree_size(self),
+      ts_subtree_lookahead_bytes(self),
+      ts_subtree_parse_state(self),
+      false,
+      false,
+      false,
+      language
+    );
+  }
+
+  SubtreeArray children = array_new();
+  array_reserve(&children, child_count);
+  for (uint32_t i = 0; i < child_count; i++) {
+    Subtree child = ts_subtree_children(self)[i];
+    uint32_t child_depth = ts_subtree_visible(child) ? depth - 1 : depth;
+    array_push(&children, ts_tree__depth_limited_copy(child, child_depth, pool, language));
+  }
+  return ts_subtree_from_mut(ts_subtree_new_node(
+    pool,
+    ts_subtree_symbol(self),
+    &children,
+    ts_subtree_production_id(self),
+    language
+  ));
+}
+
+TSTree *ts_tree_with_depth_limit(const TSTree *self, uint32_t max_depth) {
+  SubtreePool pool = ts_subtree_pool_new(0);
+  Subtree root = ts_tree__depth_limited_copy(self->root, max_depth, &pool, self->language);
+  ts_subtree_pool_delete(&pool);
+  TSTree *result = ts_tree_new(root, self->language, self->included_ranges, self->included_range_count);
+  ts_tree__copy_line_index(result, self);
+  return result;
+}
+
+// Assemble the tree's line-offset index: one byte offset per row, taken from
+// the line starts that the lexer observed while parsing. Rows in regions
+// that were not re-lexed - reused portions of an incrementally parsed
+// document - are inherited from the old tree's index, which `ts_tree_edit`
+// has already renumbered and shifted to the new document's coordinates.
+void ts_tree_build_line_index(
+  TSTree *self,
+  const TSTree *old_tree,
+  const Length *observations,
+  uint32_t observation_count
+) {
+  uint32_t line_count = ts_subtree_total_size(self->root).extent.row + 1;
+  ts_free(self->line_starts);
+  self->line_starts = ts_malloc(line_count * sizeof(uint32_t));
+  self->line_start_count = line_count;
+  self->line_starts[0] = 0;
+  for (uint32_t i = 1; i < line_count; i++) self->line_starts[i] = UINT32_MAX;
+
+  if (old_tree && old_tree->line_starts && old_tree->line_start_count > 1) {
+    uint32_t n = old_tree->line_start_count;
+    if (n > line_count) n = line_count;
+    memcpy(
+      self->line_starts + 1,
+      old_tree->line_starts + 1,
+      (n - 1) * sizeof(uint32_t)
+    );
+  }
+
+  for (uint32_t i = 0; i < observation_count; i++) {
+    uint32_t row = observations[i].extent.row;
+    if (row > 0 && row < line_count) {
+      self->line_starts[row] = observations[i].bytes;
+    }
+  }
+}
+
+// Keep the line-offset index in sync with an edit: rows that start before
+// the edit keep their offsets, rows the edit introduces or alters become
+// unknown until the edited region is next re-lexed, and rows after the edit
+// are renumbered and shifted by the edit's net size change.
+static void ts_tree__edit_line_index(TSTree *self, const TSInputEdit *edit) {
+  if (!self->line_starts) return;
+  uint32_t start_row = edit->start_point.row;
+  uint32_t old_end_row = edit->old_end_point.row;
+  uint32_t new_end_row = edit->new_end_point.row;
+  uint32_t old_count = self->line_start_count;
+
+  uint32_t tail_count = old_count > old_end_row + 1 ? old_count - (old_end_row + 1) : 0;
+  uint32_t new_count = new_end_row + 1 + tail_count;
+  uint32_t *new_starts = ts_malloc(new_count * sizeof(uint32_t));
+
+  uint32_t head_count = start_row + 1;
+  if (head_count > old_count) head_count = old_count;
+  memcpy(new_starts, self->line_starts, head_count * sizeof(uint32_t));
+  for (uint32_t row = head_count; row <= new_end_row; row++) {
+    new_starts[row] = UINT32_MAX;
+  }
+
+  int64_t byte_delta = (int64_t)edit->new_end_byte - (int64_t)edit->old_end_byte;
+  for (uint32_t i = 0; i < tail_count; i++) {
+    uint32_t old_offset = self->line_starts[old_end_row + 1 + i];
+    new_starts[new_end_row + 1 + i] =
+      old_offset == UINT32_MAX ? UINT32_MAX : (uint32_t)((int64_t)old_offset + byte_delta);
+  }
+
+  ts_free(self->line_starts);
+  self->line_starts = new_starts;
+  self->line_start_count = new_count;
+}
+
+bool ts_tree_point_for_byte(const TSTree *self, uint32_t byte, TSPoint *result) {
+  if (!self->line_starts || self->line_start_count == 0) return false;
+
+  // Binary search for the last row with a known start offset at or before
+  // the byte. Rows whose offsets are unknown pending a reparse are stepped
+  // over; row zero's offset is always known.
+  uint32_t best_row = 0;
+  uint32_t low = 0, high = self->line_start_count;
+  while (low < high) {
+    uint32_t mid = low + (high - low) / 2;
+    uint32_t probe = mid;
+    while (self->line_starts[probe] == UINT32_MAX) probe--;
+    if (self->line_starts[probe] <= byte) {
+      best_row = probe;
+      low = mid + 1;
+    } else {
+      high = probe;
+    }
+  }
+
+  result->row = best_row;
+  result->column = byte - self->line_starts[best_row];
+  return true;
+}
+
+bool ts_tree_byte_for_point(const TSTree *self, TSPoint point, uint32_t *result) {
+  if (!self->line_starts || point.row >= self->line_start_count) return false;
+  uint32_t row_start = self->line_starts[point.row];
+  if (row_start == UINT32_MAX) return false;
+  *result = row_start + point.column;
+  return true;
+}
+
+static void ts_tree__edit_included_ranges(TSTree *self, const TSInputEdit *edit) {
   for (unsigned i = 0; i < self->included_range_count; i++) {
     TSRange *range = &self->included_ranges[i];
     if (range->end_byte >= edit->old_end_byte) {
@@ -79,12 +300,63 @@ void ts_tree_edit(TSTree *self, const TSInputEdit *edit) {
       }
     }
   }
+}
+
+void ts_tree_edit(TSTree *self, const TSInputEdit *edit) {
+  if (self->descendant_index) {
+    ts_free(self->descendant_index);
+    self->descendant_index = NULL;
+    self->descendant_index_size = 0;
+  }
+
+  ts_tree__edit_included_ranges(self, edit);
+  ts_tree__edit_line_index(self, edit);
 
   SubtreePool pool = ts_subtree_pool_new(0);
   self->root = ts_subtree_edit(self->root, edit, &pool);
   ts_subtree_pool_delete(&pool);
 }
 
+void ts_tree_edit_batch(TSTree *self, const TSInputEdit *edits, uint32_t edit_count) {
+  if (edit_count == 0) return;
+  if (edit_count == 1) {
+    ts_tree_edit(self, &edits[0]);
+    return;
+  }
+
+  if (self->descendant_index) {
+    ts_free(self->descendant_index);
+    self->descendant_index = NULL;
+    self->descendant_index_size = 0;
+  }
+
+  // Sort the edits by start byte in descending order. The edits must not
+  // overlap, so applying them back-to-front means no edit ever shifts the
+  // coordinates of one that has yet to be applied. The sort is stable so
+  // that coincident insertions keep their given relative order.
+  TSInputEdit *sorted_edits = ts_malloc(edit_count * sizeof(TSInputEdit));
+  memcpy(sorted_edits, edits, edit_count * sizeof(TSInputEdit));
+  for (uint32_t i = 1; i < edit_count; i++) {
+    TSInputEdit edit = sorted_edits[i];
+    uint32_t j = i;
+    while (j > 0 && sorted_edits[j - 1].start_byte < edit.start_byte) {
+      sorted_edits[j] = sorted_edits[j - 1];
+      j--;
+    }
+    sorted_edits[j] = edit;
+  }
+
+  for (uint32_t i = 0; i < edit_count; i++) {
+    ts_tree__edit_included_ranges(self, &sorted_edits[i]);
+    ts_tree__edit_line_index(self, &sorted_edits[i]);
+  }
+
+  SubtreePool pool = ts_subtree_pool_new(0);
+  self->root = ts_subtree_edit_batch(self->root, sorted_edits, edit_count, &pool);
+  ts_subtree_pool_delete(&pool);
+  ts_free(sorted_edits);
+}
+
 TSRange *ts_tree_get_changed_ranges(const TSTree *self, const TSTree *other, uint32_t *count) {
   TreeCursor cursor1 = {NULL, array_new()};
   TreeCursor cursor2 = {NULL, array_new()};
@@ -110,6 +382,58 @@ TSRange *ts_tree_get_changed_ranges(const TSTree *self, const TSTree *other, uin
   return result;
 }
 
+TSTreeStats ts_tree_stats(const TSTree *self) {
+  TSTreeStats stats = {0, 0, 0, 0, 0, 0};
+  Array(Subtree) stack = array_new();
+  array_push(&stack, self->root);
+  while (stack.size > 0) {
+    Subtree tree = array_pop(&stack);
+    stats.node_count++;
+    if (tree.data.is_inline) {
+      stats.inline_node_count++;
+      continue;
+    }
+    stats.heap_node_count++;
+    uint64_t bytes = ts_subtree_alloc_size(tree.ptr->child_count);
+    if (
+      tree.ptr->child_count == 0 &&
+      tree.ptr->has_external_tokens &&
+      tree.ptr->external_scanner_state.length > sizeof(tree.ptr->external_scanner_state.short_data)
+    ) {
+      bytes += tree.ptr->external_scanner_state.length;
+    }
+    stats.heap_bytes += bytes;
+    if (tree.ptr->ref_count > 1) {
+      stats.shared_node_count++;
+      stats.shared_bytes += bytes;
+    }
+    for (uint32_t i = 0; i < tree.ptr->child_count; i++) {
+      array_push(&stack, ts_subtree_children(tree)[i]);
+    }
+  }
+  array_delete(&stack);
+  return stats;
+}
+
+void ts_tree_symbol_node_counts(
+  const TSTree *self,
+  uint32_t *counts,
+  uint32_t symbol_count
+) {
+  memset(counts, 0, symbol_count * sizeof(uint32_t));
+  Array(Subtree) stack = array_new();
+  array_push(&stack, self->root);
+  while (stack.size > 0) {
+    Subtree tree = array_pop(&stack);
+    TSSymbol symbol = ts_subtree_symbol(tree);
+    if (symbol < symbol_count) counts[symbol]++;
+    for (uint32_t i = 0; i < ts_subtree_child_count(tree); i++) {
+      array_push(&stack, ts_subtree_children(tree)[i]);
+    }
+  }
+  array_delete(&stack);
+}
+
 void ts_tree_print_dot_graph(const TSTree *self, FILE *file) {
   ts_subtree_print_dot_graph(self->root, self->language, file);
 }
@@ -17,10 +17,18 @@ struct TSTree {
   const TSLanguage *language;
   TSRange *included_ranges;
   unsigned included_range_count;
+  TSNode *descendant_index;
+  uint32_t descendant_index_size;
+  // The byte offset at which each row of the document starts, or UINT32_MAX
+  // for rows whose offset is not (or no longer) known. NULL for trees that
+  // were not produced by a parse, such as deserialized trees.
+  uint32_t *line_starts;
+  uint32_t line_start_count;
 };
 
 TSTree *ts_tree_new(Subtree root, const TSLanguage *language, const TSRange *, unsigned);
 TSNode ts_node_new(const TSTree *, const Subtree *, Length, TSSymbol);
+void ts_tree_build_line_index(TSTree *, const TSTree *old_tree, const Length *, uint32_t);
 
 #ifdef __cplusplus
 }
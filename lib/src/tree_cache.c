@@ -0,0 +1,179 @@
+#include <string.h>
+#include "tree_sitter/api.h"
+#include "./alloc.h"
+#include "./atomic.h"
+#include "./subtree.h"
+#include "./tree.h"
+
+// A shared, content-addressed cache of syntax trees.
+//
+// Trees in the cache are keyed by a fingerprint of the source text they
+// were parsed from, together with the language they were parsed with, so
+// a single cache can serve parsers configured for different grammars
+// without ever returning a tree whose symbol tables belong to another
+// language. Because subtrees are reference-counted with atomic
+// operations, a cached tree can be handed out to any number of parser
+// instances on any number of threads as a cheap `ts_tree_copy`; the node
+// data itself is shared, so duplicated file contents cost one tree's
+// worth of memory no matter how many consumers hold it.
+//
+// The table is a fixed-size open-addressing hash table guarded by a
+// spinlock. Lookups and insertions only hold the lock long enough to
+// bump a reference count or swap a slot, so contention is limited to a
+// few instructions even when many threads parse concurrently.
+
+typedef struct {
+  uint64_t hash;
+  uint64_t hash2;
+  uint32_t length;
+  const TSLanguage *language;
+  TSTree *tree;
+} TreeCacheEntry;
+
+struct TSTreeCache {
+  TreeCacheEntry *entries;
+  uint32_t capacity;
+  volatile uint32_t lock;
+};
+
+static const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+static const uint64_t FNV_PRIME = 1099511628211ULL;
+
+// Fingerprint the content with two independent FNV-1a hashes. A single
+// 64-bit hash plus the length is not enough to rule out collisions when
+// the cache is fed millions of files; two independent hashes and the
+// length make an accidental collision vanishingly unlikely.
+static void ts_tree_cache__hash(
+  const char *content,
+  uint32_t length,
+  uint64_t *hash,
+  uint64_t *hash2
+) {
+  uint64_t h = FNV_OFFSET_BASIS;
+  uint64_t g = FNV_OFFSET_BASIS ^ 0x9e3779b97f4a7c15ULL;
+  for (uint32_t i = 0; i < length; i++) {
+    h = (h ^ (uint8_t)content[i]) * FNV_PRIME;
+    g = (g ^ (uint8_t)(content[i] + 0x5f)) * FNV_PRIME;
+  }
+  *hash = h;
+  *hash2 = g;
+}
+
+static void ts_tree_cache__lock(TSTreeCache *self) {
+  while (!atomic_compare_exchange(&self->lock, 0, 1)) {}
+}
+
+static void ts_tree_cache__unlock(TSTreeCache *self) {
+  atomic_compare_exchange(&self->lock, 1, 0);
+}
+
+TSTreeCache *ts_tree_cache_new(uint32_t capacity) {
+  if (capacity == 0) capacity = 1024;
+
+  // Round the capacity up to a power of two so that probing can use a
+  // mask instead of a modulo.
+  uint32_t rounded = 1;
+  while (rounded < capacity) rounded <<= 1;
+
+  TSTreeCache *self = ts_malloc(sizeof(TSTreeCache));
+  self->entries = ts_calloc(rounded, sizeof(TreeCacheEntry));
+  self->capacity = rounded;
+  self->lock = 0;
+  return self;
+}
+
+void ts_tree_cache_delete(TSTreeCache *self) {
+  if (!self) return;
+  for (uint32_t i = 0; i < self->capacity; i++) {
+    if (self->entries[i].tree) ts_tree_delete(self->entries[i].tree);
+  }
+  ts_free(self->entries);
+  ts_free(self);
+}
+
+TSTree *ts_tree_cache_get(
+  TSTreeCache *self,
+  const TSLanguage *language,
+  const char *content,
+  uint32_t length
+) {
+  uint64_t hash, hash2;
+  ts_tree_cache__hash(content, length, &hash, &hash2);
+  uint32_t mask = self->capacity - 1;
+
+  TSTree *result = NULL;
+  ts_tree_cache__lock(self);
+  for (uint32_t probe = 0; probe < self->capacity; probe++) {
+    TreeCacheEntry *entry = &self->entries[(hash + probe) & mask];
+    if (!entry->tree) break;
+    if (
+      entry->hash == hash &&
+      entry->hash2 == hash2 &&
+      entry->length == length &&
+      entry->language == language
+    ) {
+      result = ts_tree_copy(entry->tree);
+      break;
+    }
+  }
+  ts_tree_cache__unlock(self);
+  return result;
+}
+
+void ts_tree_cache_put(
+  TSTreeCache *self,
+  const char *content,
+  uint32_t length,
+  const TSTree *tree
+) {
+  uint64_t hash, hash2;
+  ts_tree_cache__hash(content, length, &hash, &hash2);
+  uint32_t mask = self->capacity - 1;
+
+  TSTree *retained = ts_tree_copy((TSTree *)tree);
+  TSTree *evicted = NULL;
+
+  ts_tree_cache__lock(self);
+  TreeCacheEntry *slot = &self->entries[hash & mask];
+  for (uint32_t probe = 0; probe < self->capacity; probe++) {
+    TreeCacheEntry *entry = &self->entries[(hash + probe) & mask];
+    if (!entry->tree) {
+      slot = entry;
+      break;
+    }
+    if (
+      entry->hash == hash &&
+      entry->hash2 == hash2 &&
+      entry->length == length &&
+      entry->language == tree->language
+    ) {
+      slot = entry;
+      break;
+    }
+  }
+  evicted = slot->tree;
+  slot->hash = hash;
+  slot->hash2 = hash2;
+  slot->length = length;
+  slot->language = tree->language;
+  slot->tree = retained;
+  ts_tree_cache__unlock(self);
+
+  // Delete the displaced tree outside the lock: releasing a large tree
+  // walks all of its exclusively-owned nodes.
+  if (evicted) ts_tree_delete(evicted);
+}
+
+TSTree *ts_tree_cache_parse(
+  TSTreeCache *self,
+  TSParser *parser,
+  const char *content,
+  uint32_t length
+) {
+  TSTree *cached = ts_tree_cache_get(self, ts_parser_language(parser), content, length);
+  if (cached) return cached;
+
+  TSTree *tree = ts_parser_parse_string(parser, NULL, content, length);
+  if (tree) ts_tree_cache_put(self, content, length, tree);
+  return tree;
+}
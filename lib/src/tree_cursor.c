@@ -259,6 +259,136 @@ bool ts_tree_cursor_goto_parent(TSTreeCursor *_self) {
   return false;
 }
 
+static inline TSNode ts_tree_cursor__descendant_for_byte_range(
+  TSTreeCursor *self,
+  uint32_t range_start,
+  uint32_t range_end,
+  bool include_anonymous
+) {
+  // Walk upward from the cursor's current position to the nearest relevant
+  // ancestor whose range contains the given range. When consecutive lookups
+  // target nearby positions, this stays close to the previous result
+  // instead of starting over from the root.
+  TSNode node = ts_tree_cursor_current_node(self);
+  for (;;) {
+    uint32_t node_end = ts_node_end_byte(node);
+    if (
+      ts_node_start_byte(node) <= range_start &&
+      node_end >= range_end &&
+      node_end > range_start &&
+      (include_anonymous || ts_node_is_named(node))
+    ) break;
+    if (!ts_tree_cursor_goto_parent(self)) break;
+    node = ts_tree_cursor_current_node(self);
+  }
+
+  // Walk back down to the smallest node that contains the range. Sibling
+  // ranges don't overlap, so at most one child can contain it at each level.
+  TSNode result = node;
+  bool did_descend = true;
+  while (did_descend) {
+    did_descend = false;
+    if (!ts_tree_cursor_goto_first_child(self)) break;
+    bool found = false;
+    do {
+      TSNode child = ts_tree_cursor_current_node(self);
+      uint32_t child_end = ts_node_end_byte(child);
+      if (
+        child_end >= range_end &&
+        child_end > range_start &&
+        ts_node_start_byte(child) <= range_start
+      ) {
+        if (include_anonymous || ts_node_is_named(child)) result = child;
+        found = true;
+        did_descend = true;
+        break;
+      }
+      if (ts_node_start_byte(child) > range_start) break;
+    } while (ts_tree_cursor_goto_next_sibling(self));
+    if (!found) ts_tree_cursor_goto_parent(self);
+  }
+
+  return result;
+}
+
+static inline TSNode ts_tree_cursor__descendant_for_point_range(
+  TSTreeCursor *self,
+  TSPoint range_start,
+  TSPoint range_end,
+  bool include_anonymous
+) {
+  TSNode node = ts_tree_cursor_current_node(self);
+  for (;;) {
+    TSPoint node_end = ts_node_end_point(node);
+    if (
+      point_lte(ts_node_start_point(node), range_start) &&
+      point_lte(range_end, node_end) &&
+      point_lt(range_start, node_end) &&
+      (include_anonymous || ts_node_is_named(node))
+    ) break;
+    if (!ts_tree_cursor_goto_parent(self)) break;
+    node = ts_tree_cursor_current_node(self);
+  }
+
+  TSNode result = node;
+  bool did_descend = true;
+  while (did_descend) {
+    did_descend = false;
+    if (!ts_tree_cursor_goto_first_child(self)) break;
+    bool found = false;
+    do {
+      TSNode child = ts_tree_cursor_current_node(self);
+      TSPoint child_end = ts_node_end_point(child);
+      if (
+        point_lte(range_end, child_end) &&
+        point_lt(range_start, child_end) &&
+        point_lte(ts_node_start_point(child), range_start)
+      ) {
+        if (include_anonymous || ts_node_is_named(child)) result = child;
+        found = true;
+        did_descend = true;
+        break;
+      }
+      if (point_lt(range_start, ts_node_start_point(child))) break;
+    } while (ts_tree_cursor_goto_next_sibling(self));
+    if (!found) ts_tree_cursor_goto_parent(self);
+  }
+
+  return result;
+}
+
+TSNode ts_tree_cursor_descendant_for_byte_range(
+  TSTreeCursor *self,
+  uint32_t start,
+  uint32_t end
+) {
+  return ts_tree_cursor__descendant_for_byte_range(self, start, end, true);
+}
+
+TSNode ts_tree_cursor_named_descendant_for_byte_range(
+  TSTreeCursor *self,
+  uint32_t start,
+  uint32_t end
+) {
+  return ts_tree_cursor__descendant_for_byte_range(self, start, end, false);
+}
+
+TSNode ts_tree_cursor_descendant_for_point_range(
+  TSTreeCursor *self,
+  TSPoint start,
+  TSPoint end
+) {
+  return ts_tree_cursor__descendant_for_point_range(self, start, end, true);
+}
+
+TSNode ts_tree_cursor_named_descendant_for_point_range(
+  TSTreeCursor *self,
+  TSPoint start,
+  TSPoint end
+) {
+  return ts_tree_cursor__descendant_for_point_range(self, start, end, false);
+}
+
 TSNode ts_tree_cursor_current_node(const TSTreeCursor *_self) {
   const TreeCursor *self = (const TreeCursor *)_self;
   TreeCursorEntry *last_entry = array_back(&self->stack);
@@ -485,3 +615,22 @@ TSTreeCursor ts_tree_cursor_copy(const TSTreeCursor *_cursor) {
   array_push_all(&copy->stack, &cursor->stack);
   return res;
 }
+
+uint32_t ts_tree_cursor_children_into(
+  TSTreeCursor *_self,
+  TSNode *nodes,
+  TSFieldId *field_ids,
+  uint32_t capacity
+) {
+  uint32_t count = 0;
+  if (!ts_tree_cursor_goto_first_child(_self)) return 0;
+  do {
+    if (count < capacity) {
+      if (nodes) nodes[count] = ts_tree_cursor_current_node(_self);
+      if (field_ids) field_ids[count] = ts_tree_cursor_current_field_id(_self);
+    }
+    count++;
+  } while (ts_tree_cursor_goto_next_sibling(_self));
+  ts_tree_cursor_goto_parent(_self);
+  return count;
+}
@@ -0,0 +1,242 @@
+#include <string.h>
+#include "tree_sitter/api.h"
+#include "./alloc.h"
+#include "./array.h"
+#include "./subtree.h"
+#include "./tree.h"
+
+// A serialized tree starts with this header, which pins down everything
+// that has to match before the node records that follow it can be
+// interpreted: the format itself, the host's in-memory subtree layout
+// (the records are raw `SubtreeInlineData`/`SubtreeHeapData` images, so
+// the format is host-specific), and a fingerprint of the language build
+// the tree was produced with.
+typedef struct {
+  char magic[4];
+  uint32_t format_version;
+  uint32_t inline_data_size;
+  uint32_t heap_data_size;
+  uint32_t language_version;
+  uint32_t symbol_count;
+  uint32_t state_count;
+  uint32_t production_id_count;
+  uint32_t field_count;
+  uint32_t included_range_count;
+  uint32_t node_count;
+} SerializedTreeHeader;
+
+static const char SERIALIZED_TREE_MAGIC[4] = {'T', 'S', 'T', 'R'};
+static const uint32_t SERIALIZED_TREE_FORMAT_VERSION = 1;
+
+// Tags distinguishing the two node representations in the serialized stream.
+enum {
+  SerializedNodeInline = 0,
+  SerializedNodeHeap = 1,
+};
+
+typedef struct {
+  char *contents;
+  uint32_t size;
+  uint32_t capacity;
+} SerializationWriter;
+
+// Free a partially-deserialized tree. Unlike ts_subtree_release, this
+// tolerates child slots that were never filled in, and doesn't need to
+// consult reference counts: every node was just created with a count
+// of one.
+static void ts_serialized_tree__delete(Subtree root) {
+  MutableSubtreeArray stack = array_new();
+  if (root.ptr && !root.data.is_inline) {
+    array_push(&stack, ts_subtree_to_mut_unsafe(root));
+  }
+  while (stack.size > 0) {
+    MutableSubtree tree = array_pop(&stack);
+    if (tree.ptr->child_count > 0) {
+      Subtree *children = ts_subtree_children(ts_subtree_from_mut(tree));
+      for (uint32_t i = 0; i < tree.ptr->child_count; i++) {
+        Subtree child = children[i];
+        if (child.ptr && !child.data.is_inline) {
+          array_push(&stack, ts_subtree_to_mut_unsafe(child));
+        }
+      }
+      ts_free(children);
+    } else {
+      if (tree.ptr->has_external_tokens) {
+        ts_external_scanner_state_delete(&tree.ptr->external_scanner_state);
+      }
+      ts_free(tree.ptr);
+    }
+  }
+  array_delete(&stack);
+}
+
+static void serialization_writer_push(
+  SerializationWriter *self,
+  const void *data,
+  uint32_t length
+) {
+  if (self->size + length > self->capacity) {
+    while (self->size + length > self->capacity) self->capacity *= 2;
+    self->contents = ts_realloc(self->contents, self->capacity);
+  }
+  memcpy(self->contents + self->size, data, length);
+  self->size += length;
+}
+
+void *ts_tree_serialize(const TSTree *self, uint32_t *length) {
+  SerializationWriter writer = {
+    .contents = ts_malloc(1024),
+    .size = 0,
+    .capacity = 1024,
+  };
+
+  SerializedTreeHeader header = {
+    .format_version = SERIALIZED_TREE_FORMAT_VERSION,
+    .inline_data_size = sizeof(SubtreeInlineData),
+    .heap_data_size = sizeof(SubtreeHeapData),
+    .language_version = self->language->version,
+    .symbol_count = self->language->symbol_count,
+    .state_count = self->language->state_count,
+    .production_id_count = self->language->production_id_count,
+    .field_count = self->language->field_count,
+    .included_range_count = self->included_range_count,
+    .node_count = 0,
+  };
+  memcpy(header.magic, SERIALIZED_TREE_MAGIC, sizeof(header.magic));
+  serialization_writer_push(&writer, &header, sizeof(header));
+  serialization_writer_push(
+    &writer, self->included_ranges,
+    self->included_range_count * sizeof(TSRange)
+  );
+
+  // Write the subtrees in preorder. Children follow their parent from
+  // left to right, so deserialization can rebuild each node's child
+  // array in a single forward pass.
+  uint32_t node_count = 0;
+  SubtreeArray stack = array_new();
+  array_push(&stack, self->root);
+  while (stack.size > 0) {
+    Subtree tree = array_pop(&stack);
+    node_count++;
+    if (tree.data.is_inline) {
+      uint8_t tag = SerializedNodeInline;
+      serialization_writer_push(&writer, &tag, 1);
+      serialization_writer_push(&writer, &tree.data, sizeof(tree.data));
+    } else {
+      uint8_t tag = SerializedNodeHeap;
+      serialization_writer_push(&writer, &tag, 1);
+      serialization_writer_push(&writer, tree.ptr, sizeof(*tree.ptr));
+      if (tree.ptr->child_count == 0 && tree.ptr->has_external_tokens) {
+        const ExternalScannerState *state = &tree.ptr->external_scanner_state;
+        if (state->length > sizeof(state->short_data)) {
+          serialization_writer_push(&writer, state->long_data, state->length);
+        }
+      }
+      for (uint32_t i = tree.ptr->child_count; i > 0; i--) {
+        array_push(&stack, ts_subtree_children(tree)[i - 1]);
+      }
+    }
+  }
+  array_delete(&stack);
+
+  ((SerializedTreeHeader *)writer.contents)->node_count = node_count;
+  *length = writer.size;
+  return writer.contents;
+}
+
+TSTree *ts_tree_deserialize(
+  const void *buffer,
+  uint32_t length,
+  const TSLanguage *language
+) {
+  const char *cursor = buffer;
+  const char *end = cursor + length;
+
+  SerializedTreeHeader header;
+  if (length < sizeof(header)) return NULL;
+  memcpy(&header, cursor, sizeof(header));
+  cursor += sizeof(header);
+  if (
+    memcmp(header.magic, SERIALIZED_TREE_MAGIC, sizeof(header.magic)) != 0 ||
+    header.format_version != SERIALIZED_TREE_FORMAT_VERSION ||
+    header.inline_data_size != sizeof(SubtreeInlineData) ||
+    header.heap_data_size != sizeof(SubtreeHeapData) ||
+    header.language_version != language->version ||
+    header.symbol_count != language->symbol_count ||
+    header.state_count != language->state_count ||
+    header.production_id_count != language->production_id_count ||
+    header.field_count != language->field_count ||
+    header.node_count == 0
+  ) return NULL;
+
+  const TSRange *included_ranges = (const TSRange *)cursor;
+  if (
+    (uint64_t)header.included_range_count * sizeof(TSRange) >
+    (uint64_t)(end - cursor)
+  ) return NULL;
+  cursor += header.included_range_count * sizeof(TSRange);
+
+  // Rebuild the subtrees in the order they were written. A stack of
+  // unfilled child slots tracks where each completed node belongs;
+  // the slots of a node's children are pushed in reverse so that the
+  // next record read always fills the leftmost empty slot.
+  Subtree root = NULL_SUBTREE;
+  bool error = false;
+  Array(Subtree *) slot_stack = array_new();
+  array_push(&slot_stack, &root);
+  for (uint32_t i = 0; i < header.node_count && !error; i++) {
+    if (slot_stack.size == 0 || cursor >= end) { error = true; break; }
+    Subtree *slot = array_pop(&slot_stack);
+    uint8_t tag = *cursor++;
+
+    if (tag == SerializedNodeInline) {
+      if ((size_t)(end - cursor) < sizeof(SubtreeInlineData)) { error = true; break; }
+      memcpy(&slot->data, cursor, sizeof(SubtreeInlineData));
+      cursor += sizeof(SubtreeInlineData);
+      if (!slot->data.is_inline) { error = true; break; }
+    } else if (tag == SerializedNodeHeap) {
+      SubtreeHeapData node;
+      if ((size_t)(end - cursor) < sizeof(node)) { error = true; break; }
+      memcpy(&node, cursor, sizeof(node));
+      cursor += sizeof(node);
+      if (node.child_count > header.node_count - i - 1) { error = true; break; }
+
+      Subtree *children = ts_malloc(ts_subtree_alloc_size(node.child_count));
+      SubtreeHeapData *data = (SubtreeHeapData *)&children[node.child_count];
+      *data = node;
+      data->ref_count = 1;
+      *slot = (Subtree) {.ptr = data};
+
+      if (node.child_count > 0) {
+        for (uint32_t j = 0; j < node.child_count; j++) {
+          children[j] = NULL_SUBTREE;
+        }
+        for (uint32_t j = node.child_count; j > 0; j--) {
+          array_push(&slot_stack, &children[j - 1]);
+        }
+      } else if (node.has_external_tokens) {
+        ExternalScannerState *state = &data->external_scanner_state;
+        if (state->length > sizeof(state->short_data)) {
+          if ((size_t)(end - cursor) < state->length) {
+            state->length = 0;
+            error = true;
+            break;
+          }
+          ts_external_scanner_state_init(state, cursor, state->length);
+          cursor += state->length;
+        }
+      }
+    } else {
+      error = true;
+    }
+  }
+  if (!error && slot_stack.size > 0) error = true;
+  array_delete(&slot_stack);
+
+  if (error) {
+    ts_serialized_tree__delete(root);
+    return NULL;
+  }
+
+  return ts_tree_new(root, language, included_ranges, header.included_range_count);
+}
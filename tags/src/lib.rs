@@ -34,6 +34,12 @@ pub struct TagsConfiguration {
     pattern_info: Vec<PatternInfo>,
 }
 
+// The raw pointers in `c_syntax_type_names` point into the heap allocations
+// owned by `syntax_type_names`, which are never mutated after construction,
+// so a configuration can be shared freely between threads.
+unsafe impl Send for TagsConfiguration {}
+unsafe impl Sync for TagsConfiguration {}
+
 #[derive(Debug)]
 pub struct NamedCapture {
     pub syntax_type_id: u32,
@@ -296,6 +302,75 @@ impl TagsContext {
     }
 }
 
+/// Generate tags for a batch of files on a pool of worker threads, streaming
+/// each file's results into `sink` from the calling thread as they complete.
+///
+/// Each worker thread reuses a single parser and query cursor for all of the
+/// files that it processes. Results are delivered in completion order, not
+/// input order. Each call to `sink` receives a file's path along with either
+/// its full list of tags and a flag indicating whether the file contained a
+/// parse error, or the error that ended its processing. A `thread_count` of
+/// zero means one thread per available core.
+pub fn generate_tags_batch<F>(
+    config: &TagsConfiguration,
+    files: &[(&str, &[u8])],
+    thread_count: usize,
+    cancellation_flag: Option<&AtomicUsize>,
+    mut sink: F,
+) -> Result<(), Error>
+where
+    F: FnMut(&str, Result<(Vec<Tag>, bool), Error>),
+{
+    let mut thread_count = if thread_count > 0 {
+        thread_count
+    } else {
+        std::thread::available_parallelism().map_or(1, |n| n.get())
+    };
+    if thread_count > files.len() {
+        thread_count = files.len().max(1);
+    }
+
+    let next_file_index = AtomicUsize::new(0);
+    let (sender, receiver) = std::sync::mpsc::channel();
+    std::thread::scope(|scope| {
+        for _ in 0..thread_count {
+            let sender = sender.clone();
+            let next_file_index = &next_file_index;
+            scope.spawn(move || {
+                let mut context = TagsContext::new();
+                loop {
+                    if let Some(flag) = cancellation_flag {
+                        if flag.load(Ordering::Relaxed) != 0 {
+                            break;
+                        }
+                    }
+                    let file_index = next_file_index.fetch_add(1, Ordering::SeqCst);
+                    if file_index >= files.len() {
+                        break;
+                    }
+                    let result = context
+                        .generate_tags(config, files[file_index].1, cancellation_flag)
+                        .and_then(|(tags, has_error)| {
+                            Ok((tags.collect::<Result<Vec<_>, Error>>()?, has_error))
+                        });
+                    if sender.send((file_index, result)).is_err() {
+                        break;
+                    }
+                }
+            });
+        }
+        drop(sender);
+        for (file_index, result) in receiver {
+            sink(files[file_index].0, result);
+        }
+    });
+
+    if cancellation_flag.map_or(false, |flag| flag.load(Ordering::Relaxed) != 0) {
+        return Err(Error::Cancelled);
+    }
+    Ok(())
+}
+
 impl<'a, I> Iterator for TagsIter<'a, I>
 where
     I: Iterator<Item = tree_sitter::QueryMatch<'a, 'a>>,
@@ -0,0 +1,224 @@
+// Benchmark harness for the C library. Exercises each of the library's
+// main subsystems over a corpus file and reports per-subsystem wall time,
+// using the same timers that the library itself uses for parse timeouts.
+//
+// The harness is compiled together with a generated parser for one
+// language; the `bench` target in the root Makefile wires it up to one of
+// the fixture grammars and runs it over the corresponding error corpus.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <tree_sitter/api.h>
+#include "clock.h"
+
+#ifndef BENCH_LANGUAGE_SYMBOL
+#error "BENCH_LANGUAGE_SYMBOL must be defined to the grammar's entry point"
+#endif
+
+const TSLanguage *BENCH_LANGUAGE_SYMBOL(void);
+
+#define DEFAULT_REPETITION_COUNT 5
+
+// A query that visits every named node, so that the query benchmark works
+// with any grammar.
+static const char *MATCH_ANY_QUERY = "(_) @node";
+
+static char *read_file(const char *path, uint32_t *length) {
+  FILE *file = fopen(path, "rb");
+  if (!file) return NULL;
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  char *contents = malloc(size + 1);
+  if (fread(contents, 1, size, file) != (size_t)size) {
+    free(contents);
+    fclose(file);
+    return NULL;
+  }
+  contents[size] = '\0';
+  fclose(file);
+  *length = (uint32_t)size;
+  return contents;
+}
+
+static TSPoint point_for_byte(const char *text, uint32_t byte) {
+  TSPoint result = {0, 0};
+  for (uint32_t i = 0; i < byte; i++) {
+    if (text[i] == '\n') {
+      result.row++;
+      result.column = 0;
+    } else {
+      result.column++;
+    }
+  }
+  return result;
+}
+
+static void report(const char *name, uint64_t micros, unsigned repetitions) {
+  printf(
+    "  %-22s %10.3f ms total  %10.3f ms/rep\n",
+    name,
+    (double)micros / 1e3,
+    (double)micros / 1e3 / (double)repetitions
+  );
+}
+
+int main(int argc, const char **argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <corpus-file>...\n", argv[0]);
+    return 1;
+  }
+
+  unsigned repetitions = DEFAULT_REPETITION_COUNT;
+  const char *repetitions_env = getenv("TREE_SITTER_BENCHMARK_REPETITION_COUNT");
+  if (repetitions_env && atoi(repetitions_env) > 0) {
+    repetitions = (unsigned)atoi(repetitions_env);
+  }
+
+  const TSLanguage *language = BENCH_LANGUAGE_SYMBOL();
+  TSParser *parser = ts_parser_new();
+  ts_parser_set_language(parser, language);
+
+  uint32_t error_offset;
+  TSQueryError error_type;
+  TSQuery *query = ts_query_new(
+    language,
+    MATCH_ANY_QUERY,
+    (uint32_t)strlen(MATCH_ANY_QUERY),
+    &error_offset,
+    &error_type
+  );
+  TSQueryCursor *query_cursor = ts_query_cursor_new();
+
+  for (int f = 1; f < argc; f++) {
+    uint32_t length;
+    char *text = read_file(argv[f], &length);
+    if (!text) {
+      fprintf(stderr, "failed to read corpus file %s\n", argv[f]);
+      return 1;
+    }
+    printf("corpus: %s (%u bytes), %u repetitions\n", argv[f], length, repetitions);
+
+    // An edited copy of the text, with one byte inserted in the middle, for
+    // the incremental-parse and changed-range benchmarks.
+    uint32_t edit_byte = length / 2;
+    TSInputEdit edit = {
+      .start_byte = edit_byte,
+      .old_end_byte = edit_byte,
+      .new_end_byte = edit_byte + 1,
+      .start_point = point_for_byte(text, edit_byte),
+    };
+    edit.old_end_point = edit.start_point;
+    edit.new_end_point = edit.start_point;
+    edit.new_end_point.column++;
+    char *edited_text = malloc(length + 2);
+    memcpy(edited_text, text, edit_byte);
+    edited_text[edit_byte] = ' ';
+    memcpy(edited_text + edit_byte + 1, text + edit_byte, length - edit_byte + 1);
+
+    uint64_t parse_cold_micros = 0;
+    uint64_t parse_incremental_micros = 0;
+    uint64_t query_micros = 0;
+    uint64_t traversal_micros = 0;
+    uint64_t changed_range_micros = 0;
+    uint64_t match_count = 0;
+    uint64_t node_count = 0;
+    uint64_t checksum = 0;
+
+    for (unsigned rep = 0; rep < repetitions; rep++) {
+      TSClock start, end;
+
+      // Cold parse.
+      start = clock_now();
+      TSTree *tree = ts_parser_parse_string(parser, NULL, text, length);
+      end = clock_now();
+      parse_cold_micros += clock_elapsed_micros(start, end);
+
+      // Incremental parse after a one-byte insertion.
+      TSTree *edited_tree = ts_tree_copy(tree);
+      start = clock_now();
+      ts_tree_edit(edited_tree, &edit);
+      TSTree *new_tree = ts_parser_parse_string(
+        parser, edited_tree, edited_text, length + 1
+      );
+      end = clock_now();
+      parse_incremental_micros += clock_elapsed_micros(start, end);
+
+      // Query execution over the whole tree.
+      start = clock_now();
+      ts_query_cursor_exec(query_cursor, query, ts_tree_root_node(tree));
+      TSQueryMatch match;
+      while (ts_query_cursor_next_match(query_cursor, &match)) match_count++;
+      end = clock_now();
+      query_micros += clock_elapsed_micros(start, end);
+
+      // Full pre-order traversal, touching the accessors that editors use.
+      start = clock_now();
+      TSTreeCursor cursor = ts_tree_cursor_new(ts_tree_root_node(tree));
+      bool visited_children = false;
+      for (;;) {
+        if (!visited_children) {
+          TSNode node = ts_tree_cursor_current_node(&cursor);
+          node_count++;
+          // Fold the accessor results into a checksum so that the calls
+          // cannot be optimized away.
+          checksum +=
+            ts_node_symbol(node) +
+            ts_node_start_byte(node) +
+            ts_node_end_byte(node) +
+            ts_node_is_named(node);
+          if (ts_tree_cursor_goto_first_child(&cursor)) continue;
+        }
+        if (ts_tree_cursor_goto_next_sibling(&cursor)) {
+          visited_children = false;
+        } else if (ts_tree_cursor_goto_parent(&cursor)) {
+          visited_children = true;
+        } else {
+          break;
+        }
+      }
+      ts_tree_cursor_delete(&cursor);
+      end = clock_now();
+      traversal_micros += clock_elapsed_micros(start, end);
+
+      // Changed-range computation between the old and new trees.
+      start = clock_now();
+      uint32_t range_count;
+      TSRange *ranges = ts_tree_get_changed_ranges(edited_tree, new_tree, &range_count);
+      end = clock_now();
+      changed_range_micros += clock_elapsed_micros(start, end);
+      free(ranges);
+
+      ts_tree_delete(tree);
+      ts_tree_delete(edited_tree);
+      ts_tree_delete(new_tree);
+    }
+
+    report("parse (cold)", parse_cold_micros, repetitions);
+    report("parse (incremental)", parse_incremental_micros, repetitions);
+    report("query exec", query_micros, repetitions);
+    report("node traversal", traversal_micros, repetitions);
+    report("changed ranges", changed_range_micros, repetitions);
+    printf(
+      "  %-22s %10llu matches  %10llu nodes visited (checksum %llx)\n",
+      "totals",
+      (unsigned long long)match_count,
+      (unsigned long long)node_count,
+      (unsigned long long)checksum
+    );
+
+    free(text);
+    free(edited_text);
+  }
+
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  printf("peak RSS: %ld KB\n", usage.ru_maxrss);
+
+  ts_query_cursor_delete(query_cursor);
+  ts_query_delete(query);
+  ts_parser_delete(parser);
+  return 0;
+}